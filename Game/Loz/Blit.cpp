@@ -0,0 +1,497 @@
+/*
+   Copyright 2017 Aldo J. Nunez
+
+   Licensed under the Apache License, Version 2.0.
+   See the LICENSE text file for details.
+*/
+
+#include "Common.h"
+#include "Blit.h"
+
+#if defined( _M_IX86 ) || defined( _M_X64 ) || defined( __i386__ ) || defined( __x86_64__ )
+#define BLIT_X86 1
+#include <immintrin.h>
+#if _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC lets any function use any instruction set. GCC and Clang have to be
+// told which functions use which.
+#if BLIT_X86 && !_MSC_VER
+#define BLIT_TARGET( isa ) __attribute__(( target( isa ) ))
+#else
+#define BLIT_TARGET( isa )
+#endif
+
+// Row helpers are inlined into each kernel, so that the AVX2 kernels never
+// call code that mixes in legacy SSE encodings, which costs a stall on
+// every switch.
+#if _MSC_VER
+#define BLIT_INLINE __forceinline
+#else
+#define BLIT_INLINE inline __attribute__(( always_inline ))
+#endif
+
+
+typedef void (*DrawRectFunc)(
+    uint8_t* dest, int destPitch, const uint8_t* src, int srcPitch,
+    int width, int height, bool flipX, const uint8_t* colors );
+
+typedef void (*ConvertToArgbFunc)(
+    uint32_t* dest, const uint8_t* src, int count, const uint32_t* colorsArgb8 );
+
+struct Kernels
+{
+    DrawRectFunc        DrawRect;
+    ConvertToArgbFunc   ConvertToArgb;
+};
+
+
+//----------------------------------------------------------------------------
+//  Scalar
+//----------------------------------------------------------------------------
+
+static BLIT_INLINE void DrawRowScalar( uint8_t* dest, const uint8_t* src, int width, bool flipX, const uint8_t* colors )
+{
+    int step = flipX ? -1 : 1;
+
+    for ( int x = 0; x < width; x++ )
+    {
+        uint8_t color = colors[*src];
+        if ( color != Blit_Transparent )
+            dest[x] = color;
+        src += step;
+    }
+}
+
+static void DrawRectScalar(
+    uint8_t* dest, int destPitch, const uint8_t* src, int srcPitch,
+    int width, int height, bool flipX, const uint8_t* colors )
+{
+    for ( int y = 0; y < height; y++ )
+    {
+        DrawRowScalar( dest, src, width, flipX, colors );
+        dest += destPitch;
+        src += srcPitch;
+    }
+}
+
+static void ConvertToArgbScalar(
+    uint32_t* dest, const uint8_t* src, int count, const uint32_t* colorsArgb8 )
+{
+    for ( int i = 0; i < count; i++ )
+    {
+        dest[i] = colorsArgb8[src[i]];
+    }
+}
+
+static const Kernels scalarKernels = { DrawRectScalar, ConvertToArgbScalar };
+
+
+#if BLIT_X86
+
+//----------------------------------------------------------------------------
+//  SSSE3
+//----------------------------------------------------------------------------
+
+// PSHUFB looks up 16 indexes at a time in a 16 byte table, which is exactly
+// the size of the colors table. SSE2 has no byte shuffle.
+
+BLIT_TARGET( "ssse3" )
+static BLIT_INLINE __m128i MergeColors( __m128i colors, __m128i dest )
+{
+    __m128i transparent = _mm_cmpeq_epi8( colors, _mm_set1_epi8( (char) Blit_Transparent ) );
+    return _mm_or_si128( _mm_and_si128( transparent, dest ), _mm_andnot_si128( transparent, colors ) );
+}
+
+BLIT_TARGET( "ssse3" )
+static BLIT_INLINE void DrawRowSsse3(
+    uint8_t* dest, const uint8_t* src, int width, bool flipX, __m128i table, const uint8_t* colors )
+{
+    const __m128i reverse16 = _mm_setr_epi8( 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 );
+    const __m128i reverse8 = _mm_setr_epi8( 7, 6, 5, 4, 3, 2, 1, 0, 8, 9, 10, 11, 12, 13, 14, 15 );
+    int x = 0;
+
+    if ( !flipX )
+    {
+        for ( ; x + 16 <= width; x += 16 )
+        {
+            __m128i indexes = _mm_loadu_si128( (const __m128i*) (src + x) );
+            __m128i mapped = _mm_shuffle_epi8( table, indexes );
+            __m128i pixels = _mm_loadu_si128( (const __m128i*) (dest + x) );
+            _mm_storeu_si128( (__m128i*) (dest + x), MergeColors( mapped, pixels ) );
+        }
+
+        for ( ; x + 8 <= width; x += 8 )
+        {
+            __m128i indexes = _mm_loadl_epi64( (const __m128i*) (src + x) );
+            __m128i mapped = _mm_shuffle_epi8( table, indexes );
+            __m128i pixels = _mm_loadl_epi64( (const __m128i*) (dest + x) );
+            _mm_storel_epi64( (__m128i*) (dest + x), MergeColors( mapped, pixels ) );
+        }
+
+        DrawRowScalar( dest + x, src + x, width - x, false, colors );
+    }
+    else
+    {
+        for ( ; x + 16 <= width; x += 16 )
+        {
+            __m128i indexes = _mm_loadu_si128( (const __m128i*) (src - x - 15) );
+            indexes = _mm_shuffle_epi8( indexes, reverse16 );
+            __m128i mapped = _mm_shuffle_epi8( table, indexes );
+            __m128i pixels = _mm_loadu_si128( (const __m128i*) (dest + x) );
+            _mm_storeu_si128( (__m128i*) (dest + x), MergeColors( mapped, pixels ) );
+        }
+
+        for ( ; x + 8 <= width; x += 8 )
+        {
+            __m128i indexes = _mm_loadl_epi64( (const __m128i*) (src - x - 7) );
+            indexes = _mm_shuffle_epi8( indexes, reverse8 );
+            __m128i mapped = _mm_shuffle_epi8( table, indexes );
+            __m128i pixels = _mm_loadl_epi64( (const __m128i*) (dest + x) );
+            _mm_storel_epi64( (__m128i*) (dest + x), MergeColors( mapped, pixels ) );
+        }
+
+        DrawRowScalar( dest + x, src - x, width - x, true, colors );
+    }
+}
+
+BLIT_TARGET( "ssse3" )
+static void DrawRectSsse3(
+    uint8_t* dest, int destPitch, const uint8_t* src, int srcPitch,
+    int width, int height, bool flipX, const uint8_t* colors )
+{
+    __m128i table = _mm_loadu_si128( (const __m128i*) colors );
+
+    for ( int y = 0; y < height; y++ )
+    {
+        DrawRowSsse3( dest, src, width, flipX, table, colors );
+        dest += destPitch;
+        src += srcPitch;
+    }
+}
+
+// Looking up ARGB colors with byte shuffles takes 16 of them for every 16
+// pixels, which is slower than plain loads.
+static const Kernels ssse3Kernels = { DrawRectSsse3, ConvertToArgbScalar };
+
+
+//----------------------------------------------------------------------------
+//  AVX2
+//----------------------------------------------------------------------------
+
+BLIT_TARGET( "avx2" )
+static BLIT_INLINE __m256i MergeColors256( __m256i colors, __m256i dest )
+{
+    __m256i transparent = _mm256_cmpeq_epi8( colors, _mm256_set1_epi8( (char) Blit_Transparent ) );
+    return _mm256_blendv_epi8( colors, dest, transparent );
+}
+
+BLIT_TARGET( "avx2" )
+static void DrawRectAvx2(
+    uint8_t* dest, int destPitch, const uint8_t* src, int srcPitch,
+    int width, int height, bool flipX, const uint8_t* colors )
+{
+    __m128i table = _mm_loadu_si128( (const __m128i*) colors );
+    // PSHUFB looks up each 128-bit lane by itself, so both lanes get the
+    // table.
+    __m256i table256 = _mm256_broadcastsi128_si256( table );
+    const __m256i reverse = _mm256_setr_epi8(
+        15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+        15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 );
+
+    for ( int y = 0; y < height; y++ )
+    {
+        int x = 0;
+
+        for ( ; x + 32 <= width; x += 32 )
+        {
+            __m256i indexes;
+
+            if ( !flipX )
+            {
+                indexes = _mm256_loadu_si256( (const __m256i*) (src + x) );
+            }
+            else
+            {
+                indexes = _mm256_loadu_si256( (const __m256i*) (src - x - 31) );
+                indexes = _mm256_shuffle_epi8( indexes, reverse );
+                indexes = _mm256_permute4x64_epi64( indexes, 0x4E );
+            }
+
+            __m256i colors256 = _mm256_shuffle_epi8( table256, indexes );
+            __m256i pixels = _mm256_loadu_si256( (const __m256i*) (dest + x) );
+            _mm256_storeu_si256( (__m256i*) (dest + x), MergeColors256( colors256, pixels ) );
+        }
+
+        const uint8_t* srcRest = flipX ? src - x : src + x;
+        DrawRowSsse3( dest + x, srcRest, width - x, flipX, table, colors );
+
+        dest += destPitch;
+        src += srcPitch;
+    }
+}
+
+BLIT_TARGET( "avx2" )
+static void ConvertToArgbAvx2(
+    uint32_t* dest, const uint8_t* src, int count, const uint32_t* colorsArgb8 )
+{
+    int i = 0;
+
+    for ( ; i + 16 <= count; i += 16 )
+    {
+        __m128i colors = _mm_loadu_si128( (const __m128i*) (src + i) );
+        __m256i indexesLow = _mm256_cvtepu8_epi32( colors );
+        __m256i indexesHigh = _mm256_cvtepu8_epi32( _mm_srli_si128( colors, 8 ) );
+        __m256i pixelsLow = _mm256_i32gather_epi32( (const int*) colorsArgb8, indexesLow, 4 );
+        __m256i pixelsHigh = _mm256_i32gather_epi32( (const int*) colorsArgb8, indexesHigh, 4 );
+
+        _mm256_storeu_si256( (__m256i*) (dest + i), pixelsLow );
+        _mm256_storeu_si256( (__m256i*) (dest + i + 8), pixelsHigh );
+    }
+
+    for ( ; i < count; i++ )
+    {
+        dest[i] = colorsArgb8[src[i]];
+    }
+}
+
+static const Kernels avx2Kernels = { DrawRectAvx2, ConvertToArgbAvx2 };
+
+
+static bool CpuHasSsse3()
+{
+#if _MSC_VER
+    int info[4];
+    __cpuid( info, 1 );
+    return (info[2] & (1 << 9)) != 0;
+#else
+    return __builtin_cpu_supports( "ssse3" );
+#endif
+}
+
+static bool CpuHasAvx2()
+{
+#if _MSC_VER
+    int info[4];
+    __cpuid( info, 0 );
+    if ( info[0] < 7 )
+        return false;
+
+    // The OS has to save the YMM registers too.
+    __cpuid( info, 1 );
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if ( !osxsave || !avx || (_xgetbv( 0 ) & 6) != 6 )
+        return false;
+
+    __cpuidex( info, 7, 0 );
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports( "avx2" );
+#endif
+}
+
+#endif  // BLIT_X86
+
+
+static const Kernels* levelKernels[Blit::Level_Max] =
+{
+    &scalarKernels,
+#if BLIT_X86
+    &ssse3Kernels,
+    &avx2Kernels,
+#else
+    nullptr,
+    nullptr,
+#endif
+};
+
+static Blit::Level ChooseBestLevel()
+{
+#if BLIT_X86
+    if ( CpuHasAvx2() )
+        return Blit::Level_Avx2;
+    if ( CpuHasSsse3() )
+        return Blit::Level_Ssse3;
+#endif
+    return Blit::Level_Scalar;
+}
+
+static const Blit::Level bestLevel = ChooseBestLevel();
+static Blit::Level curLevel = bestLevel;
+static const Kernels* kernels = levelKernels[bestLevel];
+
+
+Blit::Level Blit::GetBestLevel()
+{
+    return bestLevel;
+}
+
+Blit::Level Blit::GetLevel()
+{
+    return curLevel;
+}
+
+void Blit::SetLevel( Level level )
+{
+    assert( level >= 0 && level < Level_Max );
+
+    if ( level > bestLevel )
+        level = bestLevel;
+
+    curLevel = level;
+    kernels = levelKernels[level];
+}
+
+const char* Blit::GetLevelName( Level level )
+{
+    static const char* names[] = { "scalar", "SSSE3", "AVX2" };
+    static_assert( _countof( names ) == Level_Max, "" );
+
+    return names[level];
+}
+
+void Blit::DrawRect(
+    uint8_t* dest,
+    int destPitch,
+    const uint8_t* src,
+    int srcPitch,
+    int width,
+    int height,
+    bool flipX,
+    const uint8_t* colors
+    )
+{
+    if ( width <= 0 || height <= 0 )
+        return;
+
+    kernels->DrawRect( dest, destPitch, src, srcPitch, width, height, flipX, colors );
+}
+
+void Blit::ConvertToArgb(
+    uint32_t* dest,
+    const uint8_t* src,
+    int count,
+    const uint32_t* colorsArgb8
+    )
+{
+    kernels->ConvertToArgb( dest, src, count, colorsArgb8 );
+}
+
+
+//----------------------------------------------------------------------------
+//  Benchmark
+//----------------------------------------------------------------------------
+
+enum
+{
+    BenchSheetSize      = 128,
+    BenchFrameWidth     = 256,
+    BenchFrameHeight    = 240,
+    BenchSpriteCount    = 64,
+};
+
+// A frame like a busy room: a screen full of background tiles, 16x16 sprites
+// made of two 8x16 halves, and the conversion to ARGB.
+
+static void DrawBenchFrame( const uint8_t* sheet, uint8_t* frame, const uint8_t* colors )
+{
+    for ( int y = 0; y < BenchFrameHeight; y += 8 )
+    {
+        for ( int x = 0; x < BenchFrameWidth; x += 8 )
+        {
+            const uint8_t* src = sheet + ((y * 3) & 0x78) * BenchSheetSize + ((x * 5) & 0x78);
+            Blit::DrawRect( frame + y * BenchFrameWidth + x, BenchFrameWidth,
+                src, BenchSheetSize, 8, 8, false, colors );
+        }
+    }
+
+    for ( int i = 0; i < BenchSpriteCount; i++ )
+    {
+        int x = (i * 37) % (BenchFrameWidth - 16);
+        int y = (i * 53) % (BenchFrameHeight - 16);
+        bool flipX = (i & 1) != 0;
+        int srcX = flipX ? 15 : 0;
+
+        for ( int half = 0; half < 2; half++ )
+        {
+            Blit::DrawRect( frame + y * BenchFrameWidth + x + half * 8, BenchFrameWidth,
+                sheet + srcX + (flipX ? -half * 8 : half * 8), BenchSheetSize, 8, 16, flipX, colors );
+        }
+    }
+}
+
+void Blit::RunBenchmark()
+{
+    const int tileDraws = 200000;
+    const int frameDraws = 2000;
+
+    uint8_t* sheet = new uint8_t[BenchSheetSize * BenchSheetSize];
+    uint8_t* frame = new uint8_t[BenchFrameWidth * BenchFrameHeight];
+    uint32_t* pixels = new uint32_t[BenchFrameWidth * BenchFrameHeight];
+    uint8_t colors[Blit_IndexCount];
+    uint32_t colorsArgb8[Blit_FrameColorCount];
+
+    for ( int i = 0; i < BenchSheetSize * BenchSheetSize; i++ )
+        sheet[i] = (i * 7 + i / 13) & 3;
+
+    memset( colors, Blit_Transparent, sizeof colors );
+    colors[1] = 0x16;
+    colors[2] = 0x27;
+    colors[3] = 0x30;
+
+    for ( int i = 0; i < Blit_FrameColorCount; i++ )
+        colorsArgb8[i] = 0xFF000000 | (i * 0x030507);
+
+    memset( frame, 0, BenchFrameWidth * BenchFrameHeight );
+
+    Level savedLevel = curLevel;
+
+    for ( int level = 0; level <= bestLevel; level++ )
+    {
+        SetLevel( (Level) level );
+
+        double startTime = al_get_time();
+
+        for ( int i = 0; i < tileDraws; i++ )
+        {
+            int x = (i * 8) & (BenchFrameWidth - 1);
+            int y = ((i >> 5) * 8) % (BenchFrameHeight - 8);
+            bool flipX = (i & 1) != 0;
+            const uint8_t* src = sheet + (i & 0x78) + (flipX ? 7 : 0);
+            Blit::DrawRect( frame + y * BenchFrameWidth + x, BenchFrameWidth,
+                src, BenchSheetSize, 8, 8, flipX, colors );
+        }
+
+        double tileTime = al_get_time() - startTime;
+
+        startTime = al_get_time();
+
+        for ( int i = 0; i < frameDraws; i++ )
+        {
+            DrawBenchFrame( sheet, frame, colors );
+            Blit::ConvertToArgb( pixels, frame, BenchFrameWidth * BenchFrameHeight, colorsArgb8 );
+        }
+
+        double frameTime = al_get_time() - startTime;
+
+        if ( tileTime <= 0 )
+            tileTime = 1e-9;
+        if ( frameTime <= 0 )
+            frameTime = 1e-9;
+
+        printf( "%-6s  %12.0f tiles/s  %9.0f frames/s  %7.1f us/frame\n",
+            GetLevelName( (Level) level ),
+            tileDraws / tileTime,
+            frameDraws / frameTime,
+            frameTime * 1e6 / frameDraws );
+    }
+
+    SetLevel( savedLevel );
+
+    delete [] pixels;
+    delete [] frame;
+    delete [] sheet;
+}
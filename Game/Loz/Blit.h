@@ -0,0 +1,75 @@
+/*
+   Copyright 2017 Aldo J. Nunez
+
+   Licensed under the Apache License, Version 2.0.
+   See the LICENSE text file for details.
+*/
+
+#pragma once
+
+
+// The inner loops of the software renderer. Each kernel has a plain version,
+// and SSSE3 and AVX2 versions, one of which is chosen when the program
+// starts, according to what the CPU supports.
+
+enum
+{
+    // Tile sheets hold up to this many palette color indexes.
+    Blit_IndexCount     = 16,
+    // A frame color that isn't drawn.
+    Blit_Transparent    = 0xFF,
+    // Frame colors are system colors, plus Frame_Black.
+    Blit_FrameColorCount = SysPaletteLength + 1,
+};
+
+
+class Blit
+{
+public:
+    enum Level
+    {
+        Level_Scalar,
+        Level_Ssse3,
+        Level_Avx2,
+
+        Level_Max
+    };
+
+    static Level GetBestLevel();
+    static Level GetLevel();
+    // The level can be lowered to compare kernels. It can't be raised above
+    // the best level.
+    static void SetLevel( Level level );
+    static const char* GetLevelName( Level level );
+
+    // Draws a rectangle of palette color indexes. Each index is mapped to a
+    // frame color by the colors table, which has Blit_IndexCount entries.
+    // Pixels mapped to Blit_Transparent are skipped.
+    //
+    // The source pitch can be negative, to flip vertically. If flipX is
+    // true, then src points to the last pixel of each source row, and the
+    // row is read backward.
+    static void DrawRect(
+        uint8_t* dest,
+        int destPitch,
+        const uint8_t* src,
+        int srcPitch,
+        int width,
+        int height,
+        bool flipX,
+        const uint8_t* colors
+        );
+
+    // Converts frame colors to ARGB. The colors table has
+    // Blit_FrameColorCount entries.
+    static void ConvertToArgb(
+        uint32_t* dest,
+        const uint8_t* src,
+        int count,
+        const uint32_t* colorsArgb8
+        );
+
+    // Times each kernel at each level the CPU supports, and prints tiles
+    // a second and full frames a second.
+    static void RunBenchmark();
+};
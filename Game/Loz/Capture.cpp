@@ -0,0 +1,383 @@
+/*
+   Copyright 2017 Aldo J. Nunez
+
+   Licensed under the Apache License, Version 2.0.
+   See the LICENSE text file for details.
+*/
+
+#include "Common.h"
+#include "Capture.h"
+#include "Sound.h"
+#include <chrono>
+
+
+enum
+{
+    WavHeaderSize   = 44,
+    // Samples, not sample frames. A power of two, so that the ring's
+    // counters can wrap around.
+    AudioRingLength = 1 << 17,
+};
+
+static_assert( (FrameCapture::FrameWidth & 1) == 0 && (FrameCapture::FrameHeight & 1) == 0,
+    "4:2:0 video needs an even width and height." );
+
+
+FrameCapture::FrameCapture()
+    :   videoFile(),
+        audioFile(),
+        y4m(),
+        frames(),
+        frameSlots(),
+        frameHead(),
+        frameTail(),
+        droppedFrames(),
+        audio(),
+        audioLength(),
+        audioHead(),
+        audioTail(),
+        droppedSamples(),
+        audioBytesWritten(),
+        encodeBuf(),
+        stopping()
+{
+}
+
+FrameCapture::~FrameCapture()
+{
+    Close();
+}
+
+static bool EndsWith( const char* str, const char* suffix )
+{
+    size_t strLen = strlen( str );
+    size_t suffixLen = strlen( suffix );
+
+    return strLen >= suffixLen && 0 == _stricmp( str + strLen - suffixLen, suffix );
+}
+
+bool FrameCapture::Open( const char* videoPath, const char* audioPath, int queueLength )
+{
+    assert( videoPath != nullptr );
+
+    Close();
+
+    if ( queueLength <= 0 )
+        return false;
+
+    errno_t err = fopen_s( &videoFile, videoPath, "wb" );
+    if ( err != 0 )
+    {
+        videoFile = nullptr;
+        return false;
+    }
+
+    y4m = EndsWith( videoPath, ".y4m" );
+
+    if ( y4m )
+    {
+        fprintf( videoFile, "YUV4MPEG2 W%d H%d F60:1 Ip A1:1 C420jpeg\n", FrameWidth, FrameHeight );
+    }
+
+    if ( audioPath != nullptr )
+    {
+        err = fopen_s( &audioFile, audioPath, "wb" );
+        if ( err != 0 )
+        {
+            audioFile = nullptr;
+            Close();
+            return false;
+        }
+
+        // The sizes are filled in when the capture is closed.
+        WriteWavHeader();
+
+        audio = new int16_t[AudioRingLength];
+        audioLength = AudioRingLength;
+    }
+
+    frames = new uint32_t[queueLength * FramePixels];
+    frameSlots = queueLength;
+    encodeBuf = new uint8_t[FramePixels * 3];
+
+    frameHead.store( 0 );
+    frameTail.store( 0 );
+    droppedFrames = 0;
+    audioHead.store( 0 );
+    audioTail.store( 0 );
+    droppedSamples.store( 0 );
+    audioBytesWritten = 0;
+    stopping.store( false );
+
+    worker = std::thread( &FrameCapture::Work, this );
+
+    return true;
+}
+
+void FrameCapture::Close()
+{
+    if ( worker.joinable() )
+    {
+        // The worker writes everything that's queued before it stops.
+        stopping.store( true, std::memory_order_release );
+        worker.join();
+    }
+
+    if ( audioFile != nullptr )
+    {
+        fseek( audioFile, 0, SEEK_SET );
+        WriteWavHeader();
+        fclose( audioFile );
+        audioFile = nullptr;
+    }
+
+    if ( videoFile != nullptr )
+    {
+        fclose( videoFile );
+        videoFile = nullptr;
+    }
+
+    delete [] frames;
+    delete [] audio;
+    delete [] encodeBuf;
+
+    frames = nullptr;
+    frameSlots = 0;
+    audio = nullptr;
+    audioLength = 0;
+    encodeBuf = nullptr;
+}
+
+bool FrameCapture::IsOpen() const
+{
+    return videoFile != nullptr;
+}
+
+uint32_t* FrameCapture::BeginFrame( bool wait )
+{
+    if ( frames == nullptr )
+        return nullptr;
+
+    uint32_t head = frameHead.load( std::memory_order_relaxed );
+    uint32_t tail = frameTail.load( std::memory_order_acquire );
+
+    while ( wait && head - tail >= (uint32_t) frameSlots )
+    {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+        tail = frameTail.load( std::memory_order_acquire );
+    }
+
+    if ( head - tail >= (uint32_t) frameSlots )
+    {
+        droppedFrames++;
+        return nullptr;
+    }
+
+    return frames + (head % frameSlots) * FramePixels;
+}
+
+void FrameCapture::EndFrame()
+{
+    uint32_t head = frameHead.load( std::memory_order_relaxed );
+    frameHead.store( head + 1, std::memory_order_release );
+}
+
+void FrameCapture::WriteAudio( const int16_t* samples, int frameCount )
+{
+    if ( audio == nullptr )
+        return;
+
+    uint32_t count = frameCount * Sound::ChannelCount;
+    uint32_t head = audioHead.load( std::memory_order_relaxed );
+    uint32_t tail = audioTail.load( std::memory_order_acquire );
+
+    if ( count > audioLength - (head - tail) )
+    {
+        droppedSamples.fetch_add( count, std::memory_order_relaxed );
+        return;
+    }
+
+    uint32_t start = head % audioLength;
+    uint32_t firstCount = Util::Min( count, audioLength - start );
+
+    memcpy( audio + start, samples, firstCount * sizeof( int16_t ) );
+    memcpy( audio, samples + firstCount, (count - firstCount) * sizeof( int16_t ) );
+
+    audioHead.store( head + count, std::memory_order_release );
+}
+
+uint32_t FrameCapture::GetFrameCount() const
+{
+    return frameHead.load( std::memory_order_relaxed );
+}
+
+uint32_t FrameCapture::GetDroppedFrameCount() const
+{
+    return droppedFrames;
+}
+
+uint32_t FrameCapture::GetDroppedSampleCount() const
+{
+    return droppedSamples.load( std::memory_order_relaxed );
+}
+
+void FrameCapture::Work()
+{
+    while ( true )
+    {
+        // Checked before looking for work, so that nothing queued before
+        // the stop is left behind.
+        bool stop = stopping.load( std::memory_order_acquire );
+
+        bool wroteFrame = WriteNextFrame();
+        bool wroteAudio = WriteAudioRun();
+
+        if ( !wroteFrame && !wroteAudio )
+        {
+            if ( stop )
+                break;
+
+            std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+        }
+    }
+}
+
+bool FrameCapture::WriteNextFrame()
+{
+    uint32_t tail = frameTail.load( std::memory_order_relaxed );
+    uint32_t head = frameHead.load( std::memory_order_acquire );
+
+    if ( tail == head )
+        return false;
+
+    const uint32_t* pixels = frames + (tail % frameSlots) * FramePixels;
+
+    if ( y4m )
+        WriteY4mFrame( pixels );
+    else
+        WriteRgbFrame( pixels );
+
+    frameTail.store( tail + 1, std::memory_order_release );
+    return true;
+}
+
+bool FrameCapture::WriteAudioRun()
+{
+    if ( audio == nullptr )
+        return false;
+
+    uint32_t tail = audioTail.load( std::memory_order_relaxed );
+    uint32_t head = audioHead.load( std::memory_order_acquire );
+
+    if ( tail == head )
+        return false;
+
+    uint32_t start = tail % audioLength;
+    uint32_t count = Util::Min( head - tail, audioLength - start );
+
+    fwrite( audio + start, sizeof( int16_t ), count, audioFile );
+    audioBytesWritten += count * sizeof( int16_t );
+
+    audioTail.store( tail + count, std::memory_order_release );
+    return true;
+}
+
+// BT.601 studio range, the usual for Y4M.
+
+void FrameCapture::WriteY4mFrame( const uint32_t* pixels )
+{
+    uint8_t* yPlane = encodeBuf;
+    uint8_t* uPlane = yPlane + FramePixels;
+    uint8_t* vPlane = uPlane + FramePixels / 4;
+
+    for ( int i = 0; i < FramePixels; i++ )
+    {
+        int r = (pixels[i] >> 16) & 0xFF;
+        int g = (pixels[i] >> 8) & 0xFF;
+        int b = pixels[i] & 0xFF;
+
+        yPlane[i] = 16 + ((66 * r + 129 * g + 25 * b + 128) >> 8);
+    }
+
+    // Each chroma sample is the average of a 2x2 block.
+    for ( int y = 0; y < FrameHeight; y += 2 )
+    {
+        for ( int x = 0; x < FrameWidth; x += 2 )
+        {
+            const uint32_t* block = pixels + y * FrameWidth + x;
+            uint32_t quad[4] = { block[0], block[1], block[FrameWidth], block[FrameWidth + 1] };
+            int r = 0;
+            int g = 0;
+            int b = 0;
+
+            for ( int i = 0; i < 4; i++ )
+            {
+                r += (quad[i] >> 16) & 0xFF;
+                g += (quad[i] >> 8) & 0xFF;
+                b += quad[i] & 0xFF;
+            }
+
+            r = (r + 2) / 4;
+            g = (g + 2) / 4;
+            b = (b + 2) / 4;
+
+            int index = (y / 2) * (FrameWidth / 2) + x / 2;
+            uPlane[index] = 128 + ((-38 * r - 74 * g + 112 * b + 128) >> 8);
+            vPlane[index] = 128 + ((112 * r - 94 * g - 18 * b + 128) >> 8);
+        }
+    }
+
+    fputs( "FRAME\n", videoFile );
+    fwrite( encodeBuf, 1, FramePixels * 3 / 2, videoFile );
+}
+
+void FrameCapture::WriteRgbFrame( const uint32_t* pixels )
+{
+    uint8_t* out = encodeBuf;
+
+    for ( int i = 0; i < FramePixels; i++ )
+    {
+        *out++ = (pixels[i] >> 16) & 0xFF;
+        *out++ = (pixels[i] >> 8) & 0xFF;
+        *out++ = pixels[i] & 0xFF;
+    }
+
+    fwrite( encodeBuf, 1, FramePixels * 3, videoFile );
+}
+
+static uint8_t* Put16( uint8_t* p, uint16_t value )
+{
+    p[0] = value & 0xFF;
+    p[1] = value >> 8;
+    return p + 2;
+}
+
+static uint8_t* Put32( uint8_t* p, uint32_t value )
+{
+    p = Put16( p, value & 0xFFFF );
+    return Put16( p, value >> 16 );
+}
+
+void FrameCapture::WriteWavHeader()
+{
+    const int bytesPerFrame = Sound::ChannelCount * sizeof( int16_t );
+    uint8_t header[WavHeaderSize];
+    uint8_t* p = header;
+
+    memcpy( p, "RIFF", 4 );
+    p = Put32( p + 4, WavHeaderSize - 8 + audioBytesWritten );
+    memcpy( p, "WAVEfmt ", 8 );
+    p = Put32( p + 8, 16 );
+    p = Put16( p, 1 );      // PCM
+    p = Put16( p, Sound::ChannelCount );
+    p = Put32( p, Sound::SampleRate );
+    p = Put32( p, Sound::SampleRate * bytesPerFrame );
+    p = Put16( p, bytesPerFrame );
+    p = Put16( p, 16 );
+    memcpy( p, "data", 4 );
+    p = Put32( p + 4, audioBytesWritten );
+
+    assert( p == header + WavHeaderSize );
+
+    fwrite( header, 1, WavHeaderSize, audioFile );
+}
@@ -0,0 +1,88 @@
+/*
+   Copyright 2017 Aldo J. Nunez
+
+   Licensed under the Apache License, Version 2.0.
+   See the LICENSE text file for details.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+
+// Writes frames, and optionally the mixed audio, to files on a thread of its
+// own, so that the game never waits on the disk.
+//
+// A path ending in ".y4m" gets Y4M video, in 4:2:0 at 60 frames a second.
+// Any other path gets raw 24-bit RGB, top row first. Audio is written as a
+// 16-bit stereo WAV file.
+//
+// Frames go through a queue of buffers allocated when the capture is
+// opened. The game fills one with BeginFrame and EndFrame. If every buffer
+// is waiting to be written, then the frame is dropped and counted instead.
+// Audio that doesn't fit in its ring is dropped the same way.
+
+class FrameCapture
+{
+public:
+    enum
+    {
+        FrameWidth  = StdViewWidth,
+        FrameHeight = StdViewHeight,
+        FramePixels = FrameWidth * FrameHeight,
+    };
+
+private:
+    FILE*                   videoFile;
+    FILE*                   audioFile;
+    bool                    y4m;
+
+    uint32_t*               frames;
+    int                     frameSlots;
+    std::atomic<uint32_t>   frameHead;
+    std::atomic<uint32_t>   frameTail;
+    uint32_t                droppedFrames;
+
+    int16_t*                audio;
+    uint32_t                audioLength;
+    std::atomic<uint32_t>   audioHead;
+    std::atomic<uint32_t>   audioTail;
+    std::atomic<uint32_t>   droppedSamples;
+    uint32_t                audioBytesWritten;
+
+    uint8_t*                encodeBuf;
+    std::atomic<bool>       stopping;
+    std::thread             worker;
+
+public:
+    FrameCapture();
+    ~FrameCapture();
+
+    // The audio path can be null.
+    bool Open( const char* videoPath, const char* audioPath, int queueLength );
+    void Close();
+    bool IsOpen() const;
+
+    // Returns a buffer of FramePixels ARGB pixels for the next frame, or null
+    // if the frame has to be dropped. The frame is only queued by EndFrame.
+    // When there's time to spare, such as when making a video from a movie,
+    // the caller can wait for a buffer instead.
+    uint32_t* BeginFrame( bool wait = false );
+    void EndFrame();
+
+    // Queues 16-bit stereo samples. Can be called from the audio thread.
+    void WriteAudio( const int16_t* samples, int frameCount );
+
+    uint32_t GetFrameCount() const;
+    uint32_t GetDroppedFrameCount() const;
+    uint32_t GetDroppedSampleCount() const;
+
+private:
+    void Work();
+    bool WriteNextFrame();
+    bool WriteAudioRun();
+    void WriteY4mFrame( const uint32_t* pixels );
+    void WriteRgbFrame( const uint32_t* pixels );
+    void WriteWavHeader();
+};
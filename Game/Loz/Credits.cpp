@@ -12,6 +12,7 @@
 #include "UWBossAnim.h"
 #include "World.h"
 #include "Profile.h"
+#include "TextCache.h"
 
 
 struct Line
@@ -32,7 +33,7 @@ Credits::Credits()
         windowFirstMappedLine( 0 ),
         madePlayerLine( false )
 {
-    Util::LoadResource( "credits.tab", &textTable );
+    Util::LoadSharedResource( "credits.tab", &textTable );
     Util::LoadList( "creditsLinesBmp.dat", lineBmp, AllLineBytes );
 
     // It's a little cleaner to come up with these two line bitmaps than to use
@@ -120,13 +121,36 @@ void Credits::MakePlayerLine( const Line* line )
     madePlayerLine = true;
 }
 
+enum
+{
+    WallLeft        = 24,
+    WallRight       = 224,
+    WallLineLength  = (WallRight - WallLeft) / 8 + 1,
+};
+
+// The text cache keeps the wall lines as runs.
+
 static void DrawHorizWallLine( int x, int y, int length )
 {
-    for ( int i = 0; i < length; i++ )
-    {
-        DrawChar( 0xFA, x, y, 0 );
-        x += 8;
-    }
+    uint8_t wallLine[WallLineLength];
+
+    assert( length <= WallLineLength );
+
+    memset( wallLine, 0xFA, length );
+    TextCache::DrawString( wallLine, length, x, y, 0 );
+}
+
+// The side walls are drawn as one run with blank space between them.
+
+static void DrawSideWalls( int y )
+{
+    uint8_t sideWalls[WallLineLength];
+
+    memset( sideWalls, Char_Space, sizeof sideWalls );
+    sideWalls[0] = 0xFA;
+    sideWalls[WallLineLength - 1] = 0xFA;
+
+    TextCache::DrawString( sideWalls, WallLineLength, WallLeft, y, 0 );
 }
 
 void Credits::Draw()
@@ -147,8 +171,7 @@ void Credits::Draw()
 
         if ( i > 1 && i < 44 )
         {
-            DrawChar( 0xFA, 24, y, 0 );
-            DrawChar( 0xFA, 224, y, 0 );
+            DrawSideWalls( y );
             pal = ((i + 6) / 7) % 3 + 1;
         }
         else if ( World::GetProfile().Quest == 1 )
@@ -172,17 +195,17 @@ void Credits::Draw()
                     MakePlayerLine( line );
                 text = playerLine;
             }
-            DrawString( text, line->Length, x, y, pal );
+            TextCache::DrawString( text, line->Length, x, y, pal );
             mappedLine++;
         }
         if ( i == 1 )
         {
-            DrawHorizWallLine( 24, y, 10 );
+            DrawHorizWallLine( WallLeft, y, 10 );
             DrawHorizWallLine( 160, y, 9 );
         }
         else if ( i == 44 )
         {
-            DrawHorizWallLine( 24, y, 26 );
+            DrawHorizWallLine( WallLeft, y, WallLineLength );
         }
         y += 8;
     }
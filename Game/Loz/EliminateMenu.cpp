@@ -71,11 +71,17 @@ void EliminateMenu::Update()
     }
 }
 
-void EliminateMenu::Draw()
+Menu* EliminateMenu::Clone()
 {
-    Graphics::Begin();
+    EliminateMenu* menu = new EliminateMenu( *this );
+    // Give the copy its own summaries, so that neither sees the other's changes.
+    menu->summaries = std::make_shared<ProfileSummarySnapshot>( *summaries );
+    return menu;
+}
 
-    al_clear_to_color( al_map_rgb( 0, 0, 0 ) );
+void EliminateMenu::Draw()
+{
+    Graphics::Clear();
 
     DrawString( EliminateStr, sizeof EliminateStr, 0x20, 0x18, 0 );
     DrawString( EliminationEndStr, sizeof EliminationEndStr, 0x50, 0x78, 0 );
@@ -97,6 +103,4 @@ void EliminateMenu::Draw()
     else
         y = 0x78 + (selectedIndex - 3) * 16;
     DrawChar( Char_FullHeart, 0x44, y, 7 );
-
-    Graphics::End();
 }
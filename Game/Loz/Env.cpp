@@ -0,0 +1,331 @@
+/*
+   Copyright 2017 Aldo J. Nunez
+
+   Licensed under the Apache License, Version 2.0.
+   See the LICENSE text file for details.
+*/
+
+#include "Common.h"
+#include "Env.h"
+#include "Graphics.h"
+#include "Input.h"
+#include "Object.h"
+#include "Profile.h"
+#include "Sound.h"
+#include "World.h"
+#include "WorldImpl.h"
+
+
+static_assert( LozEnv_MaxObjects == MaxObjects, "Observations must have a slot for every object." );
+static_assert( LozEnv_MaxItems == ItemSlot_MaxItems, "Observations must have every item." );
+static_assert( LozEnv_FrameWidth == StdViewWidth && LozEnv_FrameHeight == StdViewHeight,
+    "Frames are the size of the view." );
+static_assert( LozEnv_FrameBlack == Frame_Black, "Frames use the software renderer's colors." );
+
+
+struct LozEnv
+{
+    EnvBatch    Batch;
+};
+
+
+//----------------------------------------------------------------------------
+//  EnvBatch
+//----------------------------------------------------------------------------
+
+bool EnvBatch::InitSystem()
+{
+    static bool initialized;
+
+    // The software renderer costs nothing until a frame is drawn.
+    if ( !initialized )
+        initialized = InitAllegroHeadless( true );
+
+    return initialized;
+}
+
+EnvBatch::EnvBatch()
+    :   slots(),
+        count(),
+        frameSkip( 1 )
+{
+}
+
+EnvBatch::~EnvBatch()
+{
+    Destroy();
+}
+
+bool EnvBatch::Create( int count, int frameSkip )
+{
+    assert( count > 0 );
+
+    Destroy();
+
+    slots = new Slot[count];
+    if ( slots == nullptr )
+        return false;
+
+    memset( slots, 0, sizeof( Slot ) * count );
+
+    this->count = count;
+    this->frameSkip = frameSkip > 0 ? frameSkip : 1;
+
+    return true;
+}
+
+void EnvBatch::Destroy()
+{
+    for ( int i = 0; i < count; i++ )
+    {
+        World::Destroy( slots[i].World );
+    }
+
+    delete [] slots;
+    slots = nullptr;
+    count = 0;
+}
+
+int EnvBatch::GetCount() const
+{
+    return count;
+}
+
+void EnvBatch::Reset( uint64_t seed )
+{
+    for ( int i = 0; i < count; i++ )
+    {
+        ResetOne( i, seed + i );
+    }
+}
+
+void EnvBatch::ResetOne( int index, uint64_t seed )
+{
+    assert( index >= 0 && index < count );
+
+    Slot& slot = slots[index];
+
+    // A new world is made, so that nothing from the last episode is left.
+    World::Destroy( slot.World );
+    slot.World = World::Create();
+
+    Profile profile = { 0 };
+    profile.Items[ItemSlot_HeartContainers] = DefaultHearts;
+    profile.Items[ItemSlot_MaxBombs] = DefaultBombs;
+
+    World::SetRandomSeed( seed );
+    World::Start( 0, profile );
+
+    slot.Hearts = World::GetProfile().Hearts;
+    slot.RoomId = World::GetRoomId();
+    slot.KillCount = slot.World->roomKillCount;
+    slot.Done = false;
+}
+
+bool EnvBatch::IsDone()
+{
+    GameMode mode = World::GetMode();
+
+    return mode == Mode_Death
+        || mode == Mode_ContinueQuestion
+        || mode == Mode_WinGame;
+}
+
+float EnvBatch::StepOne( Slot& slot, uint8_t action )
+{
+    float reward = 0;
+
+    World::MakeCurrent( slot.World );
+
+    for ( int i = 0; i < frameSkip && !slot.Done; i++ )
+    {
+        Input::Update( action );
+        World::Update();
+        Sound::Update();
+
+        uint16_t hearts = World::GetProfile().Hearts;
+        int roomId = World::GetRoomId();
+        int killCount = slot.World->roomKillCount;
+
+        reward += ((int) hearts - (int) slot.Hearts) / 256.0f;
+
+        // The kill count starts over in every room.
+        if ( roomId != slot.RoomId || killCount < slot.KillCount )
+            reward += killCount;
+        else
+            reward += killCount - slot.KillCount;
+
+        slot.Hearts = hearts;
+        slot.RoomId = roomId;
+        slot.KillCount = killCount;
+        slot.Done = IsDone();
+    }
+
+    return reward;
+}
+
+void EnvBatch::Step(
+    const uint8_t* actions,
+    LozEnvObservation* observations,
+    float* rewards,
+    uint8_t* dones,
+    uint8_t* frames )
+{
+    assert( actions != nullptr );
+
+    for ( int i = 0; i < count; i++ )
+    {
+        float reward = 0;
+
+        if ( slots[i].World != nullptr )
+            reward = StepOne( slots[i], actions[i] );
+
+        if ( rewards != nullptr )
+            rewards[i] = reward;
+
+        if ( dones != nullptr )
+            dones[i] = slots[i].Done ? 1 : 0;
+
+        if ( observations != nullptr )
+            Observe( i, observations[i] );
+
+        if ( frames != nullptr )
+            Render( i, frames + i * LozEnv_FrameSize );
+    }
+}
+
+void EnvBatch::Observe( int index, LozEnvObservation& observation )
+{
+    assert( index >= 0 && index < count );
+
+    memset( &observation, 0, sizeof observation );
+
+    Slot& slot = slots[index];
+    if ( slot.World == nullptr )
+        return;
+
+    World::MakeCurrent( slot.World );
+
+    const Profile& profile = World::GetProfile();
+
+    observation.Mode = World::GetMode();
+    observation.RoomId = World::GetRoomId();
+    observation.Hearts = profile.Hearts;
+    observation.HeartContainers = profile.Items[ItemSlot_HeartContainers];
+    memcpy( observation.Items, profile.Items, sizeof observation.Items );
+
+    for ( int i = 0; i < MaxObjects; i++ )
+    {
+        Object* obj = World::GetObject( i );
+        if ( obj == nullptr )
+            continue;
+
+        LozEnvObject& objObs = observation.Objects[i];
+
+        objObs.Type = obj->GetType();
+        objObs.X = obj->GetX();
+        objObs.Y = obj->GetY();
+        objObs.Facing = obj->GetFacing();
+        objObs.HP = obj->GetHP();
+
+        if ( i == PlayerSlot )
+        {
+            observation.PlayerX = objObs.X;
+            observation.PlayerY = objObs.Y;
+            observation.PlayerFacing = objObs.Facing;
+        }
+    }
+}
+
+// Each thread has one software frame. The world draws into it, and the
+// frame is copied out before another world draws.
+
+void EnvBatch::Render( int index, uint8_t* frame )
+{
+    assert( index >= 0 && index < count );
+    assert( Graphics::IsSoftware() );
+
+    Slot& slot = slots[index];
+
+    if ( slot.World == nullptr )
+    {
+        memset( frame, Frame_Black, LozEnv_FrameSize );
+        return;
+    }
+
+    World::MakeCurrent( slot.World );
+    World::Draw();
+
+    memcpy( frame, Graphics::GetFrame(), LozEnv_FrameSize );
+}
+
+
+//----------------------------------------------------------------------------
+//  C interface
+//----------------------------------------------------------------------------
+
+LozEnv* LozEnv_Create( int count, int frameSkip )
+{
+    if ( count <= 0 || !EnvBatch::InitSystem() )
+        return nullptr;
+
+    LozEnv* env = new LozEnv();
+
+    if ( !env->Batch.Create( count, frameSkip ) )
+    {
+        delete env;
+        return nullptr;
+    }
+
+    return env;
+}
+
+void LozEnv_Destroy( LozEnv* env )
+{
+    delete env;
+}
+
+int LozEnv_GetCount( const LozEnv* env )
+{
+    return env->Batch.GetCount();
+}
+
+void LozEnv_Reset( LozEnv* env, uint64_t seed )
+{
+    env->Batch.Reset( seed );
+}
+
+void LozEnv_ResetOne( LozEnv* env, int index, uint64_t seed )
+{
+    if ( index < 0 || index >= env->Batch.GetCount() )
+        return;
+
+    env->Batch.ResetOne( index, seed );
+}
+
+void LozEnv_Step(
+    LozEnv* env,
+    const uint8_t* actions,
+    LozEnvObservation* observations,
+    float* rewards,
+    uint8_t* dones,
+    uint8_t* frames )
+{
+    env->Batch.Step( actions, observations, rewards, dones, frames );
+}
+
+void LozEnv_Observe( LozEnv* env, int index, LozEnvObservation* observation )
+{
+    if ( index < 0 || index >= env->Batch.GetCount() || observation == nullptr )
+        return;
+
+    env->Batch.Observe( index, *observation );
+}
+
+void LozEnv_Render( LozEnv* env, int index, uint8_t* frame )
+{
+    if ( index < 0 || index >= env->Batch.GetCount() || frame == nullptr )
+        return;
+
+    env->Batch.Render( index, frame );
+}
@@ -0,0 +1,60 @@
+/*
+   Copyright 2017 Aldo J. Nunez
+
+   Licensed under the Apache License, Version 2.0.
+   See the LICENSE text file for details.
+*/
+
+#pragma once
+
+#include "LozEnv.h"
+
+
+class WorldImpl;
+
+
+// The C++ side of the LozEnv interface. See LozEnv.h.
+
+class EnvBatch
+{
+    struct Slot
+    {
+        WorldImpl*  World;
+        uint16_t    Hearts;
+        int         RoomId;
+        int         KillCount;
+        bool        Done;
+    };
+
+    Slot*       slots;
+    int         count;
+    int         frameSkip;
+
+public:
+    // Loads what all worlds share, without a display. Only needed once.
+    static bool InitSystem();
+
+    EnvBatch();
+    ~EnvBatch();
+
+    bool Create( int count, int frameSkip );
+    void Destroy();
+    int GetCount() const;
+
+    void Reset( uint64_t seed );
+    void ResetOne( int index, uint64_t seed );
+
+    void Step(
+        const uint8_t* actions,
+        LozEnvObservation* observations,
+        float* rewards,
+        uint8_t* dones,
+        uint8_t* frames );
+
+    void Observe( int index, LozEnvObservation& observation );
+    void Render( int index, uint8_t* frame );
+
+private:
+    float StepOne( Slot& slot, uint8_t action );
+    static bool IsDone();
+};
@@ -99,11 +99,17 @@ void GameMenu::Update()
     }
 }
 
-void GameMenu::Draw()
+Menu* GameMenu::Clone()
 {
-    Graphics::Begin();
+    GameMenu* menu = new GameMenu( *this );
+    // Give the copy its own summaries, so that neither sees the other's changes.
+    menu->summaries = std::make_shared<ProfileSummarySnapshot>( *summaries );
+    return menu;
+}
 
-    al_clear_to_color( al_map_rgb( 0, 0, 0 ) );
+void GameMenu::Draw()
+{
+    Graphics::Clear();
 
     DrawBox( 0x18, 0x40, 0xD0, 0x90 );
 
@@ -137,6 +143,4 @@ void GameMenu::Draw()
     else
         y = 0xA8 + (selectedIndex - 3) * 16;
     DrawChar( Char_FullHeart, 0x28, y, 7 );
-
-    Graphics::End();
 }
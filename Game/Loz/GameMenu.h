@@ -22,6 +22,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual Menu* Clone();
 
 private:
     void SelectNext();
@@ -138,3 +138,5 @@ enum
 
 uint32_t GetFrameCounter();
 ALLEGRO_CONFIG* GetConfig();
+// With software, frames are drawn in memory. See Graphics::InitSoftware.
+bool InitAllegroHeadless( bool software );
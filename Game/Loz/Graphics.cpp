@@ -7,6 +7,13 @@
 
 #include "Common.h"
 #include "Graphics.h"
+#include "Blit.h"
+#include <allegro5/allegro_opengl.h>
+#include <allegro5/allegro_primitives.h>
+#if _WIN32
+#include <allegro5/allegro_direct3d.h>
+#endif
+#include <mutex>
 
 
 // Y determines the palette, X determines the color in the palette.
@@ -18,19 +25,120 @@ enum
 {
     TileWidth   = 8,
     TileHeight  = 8,
+
+    MaxCachedSheets = 64,
+    MaxCachedPath   = 64,
+
+    AtlasSize       = 2048,
+    MaxAtlasPages   = 8,
+};
+
+static_assert( PaletteBmpWidth == Blit_IndexCount, "Each palette color index needs a frame color." );
+static_assert( Frame_Black + 1 == Blit_FrameColorCount, "Frame_Black is the last frame color." );
+static_assert( PaletteBmpHeight <= 32, "Palette rows are tracked in 32 bits." );
+// The palette shaders have to agree with these.
+static_assert( PaletteCount * 2 <= PaletteBmpHeight, "Grayscale palettes follow the others." );
+const int MaxEffectPalettes = 64;
+const int EffectBmpHeight = MaxEffectPalettes * 2;
+
+
+// A tile sheet decoded for the software renderer: one palette color index
+// for each pixel.
+
+struct IndexedSheet
+{
+    int                     width;
+    int                     height;
+    uint8_t*                indexes;
+};
+
+
+// Graphics state that belongs to one world. Everything else in this file
+// belongs to the display, or is read-only once loaded.
+
+struct Graphics::Context
+{
+    ALLEGRO_BITMAP*             tileSheets[Sheet_Max];
+    const IndexedSheet*         indexedSheets[Sheet_Max];
+    Util::Table<SpriteAnim>*    animSpecs[Sheet_Max];
+    int                         systemPalette[SysPaletteLength];
+    int                         grayscalePalette[SysPaletteLength];
+    bool                        grayscale;
+    uint8_t                     palettes[PaletteCount][PaletteLength];
+    int                         paletteColors[PaletteBmpHeight][PaletteBmpWidth];
+    // The rows of paletteColors changed since the last UpdatePalettes, and
+    // the rows it made take effect that haven't been uploaded yet. What it
+    // made take effect is kept in committedColors, until uploaded.
+    uint32_t                    changedPaletteRows;
+    uint32_t                    pendingPaletteRows;
+    // The first PaletteCount rows are in color, and the rest are the same
+    // palettes in grayscale. The shader picks one set with a uniform.
+    int                         committedColors[PaletteBmpHeight][PaletteBmpWidth];
+    // Palettes from effectFirst up to effectEnd are shown from the effect
+    // palettes, starting at effectBase.
+    uint8_t                     effectPalettes[MaxEffectPalettes][PaletteLength];
+    int                         effectPaletteCount;
+    bool                        effectPalettesChanged;
+    int                         effectFirst;
+    int                         effectEnd;
+    int                         effectBase;
+};
+
+
+// Tile sheets and animation tables are loaded once, and shared by all worlds.
+
+struct CachedSheet
+{
+    char                    path[MaxCachedPath];
+    ALLEGRO_BITMAP*         bitmap;
+    IndexedSheet            indexed;
+};
+
+struct CachedAnims
+{
+    char                    path[MaxCachedPath];
+    Util::Table<SpriteAnim> anims;
+};
+
+
+// The hardware renderer draws layers into a bitmap, and the software
+// renderer into an indexed sheet.
+
+struct Graphics::Layer
+{
+    ALLEGRO_BITMAP*         bitmap;
+    IndexedSheet            indexed;
+};
+
+struct Graphics::TileGrid
+{
+    ALLEGRO_BITMAP*         bitmap;
 };
 
 
-ALLEGRO_BITMAP* tileSheets[Sheet_Max];
 ALLEGRO_BITMAP* paletteBmp;
+// Whether palette rows are stored bottom up in the palette bitmap. See
+// UploadPalettes. Unknown until the first upload.
+int             paletteRowsFlipped = -1;
+ALLEGRO_BITMAP* effectBmp;
+// What the palette bitmaps hold, so that uploads that change nothing can be
+// left out. The rows of the palette bitmap uploaded so far are in
+// uploadedPaletteRows.
+static int      uploadedColors[PaletteBmpHeight][PaletteBmpWidth];
+static uint32_t uploadedPaletteRows;
+static int      effectColors[EffectBmpHeight][PaletteBmpWidth];
+static int      uploadedEffectColors[EffectBmpHeight][PaletteBmpWidth];
+static bool     effectColorsUploaded;
+// Set when the palette shader's uniforms no longer match the context.
+bool            paletteUniformsStale = true;
 ALLEGRO_SHADER* tileShader;
-unsigned char*  paletteBuf;
-int             paletteBufSize;
-int             paletteStride;
-int             systemPalette[SysPaletteLength];
-int             grayscalePalette[SysPaletteLength];
-int*            activeSystemPalette = systemPalette;
-uint8_t         palettes[PaletteCount][PaletteLength];
+// Optional. Without it, tile maps are drawn some other way.
+ALLEGRO_SHADER* tileMapShader;
+// Optional. Used for sharp scaling.
+ALLEGRO_SHADER* presentShader;
+bool            sharpScaling;
+// Frames are drawn here at their native size.
+ALLEGRO_BITMAP* frameBmp;
 
 float           viewScale;
 float           viewOffsetX;
@@ -41,72 +149,233 @@ int             savedClipY;
 int             savedClipWidth;
 int             savedClipHeight;
 
-Util::Table<SpriteAnim> animSpecs[Sheet_Max];
+static std::mutex   cacheLock;
+static CachedSheet  cachedSheets[MaxCachedSheets];
+static int          cachedSheetCount;
+static CachedAnims  cachedAnims[MaxCachedSheets];
+static int          cachedAnimsCount;
+
+static ALLEGRO_BITMAP* atlasPages[MaxAtlasPages];
+static int          atlasPageCount;
+static bool         atlasEnabled = true;
+// Sheets are packed in rows, left to right, in the last page.
+static int          atlasShelfX;
+static int          atlasShelfY;
+static int          atlasShelfHeight;
+
+static Graphics::DrawStats  drawStats;
+static ALLEGRO_BITMAP*      batchTexture;
+
+// Between Begin and End, draws to the frame are recorded here, and sent
+// to the GPU a batch per texture when something needs them drawn. If a
+// frame records the same commands as the one before, and nothing they
+// draw from changed, then it isn't drawn again.
+
+enum
+{
+    MaxDrawCommands = 2048,
+    MaxDrawClips    = 32,
+    VertexesPerDraw = 6,
+};
+
+enum DrawKind : uint8_t
+{
+    Draw_Bitmap,
+    // srcX is the system color, or -1 for black.
+    Draw_Clear,
+    // The source is in cells of the grid, and sheet is what they refer to.
+    Draw_TileGrid,
+};
+
+struct DrawCommand
+{
+    ALLEGRO_BITMAP* texture;
+    ALLEGRO_BITMAP* sheet;
+    // Source position in the texture, not in the sub-bitmap drawn.
+    int16_t         srcX;
+    int16_t         srcY;
+    int16_t         width;
+    int16_t         height;
+    int16_t         destX;
+    int16_t         destY;
+    uint8_t         palette;
+    uint8_t         flags;
+    uint8_t         clip;
+    DrawKind        kind;
+    uint16_t        batch;
+};
+
+struct DrawBatch
+{
+    ALLEGRO_BITMAP* texture;
+    DrawKind        kind;
+    int             clip;
+    int             count;
+    int             firstVertex;
+    // Bounds of the commands in the batch, for telling whether later ones
+    // can be moved into it.
+    int             left;
+    int             top;
+    int             right;
+    int             bottom;
+};
+
+static bool         recordingDraws;
+static DrawCommand  drawCommands[MaxDrawCommands];
+static int          drawCommandCount;
+static DrawBatch    drawBatches[MaxDrawCommands];
+static int          drawClips[MaxDrawClips][4];
+static int          drawClipCount;
+// A hash of what the frame being recorded draws, and of the last frame
+// drawn. frameDirty is set when something they draw from changes, or when
+// the frame has to be drawn before it's finished.
+static uint64_t     frameHash;
+static uint64_t     lastFrameHash;
+static bool         frameDirty = true;
+static bool         frameChanged;
+static ALLEGRO_VERTEX*  drawVertexes;
+static ALLEGRO_COLOR    paletteTints[PaletteCount];
+
+static thread_local Graphics::Context* ctx;
+
+// Without a display, tile sheets aren't loaded, draws do nothing, and the
+// palette buffer is never uploaded.
+static bool     headless;
+
+// The software renderer is headless, but loads tile sheets, and draws them
+// into the frame of the calling thread.
+static bool     software;
+
+static thread_local uint8_t frame[StdViewHeight * StdViewWidth];
+static thread_local int     frameClipX;
+static thread_local int     frameClipY;
+static thread_local int     frameClipWidth = StdViewWidth;
+static thread_local int     frameClipHeight = StdViewHeight;
+static thread_local int     savedFrameClipX;
+static thread_local int     savedFrameClipY;
+static thread_local int     savedFrameClipWidth = StdViewWidth;
+static thread_local int     savedFrameClipHeight = StdViewHeight;
+
+static thread_local Graphics::Layer* layerTarget;
+static ALLEGRO_BITMAP*  savedTarget;
+static bool             savedHeld;
+static int              savedBlendOp;
+static int              savedBlendSrc;
+static int              savedBlendDest;
 
 
 static bool ChooseShaderSource( 
     ALLEGRO_SHADER* shader, 
     const char** vsource, 
-    const char** psource )
+    const char** psource,
+    const char** mapPsource,
+    const char** presentPsource )
 {
     ALLEGRO_SHADER_PLATFORM platform = al_get_shader_platform( shader );
     if ( platform == ALLEGRO_SHADER_HLSL )
     {
         *vsource = "tileShaderVertex.hlsl";
         *psource = "tileShaderPixel.hlsl";
+        *mapPsource = "tileMapShaderPixel.hlsl";
+        *presentPsource = "presentShaderPixel.hlsl";
     }
     else if ( platform == ALLEGRO_SHADER_GLSL )
     {
         *vsource = "tileShaderVertex.glsl";
         *psource = "tileShaderPixel.glsl";
+        *mapPsource = "tileMapShaderPixel.glsl";
+        *presentPsource = "presentShaderPixel.glsl";
     }
     else
     {
         *vsource = nullptr;
         *psource = nullptr;
+        *mapPsource = nullptr;
+        *presentPsource = nullptr;
         return false;
     }
 
    return true;
 }
 
-static bool AllocatePaletteBuffer()
+// A frame the same as the one before isn't drawn again, so the frame
+// bitmap has to keep what it holds. It isn't preserved when the display is
+// lost. That's only right because the game calls InvalidateFrame when the
+// display is found again, or drawing resumes, so the next frame is drawn
+// in full. Don't drop those calls without dropping this flag.
+
+static bool CreateFrameBitmap( bool linear )
 {
-    int format = al_get_bitmap_format( paletteBmp );
-    ALLEGRO_LOCKED_REGION*  region = al_lock_bitmap( paletteBmp, format, ALLEGRO_LOCK_WRITEONLY );
-    if ( region == nullptr )
-        return false;
-    int stride = region->pitch;
-    al_unlock_bitmap( paletteBmp );
+    int savedFlags = al_get_new_bitmap_flags();
+    int flags = savedFlags | ALLEGRO_NO_PRESERVE_TEXTURE;
 
-    if ( stride < 0 )
-        stride = -stride;
+    if ( linear )
+        flags |= ALLEGRO_MIN_LINEAR | ALLEGRO_MAG_LINEAR;
 
-    paletteBufSize = stride * PaletteBmpHeight;
-    paletteStride = stride;
+    al_set_new_bitmap_flags( flags );
+    ALLEGRO_BITMAP* bitmap = al_create_bitmap( StdViewWidth, StdViewHeight );
+    al_set_new_bitmap_flags( savedFlags );
 
-    paletteBuf = new unsigned char[paletteBufSize];
-    if ( paletteBuf == nullptr )
+    if ( bitmap == nullptr )
         return false;
 
-    memset( paletteBuf, 0, paletteBufSize );
+    if ( frameBmp != nullptr )
+        al_destroy_bitmap( frameBmp );
+
+    frameBmp = bitmap;
+    frameDirty = true;
     return true;
 }
 
+static ALLEGRO_SHADER* BuildOptionalShader( const char* vsource, const char* psource )
+{
+    ALLEGRO_SHADER* shader = al_create_shader( ALLEGRO_SHADER_AUTO );
+    if ( shader == nullptr )
+        return nullptr;
+
+    if ( !al_attach_shader_source_file( shader, ALLEGRO_VERTEX_SHADER, vsource )
+        || !al_attach_shader_source_file( shader, ALLEGRO_PIXEL_SHADER, psource )
+        || !al_build_shader( shader ) )
+    {
+        _RPT1( _CRT_WARN, "%s", al_get_shader_log( shader ) );
+        al_destroy_shader( shader );
+        return nullptr;
+    }
+
+    return shader;
+}
+
 bool Graphics::Init()
 {
     const char* vsource = nullptr;
     const char* psource = nullptr;
+    const char* mapPsource = nullptr;
+    const char* presentPsource = nullptr;
+
+    if ( !al_init_primitives_addon() )
+        return false;
 
     paletteBmp = al_create_bitmap( PaletteBmpWidth, PaletteBmpHeight );
     if ( paletteBmp == nullptr )
         return false;
 
+    drawVertexes = new ALLEGRO_VERTEX[MaxDrawCommands * VertexesPerDraw];
+
+    // The palette shader reads the palette from the tint's red channel.
+    for ( int i = 0; i < PaletteCount; i++ )
+    {
+        paletteTints[i] = al_map_rgba_f( i / (float) PaletteBmpHeight, 0, 0, 1 );
+    }
+
+    effectBmp = al_create_bitmap( PaletteBmpWidth, EffectBmpHeight );
+    if ( effectBmp == nullptr )
+        return false;
+
     tileShader = al_create_shader( ALLEGRO_SHADER_AUTO );
     if ( tileShader == nullptr )
         return false;
 
-    if ( !ChooseShaderSource( tileShader, &vsource, &psource ) )
+    if ( !ChooseShaderSource( tileShader, &vsource, &psource, &mapPsource, &presentPsource ) )
         return false;
 
     if ( !al_attach_shader_source_file( tileShader, ALLEGRO_VERTEX_SHADER, vsource ) )
@@ -125,167 +394,1609 @@ bool Graphics::Init()
         return false;
     }
 
-    if ( !al_use_shader( tileShader ) )
+    tileMapShader = BuildOptionalShader( vsource, mapPsource );
+    presentShader = BuildOptionalShader( vsource, presentPsource );
+
+    if ( !CreateFrameBitmap( false ) )
+        return false;
+
+    // Shaders belong to the target bitmap.
+    al_set_target_bitmap( frameBmp );
+    bool used = al_use_shader( tileShader );
+    al_set_target_backbuffer( al_get_current_display() );
+
+    return used;
+}
+
+bool Graphics::InitHeadless()
+{
+    headless = true;
+    return true;
+}
+
+bool Graphics::InitSoftware()
+{
+    headless = true;
+    software = true;
+    return true;
+}
+
+bool Graphics::IsHeadless()
+{
+    return headless;
+}
+
+bool Graphics::IsSoftware()
+{
+    return software;
+}
+
+void Graphics::SetAtlasEnabled( bool enable )
+{
+    assert( cachedSheetCount == 0 );
+    atlasEnabled = enable;
+}
+
+// Sharp bilinear filtering needs the frame to be filtered linearly.
+
+bool Graphics::SetSharpScaling( bool enable )
+{
+    if ( headless )
+        return false;
+
+    if ( enable && presentShader == nullptr )
+        return false;
+
+    if ( !CreateFrameBitmap( enable ) )
+        return false;
+
+    sharpScaling = enable;
+    return true;
+}
+
+void Graphics::GetDrawStats( DrawStats& stats )
+{
+    stats = drawStats;
+
+    std::lock_guard<std::mutex> lock( cacheLock );
+
+    stats.AtlasPages = atlasPageCount;
+    stats.SeparateSheets = 0;
+
+    for ( int i = 0; i < cachedSheetCount; i++ )
+    {
+        if ( !al_is_sub_bitmap( cachedSheets[i].bitmap ) )
+            stats.SeparateSheets++;
+    }
+}
+
+void Graphics::ResetDrawStats()
+{
+    drawStats = DrawStats();
+}
+
+Graphics::Context* Graphics::CreateContext()
+{
+    Context* context = new Context();
+    return context;
+}
+
+void Graphics::DestroyContext( Context* context )
+{
+    delete context;
+}
+
+size_t Graphics::GetContextSize()
+{
+    return sizeof( Context );
+}
+
+void Graphics::SetContext( Context* context )
+{
+    ctx = context;
+
+    // Headless worlds run on many threads, and have no shader.
+    if ( !headless )
+        paletteUniformsStale = true;
+}
+
+// The palette shader rounds the red channel to the nearest of 16 steps.
+
+static void DecodeSheet( ALLEGRO_BITMAP* bitmap, IndexedSheet& sheet )
+{
+    int width = al_get_bitmap_width( bitmap );
+    int height = al_get_bitmap_height( bitmap );
+
+    ALLEGRO_LOCKED_REGION* region = al_lock_bitmap( 
+        bitmap, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_READONLY );
+    assert( region != nullptr );
+    if ( region == nullptr )
+        return;
+
+    sheet.indexes = new uint8_t[width * height];
+    sheet.width = width;
+    sheet.height = height;
+
+    for ( int y = 0; y < height; y++ )
+    {
+        // Pixels are R, G, B, A bytes in memory.
+        const uint8_t* row = (const uint8_t*) region->data + y * region->pitch;
+        uint8_t* indexes = sheet.indexes + y * width;
+
+        for ( int x = 0; x < width; x++ )
+        {
+            int index = (row[x * 4] * 32 + 255) / 510;
+            indexes[x] = Util::Min( index, PaletteBmpWidth - 1 );
+        }
+    }
+
+    al_unlock_bitmap( bitmap );
+}
+
+static bool CopyPixels( ALLEGRO_BITMAP* src, ALLEGRO_BITMAP* dest, int destX, int destY )
+{
+    int width = al_get_bitmap_width( src );
+    int height = al_get_bitmap_height( src );
+
+    ALLEGRO_LOCKED_REGION* srcRegion = al_lock_bitmap( 
+        src, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_READONLY );
+    if ( srcRegion == nullptr )
         return false;
 
-    if ( !AllocatePaletteBuffer() )
+    ALLEGRO_LOCKED_REGION* destRegion = al_lock_bitmap_region( 
+        dest, destX, destY, width, height, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_WRITEONLY );
+    if ( destRegion == nullptr )
+    {
+        al_unlock_bitmap( src );
         return false;
+    }
+
+    for ( int y = 0; y < height; y++ )
+    {
+        memcpy( 
+            (uint8_t*) destRegion->data + y * destRegion->pitch,
+            (const uint8_t*) srcRegion->data + y * srcRegion->pitch,
+            width * 4 );
+    }
 
+    al_unlock_bitmap( dest );
+    al_unlock_bitmap( src );
     return true;
 }
 
+// Returns a sub-bitmap of an atlas page with a copy of the bitmap, or null
+// if it doesn't fit. Drawing sub-bitmaps of one page doesn't cut a batch.
+
+static ALLEGRO_BITMAP* AddToAtlas( ALLEGRO_BITMAP* bitmap )
+{
+    int width = al_get_bitmap_width( bitmap );
+    int height = al_get_bitmap_height( bitmap );
+
+    if ( width > AtlasSize || height > AtlasSize )
+        return nullptr;
+
+    if ( atlasShelfX + width > AtlasSize )
+    {
+        atlasShelfX = 0;
+        atlasShelfY += atlasShelfHeight;
+        atlasShelfHeight = 0;
+    }
+
+    if ( atlasPageCount == 0 || atlasShelfY + height > AtlasSize )
+    {
+        if ( atlasPageCount == MaxAtlasPages )
+            return nullptr;
+
+        ALLEGRO_BITMAP* page = al_create_bitmap( AtlasSize, AtlasSize );
+        if ( page == nullptr )
+            return nullptr;
+
+        atlasPages[atlasPageCount++] = page;
+        atlasShelfX = 0;
+        atlasShelfY = 0;
+        atlasShelfHeight = 0;
+    }
+
+    ALLEGRO_BITMAP* page = atlasPages[atlasPageCount - 1];
+
+    if ( !CopyPixels( bitmap, page, atlasShelfX, atlasShelfY ) )
+        return nullptr;
+
+    ALLEGRO_BITMAP* sub = al_create_sub_bitmap( page, atlasShelfX, atlasShelfY, width, height );
+    if ( sub == nullptr )
+        return nullptr;
+
+    atlasShelfX += width;
+    atlasShelfHeight = Util::Max( atlasShelfHeight, height );
+
+    return sub;
+}
+
+static CachedSheet* LoadCachedSheet( const char* path )
+{
+    std::lock_guard<std::mutex> lock( cacheLock );
+
+    for ( int i = 0; i < cachedSheetCount; i++ )
+    {
+        if ( 0 == strcmp( cachedSheets[i].path, path ) )
+            return &cachedSheets[i];
+    }
+
+    assert( cachedSheetCount < MaxCachedSheets );
+    if ( cachedSheetCount >= MaxCachedSheets )
+        return nullptr;
+
+    ALLEGRO_BITMAP* bitmap = al_load_bitmap( path );
+    assert( bitmap != nullptr );
+
+    if ( bitmap == nullptr )
+    {
+        bitmap = al_create_bitmap( 1, 1 );
+    }
+
+    CachedSheet& entry = cachedSheets[cachedSheetCount++];
+    strcpy_s( entry.path, path );
+    entry.bitmap = bitmap;
+
+    if ( software )
+    {
+        DecodeSheet( bitmap, entry.indexed );
+    }
+    else if ( atlasEnabled )
+    {
+        ALLEGRO_BITMAP* sub = AddToAtlas( bitmap );
+        if ( sub != nullptr )
+        {
+            al_destroy_bitmap( bitmap );
+            entry.bitmap = sub;
+        }
+    }
+
+    return &entry;
+}
+
+static const IndexedSheet* FindIndexedSheet( ALLEGRO_BITMAP* bitmap )
+{
+    std::lock_guard<std::mutex> lock( cacheLock );
+
+    for ( int i = 0; i < cachedSheetCount; i++ )
+    {
+        if ( cachedSheets[i].bitmap == bitmap )
+            return &cachedSheets[i].indexed;
+    }
+
+    return nullptr;
+}
+
+static Util::Table<SpriteAnim>* LoadCachedAnims( const char* path )
+{
+    std::lock_guard<std::mutex> lock( cacheLock );
+
+    for ( int i = 0; i < cachedAnimsCount; i++ )
+    {
+        if ( 0 == strcmp( cachedAnims[i].path, path ) )
+            return &cachedAnims[i].anims;
+    }
+
+    assert( cachedAnimsCount < MaxCachedSheets );
+    if ( cachedAnimsCount >= MaxCachedSheets )
+        return nullptr;
+
+    CachedAnims& entry = cachedAnims[cachedAnimsCount++];
+    strcpy_s( entry.path, path );
+    Util::LoadResource( path, &entry.anims );
+
+    return &entry.anims;
+}
+
 void Graphics::LoadTileSheet( int slot, const char* path )
 {
-    if ( tileSheets[slot] != nullptr )
+    if ( headless && !software )
+        return;
+
+    CachedSheet* entry = LoadCachedSheet( path );
+    if ( entry == nullptr )
+        return;
+
+    ctx->tileSheets[slot] = entry->bitmap;
+    ctx->indexedSheets[slot] = &entry->indexed;
+}
+
+void Graphics::LoadTileSheet( int slot, const char* imagePath, const char* animPath )
+{
+    LoadTileSheet( slot, imagePath );
+    ctx->animSpecs[slot] = LoadCachedAnims( animPath );
+}
+
+ALLEGRO_BITMAP* Graphics::LoadSharedBitmap( const char* path )
+{
+    if ( headless && !software )
+        return nullptr;
+
+    CachedSheet* entry = LoadCachedSheet( path );
+    if ( entry == nullptr )
+        return nullptr;
+
+    return entry->bitmap;
+}
+
+const SpriteAnim* Graphics::GetAnimation( int slot, int animIndex )
+{
+    return ctx->animSpecs[slot]->GetItem( animIndex );
+}
+
+ALLEGRO_BITMAP* Graphics::GetTileSheet( int slot )
+{
+    assert( slot < Sheet_Max );
+    return ctx->tileSheets[slot];
+}
+
+void Graphics::LoadSystemPalette( const int* colorsArgb8 )
+{
+    memcpy( ctx->systemPalette, colorsArgb8, sizeof ctx->systemPalette );
+
+    for ( int i = 0; i < SysPaletteLength; i++ )
+    {
+        ctx->grayscalePalette[i] = ctx->systemPalette[i & 0x30];
+    }
+}
+
+static const int* GetActiveSystemPalette()
+{
+    return ctx->grayscale ? ctx->grayscalePalette : ctx->systemPalette;
+}
+
+ALLEGRO_COLOR Graphics::GetSystemColor( int sysColor )
+{
+    int argb8 = GetActiveSystemPalette()[sysColor];
+    return al_map_rgba( 
+        (argb8 >> 16) & 0xFF,
+        (argb8 >>  8) & 0xFF,
+        (argb8 >>  0) & 0xFF,
+        (argb8 >> 24) & 0xFF
+        );
+}
+
+// TODO: this method has to consider the picture format
+void Graphics::SetColor( int paletteIndex, int colorIndex, int colorArgb8 )
+{
+    assert( paletteIndex < PaletteCount );
+
+    ctx->paletteColors[paletteIndex][colorIndex] = colorArgb8;
+    ctx->changedPaletteRows |= 1 << paletteIndex;
+}
+
+void Graphics::SetPalette( int paletteIndex, const int* colorsArgb8 )
+{
+    assert( paletteIndex < PaletteCount );
+
+    int* line = ctx->paletteColors[paletteIndex];
+
+    for ( int x = 0; x < PaletteLength; x++ )
+    {
+        line[x] = colorsArgb8[x];
+    }
+
+    ctx->changedPaletteRows |= 1 << paletteIndex;
+}
+
+void Graphics::SetColorIndexed( int paletteIndex, int colorIndex, int sysColor )
+{
+    int colorArgb8 = 0;
+    if ( colorIndex != 0 )
+        colorArgb8 = GetActiveSystemPalette()[sysColor];
+    SetColor( paletteIndex, colorIndex, colorArgb8 );
+    ctx->palettes[paletteIndex][colorIndex] = sysColor;
+}
+
+void Graphics::SetPaletteIndexed( int paletteIndex, const uint8_t* sysColors )
+{
+    const int* activeSystemPalette = GetActiveSystemPalette();
+    int colorsArgb8[4] = 
+    {
+        0,
+        activeSystemPalette[sysColors[1]],
+        activeSystemPalette[sysColors[2]],
+        activeSystemPalette[sysColors[3]],
+    };
+    SetPalette( paletteIndex, colorsArgb8 );
+    memcpy( ctx->palettes[paletteIndex], sysColors, PaletteLength );
+}
+
+static uint32_t GetEffectRows()
+{
+    return ((1u << ctx->effectEnd) - 1) & ~((1u << ctx->effectFirst) - 1);
+}
+
+// The palette in the other set is what SwitchSystemPalette would make.
+
+static void CommitPalette( int paletteIndex )
+{
+    int activeRow = paletteIndex + (ctx->grayscale ? PaletteCount : 0);
+    int otherRow = paletteIndex + (ctx->grayscale ? 0 : PaletteCount);
+    const int* otherSystemPalette = ctx->grayscale ? ctx->systemPalette : ctx->grayscalePalette;
+    int* otherColors = ctx->committedColors[otherRow];
+
+    memcpy( ctx->committedColors[activeRow], ctx->paletteColors[paletteIndex],
+        sizeof ctx->committedColors[activeRow] );
+
+    memset( otherColors, 0, sizeof ctx->committedColors[otherRow] );
+
+    for ( int i = 1; i < PaletteLength; i++ )
+    {
+        otherColors[i] = otherSystemPalette[ctx->palettes[paletteIndex][i]];
+    }
+}
+
+void Graphics::UpdatePalettes()
+{
+    if ( headless )
+        return;
+
+    uint32_t rows = ctx->changedPaletteRows;
+
+    // Effect palettes stop being shown once any of them is changed. The
+    // others in the effect are also uploaded, as the palette buffer still
+    // has what they were before the effect.
+    if ( (rows & GetEffectRows()) != 0 )
+    {
+        rows |= GetEffectRows();
+        ctx->effectFirst = 0;
+        ctx->effectEnd = 0;
+        paletteUniformsStale = true;
+    }
+
+    for ( int y = 0; y < PaletteCount; y++ )
+    {
+        if ( (rows & (1u << y)) != 0 )
+        {
+            CommitPalette( y );
+            ctx->pendingPaletteRows |= (1u << y) | (1u << (y + PaletteCount));
+        }
+    }
+
+    ctx->changedPaletteRows = 0;
+}
+
+void Graphics::UpdateAllPalettes()
+{
+    if ( headless )
+        return;
+
+    ctx->changedPaletteRows = (1u << PaletteCount) - 1;
+    ctx->effectPalettesChanged = true;
+    paletteUniformsStale = true;
+
+    // Commit everything, but keep showing effect palettes.
+    int effectFirst = ctx->effectFirst;
+    int effectEnd = ctx->effectEnd;
+
+    ctx->effectFirst = 0;
+    ctx->effectEnd = 0;
+    UpdatePalettes();
+    ctx->effectFirst = effectFirst;
+    ctx->effectEnd = effectEnd;
+}
+
+void Graphics::LoadEffectPalettes( const uint8_t (*sysColors)[PaletteLength], int count )
+{
+    assert( count <= MaxEffectPalettes );
+    count = Util::Min( count, MaxEffectPalettes );
+
+    memcpy( ctx->effectPalettes, sysColors, count * PaletteLength );
+    ctx->effectPaletteCount = count;
+    ctx->effectPalettesChanged = true;
+}
+
+void Graphics::SetEffectPalettes( int firstPalette, int effectIndex, int count )
+{
+    assert( effectIndex + count <= ctx->effectPaletteCount );
+    assert( firstPalette + count <= PaletteCount );
+
+    const int* activeSystemPalette = GetActiveSystemPalette();
+
+    for ( int i = 0; i < count; i++ )
+    {
+        const uint8_t* sysColors = ctx->effectPalettes[effectIndex + i];
+        int* line = ctx->paletteColors[firstPalette + i];
+
+        line[0] = 0;
+        for ( int j = 1; j < PaletteLength; j++ )
+        {
+            line[j] = activeSystemPalette[sysColors[j]];
+        }
+
+        memcpy( ctx->palettes[firstPalette + i], sysColors, PaletteLength );
+    }
+
+    // The palette buffer isn't touched. Changes to these palettes made
+    // before, and not yet committed, are replaced.
+    ctx->effectFirst = firstPalette;
+    ctx->effectEnd = firstPalette + count;
+    ctx->effectBase = effectIndex;
+    ctx->changedPaletteRows &= ~GetEffectRows();
+
+    if ( !headless )
+        paletteUniformsStale = true;
+}
+
+// Rows are copied in memory order, as the palette shader samples the
+// texture directly. So, if the bitmap's rows go up in memory, then palette
+// rows are stored from the bottom of the bitmap.
+//
+// Only the bitmap rows from the first to the last pending palette row are
+// locked. They're all written, because a write-only lock keeps nothing.
+
+static void UploadPalettes()
+{
+    uint32_t rows = ctx->pendingPaletteRows;
+    int first = 0;
+    int last = PaletteBmpHeight - 1;
+
+    ctx->pendingPaletteRows = 0;
+
+    if ( paletteRowsFlipped >= 0 )
+    {
+        while ( (rows & (1u << first)) == 0 )
+            first++;
+        while ( (rows & (1u << last)) == 0 )
+            last--;
+    }
+
+    int top = first;
+    int bottom = last;
+
+    if ( paletteRowsFlipped == 1 )
+    {
+        top = PaletteBmpHeight - 1 - last;
+        bottom = PaletteBmpHeight - 1 - first;
+    }
+
+    int format = al_get_bitmap_format( paletteBmp );
+    ALLEGRO_LOCKED_REGION*  region = al_lock_bitmap_region( 
+        paletteBmp, 0, top, PaletteBmpWidth, bottom - top + 1, format, ALLEGRO_LOCK_WRITEONLY );
+    assert( region != nullptr );
+    if ( region == nullptr )
+        return;
+
+    if ( paletteRowsFlipped < 0 )
+        paletteRowsFlipped = region->pitch < 0 ? 1 : 0;
+
+    for ( int y = first; y <= last; y++ )
+    {
+        int bitmapY = (paletteRowsFlipped == 1) ? PaletteBmpHeight - 1 - y : y;
+        unsigned char* line = (unsigned char*) region->data + (bitmapY - top) * region->pitch;
+
+        memcpy( line, ctx->committedColors[y], sizeof ctx->committedColors[y] );
+        memcpy( uploadedColors[y], ctx->committedColors[y], sizeof uploadedColors[y] );
+        uploadedPaletteRows |= 1u << y;
+    }
+
+    al_unlock_bitmap( paletteBmp );
+
+    drawStats.PaletteUploads++;
+}
+
+// The grayscale effect palettes start halfway down.
+
+static void MakeEffectColors()
+{
+    memset( effectColors, 0, sizeof effectColors );
+
+    for ( int y = 0; y < EffectBmpHeight; y++ )
+    {
+        int* line = effectColors[y];
+        int effectIndex = y % MaxEffectPalettes;
+        const int* systemPalette = (y < MaxEffectPalettes) ? ctx->systemPalette : ctx->grayscalePalette;
+
+        if ( effectIndex >= ctx->effectPaletteCount )
+            continue;
+
+        for ( int i = 1; i < PaletteLength; i++ )
+        {
+            line[i] = systemPalette[ctx->effectPalettes[effectIndex][i]];
+        }
+    }
+}
+
+// Like the palette buffer, but all of it is written, in memory order. The
+// colors come from MakeEffectColors.
+
+static void UploadEffectPalettes()
+{
+    ctx->effectPalettesChanged = false;
+
+    int format = al_get_bitmap_format( effectBmp );
+    ALLEGRO_LOCKED_REGION*  region = al_lock_bitmap( effectBmp, format, ALLEGRO_LOCK_WRITEONLY );
+    assert( region != nullptr );
+    if ( region == nullptr )
+        return;
+
+    unsigned char* base = (unsigned char*) region->data;
+    int stride = region->pitch;
+    if ( stride < 0 )
+    {
+        base += stride * (EffectBmpHeight - 1);
+        stride = -stride;
+    }
+
+    for ( int y = 0; y < EffectBmpHeight; y++ )
+    {
+        memcpy( base + y * stride, effectColors[y], sizeof effectColors[y] );
+    }
+
+    al_unlock_bitmap( effectBmp );
+
+    memcpy( uploadedEffectColors, effectColors, sizeof uploadedEffectColors );
+    effectColorsUploaded = true;
+
+    drawStats.PaletteUploads++;
+}
+
+// Sets the palette textures and effects for the current shader.
+
+static void SetPaletteUniforms()
+{
+    bool bRet;
+
+    bRet = al_set_shader_sampler( "palTex", paletteBmp, 1 );
+    assert( bRet );
+
+    al_set_shader_sampler( "effectTex", effectBmp, 3 );
+    al_set_shader_float( "grayscale", ctx->grayscale ? 1.0f : 0.0f );
+    al_set_shader_float( "effectFirst", (float) ctx->effectFirst );
+    al_set_shader_float( "effectEnd", (float) ctx->effectEnd );
+    al_set_shader_float( "effectBase", (float) ctx->effectBase );
+}
+
+// Textures can be bigger than their bitmaps, such as when the GPU needs
+// sizes that are powers of two.
+
+static void GetTextureSize( ALLEGRO_BITMAP* bitmap, int* width, int* height )
+{
+#if _WIN32
+    if ( al_get_shader_platform( tileShader ) == ALLEGRO_SHADER_HLSL )
+    {
+        al_get_d3d_texture_size( bitmap, width, height );
+        return;
+    }
+#endif
+    al_get_opengl_texture_size( bitmap, width, height );
+}
+
+static void DrawTileGridNow(
+    ALLEGRO_BITMAP* gridBitmap,
+    ALLEGRO_BITMAP* sheet,
+    int firstCol,
+    int firstRow,
+    int columns,
+    int rows,
+    int destX,
+    int destY )
+{
+    // The sheet can be part of an atlas page.
+    ALLEGRO_BITMAP* texture = sheet;
+    float sheetOrigin[2] = { 0, 0 };
+    int texWidth;
+    int texHeight;
+
+    if ( al_is_sub_bitmap( sheet ) )
+    {
+        texture = al_get_parent_bitmap( sheet );
+        sheetOrigin[0] = (float) al_get_bitmap_x( sheet );
+        sheetOrigin[1] = (float) al_get_bitmap_y( sheet );
+    }
+
+    GetTextureSize( texture, &texWidth, &texHeight );
+
+    float sheetSize[4] = 
+    {
+        (float) al_get_bitmap_width( texture ),
+        (float) al_get_bitmap_height( texture ),
+        (float) texWidth,
+        (float) texHeight,
+    };
+
+    // Switching shaders flushes held draws, so that they stay in order.
+    bool held = al_is_bitmap_drawing_held();
+    if ( held )
+        al_hold_bitmap_drawing( false );
+
+    al_use_shader( tileMapShader );
+    SetPaletteUniforms();
+    al_set_shader_sampler( "sheetTex", texture, 2 );
+    al_set_shader_float_vector( "sheetSize", 4, sheetSize, 1 );
+    al_set_shader_float_vector( "sheetOrigin", 2, sheetOrigin, 1 );
+
+    al_draw_scaled_bitmap(
+        gridBitmap,
+        firstCol,
+        firstRow,
+        columns,
+        rows,
+        destX,
+        destY,
+        columns * TileWidth,
+        rows * TileHeight,
+        0 );
+
+    al_use_shader( tileShader );
+    SetPaletteUniforms();
+
+    drawStats.Batches++;
+    batchTexture = nullptr;
+
+    if ( held )
+        al_hold_bitmap_drawing( true );
+}
+
+static void GetBounds( const DrawCommand& command, int& left, int& top, int& right, int& bottom )
+{
+    if ( command.kind == Draw_Clear )
+    {
+        const int* rect = drawClips[command.clip];
+
+        left = rect[0];
+        top = rect[1];
+        right = left + rect[2];
+        bottom = top + rect[3];
+        return;
+    }
+
+    int width = command.width;
+    int height = command.height;
+
+    if ( command.kind == Draw_TileGrid )
+    {
+        width *= TileWidth;
+        height *= TileHeight;
+    }
+
+    left = command.destX;
+    top = command.destY;
+    right = left + width;
+    bottom = top + height;
+}
+
+static bool Overlaps( const DrawBatch& batch, int left, int top, int right, int bottom )
+{
+    return left < batch.right && batch.left < right
+        && top < batch.bottom && batch.top < bottom;
+}
+
+// A command joins the last batch with its texture and clip, if it doesn't
+// overlap any command in a batch after that one. Otherwise, it starts a
+// batch of its own. So, batches are drawn in an order that keeps the order
+// the commands were recorded in, where it matters. Clears and tile grids
+// are always batches of their own.
+
+static int AssignBatches()
+{
+    int batchCount = 0;
+
+    for ( int i = 0; i < drawCommandCount; i++ )
+    {
+        DrawCommand& command = drawCommands[i];
+        int left;
+        int top;
+        int right;
+        int bottom;
+        int b = -1;
+
+        GetBounds( command, left, top, right, bottom );
+
+        if ( command.kind == Draw_Bitmap )
+        {
+            for ( b = batchCount - 1; b >= 0; b-- )
+            {
+                const DrawBatch& batch = drawBatches[b];
+
+                if ( batch.kind == Draw_Bitmap 
+                    && batch.texture == command.texture 
+                    && batch.clip == command.clip )
+                    break;
+                if ( Overlaps( batch, left, top, right, bottom ) )
+                {
+                    b = -1;
+                    break;
+                }
+            }
+        }
+
+        if ( b < 0 )
+        {
+            b = batchCount++;
+
+            DrawBatch& batch = drawBatches[b];
+            batch.texture = command.texture;
+            batch.kind = command.kind;
+            batch.clip = command.clip;
+            batch.count = 0;
+            batch.left = left;
+            batch.top = top;
+            batch.right = right;
+            batch.bottom = bottom;
+        }
+
+        DrawBatch& batch = drawBatches[b];
+        batch.count++;
+        batch.left = Util::Min( batch.left, left );
+        batch.top = Util::Min( batch.top, top );
+        batch.right = Util::Max( batch.right, right );
+        batch.bottom = Util::Max( batch.bottom, bottom );
+
+        command.batch = b;
+    }
+
+    return batchCount;
+}
+
+static void SetVertex( ALLEGRO_VERTEX& vertex, int x, int y, int u, int v, ALLEGRO_COLOR color )
+{
+    vertex.x = (float) x;
+    vertex.y = (float) y;
+    vertex.z = 0;
+    vertex.u = (float) u;
+    vertex.v = (float) v;
+    vertex.color = color;
+}
+
+static void MakeVertexes( const DrawCommand& command, ALLEGRO_VERTEX* vertexes )
+{
+    ALLEGRO_COLOR color = paletteTints[command.palette];
+    int x1 = command.destX;
+    int y1 = command.destY;
+    int x2 = x1 + command.width;
+    int y2 = y1 + command.height;
+    int u1 = command.srcX;
+    int v1 = command.srcY;
+    int u2 = u1 + command.width;
+    int v2 = v1 + command.height;
+
+    if ( (command.flags & ALLEGRO_FLIP_HORIZONTAL) != 0 )
+        std::swap( u1, u2 );
+    if ( (command.flags & ALLEGRO_FLIP_VERTICAL) != 0 )
+        std::swap( v1, v2 );
+
+    SetVertex( vertexes[0], x1, y1, u1, v1, color );
+    SetVertex( vertexes[1], x2, y1, u2, v1, color );
+    SetVertex( vertexes[2], x1, y2, u1, v2, color );
+    SetVertex( vertexes[3], x2, y1, u2, v1, color );
+    SetVertex( vertexes[4], x2, y2, u2, v2, color );
+    SetVertex( vertexes[5], x1, y2, u1, v2, color );
+}
+
+static void SetDrawClip( int clip )
+{
+    const int* rect = drawClips[clip];
+    al_set_clipping_rectangle( rect[0], rect[1], rect[2], rect[3] );
+}
+
+static void SubmitBatch( const DrawBatch& batch )
+{
+    if ( batch.kind == Draw_Clear )
+    {
+        // A clear is alone in its batch, and has no vertexes.
+        const DrawCommand& command = drawCommands[batch.firstVertex];
+
+        if ( command.srcX < 0 )
+            al_clear_to_color( al_map_rgb( 0, 0, 0 ) );
+        else
+            al_clear_to_color( Graphics::GetSystemColor( command.srcX ) );
+    }
+    else if ( batch.kind == Draw_TileGrid )
+    {
+        const DrawCommand& command = drawCommands[batch.firstVertex];
+
+        DrawTileGridNow( 
+            command.texture, 
+            command.sheet, 
+            command.srcX, 
+            command.srcY, 
+            command.width, 
+            command.height, 
+            command.destX, 
+            command.destY );
+    }
+    else
+    {
+        al_draw_prim( 
+            &drawVertexes[batch.firstVertex], 
+            nullptr, 
+            batch.texture, 
+            0, 
+            batch.count * VertexesPerDraw, 
+            ALLEGRO_PRIM_TRIANGLE_LIST );
+
+        drawStats.Batches++;
+    }
+}
+
+// Draws the recorded commands, and leaves the clip rectangle as the last
+// one recorded.
+
+static void SubmitDraws()
+{
+    if ( drawCommandCount == 0 )
+        return;
+
+    int batchCount = AssignBatches();
+    int vertexCount = 0;
+
+    // Batches that aren't drawn from vertexes keep the index of their
+    // command instead.
+    for ( int i = 0; i < drawCommandCount; i++ )
+    {
+        DrawBatch& batch = drawBatches[drawCommands[i].batch];
+
+        if ( batch.kind != Draw_Bitmap )
+            batch.firstVertex = i;
+    }
+
+    for ( int b = 0; b < batchCount; b++ )
+    {
+        DrawBatch& batch = drawBatches[b];
+
+        if ( batch.kind != Draw_Bitmap )
+            continue;
+
+        batch.firstVertex = vertexCount;
+        vertexCount += batch.count * VertexesPerDraw;
+        batch.count = 0;
+    }
+
+    for ( int i = 0; i < drawCommandCount; i++ )
+    {
+        const DrawCommand& command = drawCommands[i];
+        DrawBatch& batch = drawBatches[command.batch];
+
+        if ( command.kind != Draw_Bitmap )
+            continue;
+
+        int vertex = batch.firstVertex + batch.count * VertexesPerDraw;
+
+        MakeVertexes( command, &drawVertexes[vertex] );
+        batch.count++;
+    }
+
+    int lastClip = drawClipCount - 1;
+    int clip = lastClip;
+
+    for ( int b = 0; b < batchCount; b++ )
+    {
+        const DrawBatch& batch = drawBatches[b];
+
+        if ( batch.clip != clip )
+        {
+            clip = batch.clip;
+            SetDrawClip( clip );
+        }
+
+        SubmitBatch( batch );
+    }
+
+    if ( clip != lastClip )
+        SetDrawClip( lastClip );
+
+    drawCommandCount = 0;
+
+    memcpy( drawClips[0], drawClips[lastClip], sizeof drawClips[0] );
+    drawClipCount = 1;
+
+    // A frame drawn in parts can't be skipped, as the part drawn already
+    // is gone from the buffer.
+    frameDirty = true;
+}
+
+// FNV-1a, over the fields of commands and clip rectangles.
+
+static void HashValue( const void* value, size_t size )
+{
+    const uint8_t* bytes = (const uint8_t*) value;
+
+    for ( size_t i = 0; i < size; i++ )
+    {
+        frameHash ^= bytes[i];
+        frameHash *= 0x100000001B3ull;
+    }
+}
+
+static void HashCommand( const DrawCommand& command )
+{
+    const int16_t shorts[6] = 
+    { 
+        command.srcX, 
+        command.srcY, 
+        command.width, 
+        command.height, 
+        command.destX, 
+        command.destY 
+    };
+    const uint8_t bytes[4] = { command.palette, command.flags, command.clip, command.kind };
+
+    HashValue( &command.texture, sizeof command.texture );
+    HashValue( &command.sheet, sizeof command.sheet );
+    HashValue( shorts, sizeof shorts );
+    HashValue( bytes, sizeof bytes );
+}
+
+static void RecordClip()
+{
+    if ( !recordingDraws )
+        return;
+
+    int rect[4];
+
+    al_get_clipping_rectangle( &rect[0], &rect[1], &rect[2], &rect[3] );
+
+    if ( drawClipCount > 0 && memcmp( rect, drawClips[drawClipCount - 1], sizeof rect ) == 0 )
+        return;
+
+    if ( drawClipCount == MaxDrawClips )
+    {
+        // Commands refer to clips by index, so these have to be drawn first.
+        // Submitting leaves the last clip as the only one.
+        SubmitDraws();
+        drawClipCount = 0;
+    }
+
+    memcpy( drawClips[drawClipCount], rect, sizeof rect );
+    drawClipCount++;
+
+    HashValue( rect, sizeof rect );
+}
+
+static DrawCommand& AddCommand( DrawKind kind, ALLEGRO_BITMAP* texture )
+{
+    if ( drawCommandCount == MaxDrawCommands )
+        SubmitDraws();
+
+    DrawCommand& command = drawCommands[drawCommandCount++];
+
+    command = DrawCommand();
+    command.kind = kind;
+    command.texture = texture;
+    command.clip = drawClipCount - 1;
+    return command;
+}
+
+static void RecordDraw( 
+    ALLEGRO_BITMAP* bitmap, 
+    int srcX, 
+    int srcY, 
+    int width, 
+    int height, 
+    int destX, 
+    int destY, 
+    int palette, 
+    int flags )
+{
+    assert( palette < PaletteCount );
+
+    // Sub-bitmaps, such as sheets in an atlas, are drawn from their parent,
+    // so that they can share batches.
+    ALLEGRO_BITMAP* texture = bitmap;
+
+    if ( al_is_sub_bitmap( bitmap ) )
+    {
+        texture = al_get_parent_bitmap( bitmap );
+        srcX += al_get_bitmap_x( bitmap );
+        srcY += al_get_bitmap_y( bitmap );
+    }
+
+    DrawCommand& command = AddCommand( Draw_Bitmap, texture );
+
+    command.srcX = srcX;
+    command.srcY = srcY;
+    command.width = width;
+    command.height = height;
+    command.destX = destX;
+    command.destY = destY;
+    command.palette = palette;
+    command.flags = flags;
+
+    HashCommand( command );
+    drawStats.Draws++;
+}
+
+static void RecordClear( int sysColor )
+{
+    DrawCommand& command = AddCommand( Draw_Clear, nullptr );
+
+    command.srcX = sysColor;
+
+    HashCommand( command );
+}
+
+static void RecordTileGrid(
+    ALLEGRO_BITMAP* gridBitmap,
+    ALLEGRO_BITMAP* sheet,
+    int firstCol,
+    int firstRow,
+    int columns,
+    int rows,
+    int destX,
+    int destY )
+{
+    DrawCommand& command = AddCommand( Draw_TileGrid, gridBitmap );
+
+    command.sheet = sheet;
+    command.srcX = firstCol;
+    command.srcY = firstRow;
+    command.width = columns;
+    command.height = rows;
+    command.destX = destX;
+    command.destY = destY;
+
+    HashCommand( command );
+}
+
+// Held and recorded draws are sent first, so that they use the palettes
+// they were made with.
+
+// Loading a snapshot, as run-ahead does every frame, makes all palettes
+// pending, though they're usually the ones the GPU already has. Those
+// uploads are dropped, so that they don't keep the frame from being seen
+// as unchanged.
+
+static void DropUploadedPalettes()
+{
+    uint32_t rows = ctx->pendingPaletteRows & uploadedPaletteRows;
+
+    for ( int y = 0; rows != 0; y++, rows >>= 1 )
+    {
+        if ( (rows & 1) != 0
+            && 0 == memcmp( uploadedColors[y], ctx->committedColors[y], sizeof uploadedColors[y] ) )
+            ctx->pendingPaletteRows &= ~(1u << y);
+    }
+
+    if ( ctx->effectPalettesChanged )
+    {
+        MakeEffectColors();
+
+        if ( effectColorsUploaded
+            && 0 == memcmp( uploadedEffectColors, effectColors, sizeof effectColors ) )
+            ctx->effectPalettesChanged = false;
+    }
+}
+
+static void FlushPalettes()
+{
+    // Layers are drawn without palettes. The uniforms are set for the
+    // palette shader when the layer ends.
+    bool setUniforms = paletteUniformsStale && layerTarget == nullptr;
+
+    if ( ctx->pendingPaletteRows == 0 && !ctx->effectPalettesChanged && !setUniforms )
+        return;
+
+    DropUploadedPalettes();
+
+    if ( ctx->pendingPaletteRows == 0 && !ctx->effectPalettesChanged && !setUniforms )
+        return;
+
+    SubmitDraws();
+    frameDirty = true;
+
+    bool held = al_is_bitmap_drawing_held();
+    if ( held )
+        al_hold_bitmap_drawing( false );
+
+    if ( ctx->pendingPaletteRows != 0 )
+        UploadPalettes();
+
+    if ( ctx->effectPalettesChanged )
+        UploadEffectPalettes();
+
+    if ( setUniforms )
+    {
+        SetPaletteUniforms();
+        paletteUniformsStale = false;
+    }
+
+    batchTexture = nullptr;
+
+    if ( held )
+        al_hold_bitmap_drawing( true );
+}
+
+void Graphics::SwitchSystemPalette( bool grayscale )
+{
+    if ( ctx->grayscale == grayscale )
+        return;
+
+    ctx->grayscale = grayscale;
+
+    if ( !headless )
+        paletteUniformsStale = true;
+
+    // Both sets of palettes are already in the palette buffer, so only
+    // palettes changed before this need uploading.
+    uint32_t changedRows = ctx->changedPaletteRows;
+
+    const int* activeSystemPalette = GetActiveSystemPalette();
+
+    for ( int i = 0; i < PaletteCount; i++ )
+    {
+        const uint8_t* sysColors = ctx->palettes[i];
+        int colorsArgb8[4] = 
+        {
+            0,
+            activeSystemPalette[sysColors[1]],
+            activeSystemPalette[sysColors[2]],
+            activeSystemPalette[sysColors[3]],
+        };
+        SetPalette( i, colorsArgb8 );
+    }
+    ctx->changedPaletteRows = changedRows;
+    UpdatePalettes();
+}
+
+void Graphics::EnableGrayscale()
+{
+    SwitchSystemPalette( true );
+}
+
+void Graphics::DisableGrayscale()
+{
+    SwitchSystemPalette( false );
+}
+
+
+//----------------------------------------------------------------------------
+//  Software renderer
+//----------------------------------------------------------------------------
+
+static uint8_t ToFrameColor( int sysColor )
+{
+    return ctx->grayscale ? (sysColor & 0x30) : sysColor;
+}
+
+// Colors that are transparent in the palette buffer are skipped, like they
+// are by the palette shader.
+
+static void MakeFrameColors( int palette, uint8_t* frameColors )
+{
+    for ( int i = 0; i < PaletteBmpWidth; i++ )
+    {
+        int colorArgb8 = ctx->paletteColors[palette][i];
+
+        if ( ((colorArgb8 >> 24) & 0xFF) == 0 )
+            frameColors[i] = Blit_Transparent;
+        else if ( i < PaletteLength && palette < PaletteCount )
+            frameColors[i] = ToFrameColor( ctx->palettes[palette][i] );
+        else
+            frameColors[i] = Frame_Black;
+    }
+}
+
+static void DrawFrameRegion(
+    const IndexedSheet* sheet,
+    int srcX, 
+    int srcY,
+    int width,
+    int height,
+    int destX,
+    int destY,
+    int palette,
+    int flags
+    )
+{
+    if ( sheet == nullptr || sheet->indexes == nullptr )
+        return;
+
+    if ( srcX < 0 || srcY < 0 || srcX + width > sheet->width || srcY + height > sheet->height )
+    {
+        assert( false );
+        return;
+    }
+
+    // Layers keep the indexes themselves.
+    static const uint8_t layerColors[Blit_IndexCount] = 
+    {
+        0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15
+    };
+
+    uint8_t frameColors[Blit_IndexCount];
+    const uint8_t* colors = frameColors;
+    uint8_t* dest = frame;
+    int destPitch = StdViewWidth;
+    int clipX = frameClipX;
+    int clipY = frameClipY;
+    int clipWidth = frameClipWidth;
+    int clipHeight = frameClipHeight;
+
+    if ( layerTarget != nullptr )
+    {
+        colors = layerColors;
+        dest = layerTarget->indexed.indexes;
+        destPitch = layerTarget->indexed.width;
+        clipX = 0;
+        clipY = 0;
+        clipWidth = layerTarget->indexed.width;
+        clipHeight = layerTarget->indexed.height;
+    }
+    else
+    {
+        MakeFrameColors( palette, frameColors );
+    }
+
+    int left = Util::Max( destX, clipX );
+    int top = Util::Max( destY, clipY );
+    int right = Util::Min( destX + width, clipX + clipWidth );
+    int bottom = Util::Min( destY + height, clipY + clipHeight );
+
+    if ( left >= right || top >= bottom )
+        return;
+
+    // Find the source pixel that lands on the top left corner of what's
+    // drawn, and which way to walk from it.
+    bool flipX = (flags & ALLEGRO_FLIP_HORIZONTAL) != 0;
+    bool flipY = (flags & ALLEGRO_FLIP_VERTICAL) != 0;
+    int colX = left - destX;
+    int rowY = top - destY;
+    int srcPitch = sheet->width;
+
+    if ( flipX )
+        colX = width - 1 - colX;
+
+    if ( flipY )
+    {
+        rowY = height - 1 - rowY;
+        srcPitch = -srcPitch;
+    }
+
+    const uint8_t* src = sheet->indexes + (srcY + rowY) * sheet->width + srcX + colX;
+
+    Blit::DrawRect( 
+        dest + top * destPitch + left,
+        destPitch,
+        src,
+        srcPitch,
+        right - left,
+        bottom - top,
+        flipX,
+        colors );
+}
+
+static void FillFrame( uint8_t color )
+{
+    for ( int y = frameClipY; y < frameClipY + frameClipHeight; y++ )
+    {
+        memset( frame + y * StdViewWidth + frameClipX, color, frameClipWidth );
+    }
+}
+
+const uint8_t* Graphics::GetFrame()
+{
+    return frame;
+}
+
+void Graphics::GetFrameArgb( uint32_t* pixelsArgb8 )
+{
+    uint32_t colorsArgb8[Blit_FrameColorCount];
+
+    memcpy( colorsArgb8, ctx->systemPalette, sizeof ctx->systemPalette );
+    colorsArgb8[Frame_Black] = 0xFF000000;
+
+    Blit::ConvertToArgb( pixelsArgb8, frame, StdViewWidth * StdViewHeight, colorsArgb8 );
+}
+
+bool Graphics::ReadFrameArgb( uint32_t* pixelsArgb8 )
+{
+    if ( software )
+    {
+        GetFrameArgb( pixelsArgb8 );
+        return true;
+    }
+
+    if ( headless )
+        return false;
+
+    ALLEGRO_LOCKED_REGION* region = al_lock_bitmap( 
+        frameBmp,
+        ALLEGRO_PIXEL_FORMAT_ARGB_8888,
+        ALLEGRO_LOCK_READONLY );
+    if ( region == nullptr )
+        return false;
+
+    for ( int y = 0; y < StdViewHeight; y++ )
+    {
+        const uint8_t* row = (const uint8_t*) region->data + y * region->pitch;
+        const uint32_t* rowPixels = (const uint32_t*) row;
+        uint32_t* dest = pixelsArgb8 + y * StdViewWidth;
+
+        for ( int x = 0; x < StdViewWidth; x++ )
+        {
+            dest[x] = rowPixels[x] | 0xFF000000;
+        }
+    }
+
+    al_unlock_bitmap( frameBmp );
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+//  Drawing
+//----------------------------------------------------------------------------
+
+// Allegro sends held draws to the GPU together, until they need another
+// texture. Only layers are drawn this way. Other draws are recorded, and
+// counted when they're submitted.
+
+static void CountDraw( ALLEGRO_BITMAP* bitmap )
+{
+    ALLEGRO_BITMAP* texture = bitmap;
+    bool held = al_is_bitmap_drawing_held();
+
+    if ( al_is_sub_bitmap( bitmap ) )
+        texture = al_get_parent_bitmap( bitmap );
+
+    drawStats.Draws++;
+
+    if ( !held || texture != batchTexture )
+        drawStats.Batches++;
+
+    batchTexture = held ? texture : nullptr;
+}
+
+void Graphics::Begin()
+{
+    if ( headless )
+        return;
+
+    al_set_target_bitmap( frameBmp );
+    al_use_shader( tileShader );
+
+    SetPaletteUniforms();
+    paletteUniformsStale = false;
+
+    recordingDraws = true;
+    drawCommandCount = 0;
+    drawClipCount = 0;
+
+    // The FNV-1a offset basis, then the palette settings that aren't in
+    // the palette textures.
+    const int paletteSettings[4] = { ctx->grayscale, ctx->effectFirst, ctx->effectEnd, ctx->effectBase };
+
+    frameHash = 0xCBF29CE484222325ull;
+    HashValue( paletteSettings, sizeof paletteSettings );
+
+    RecordClip();
+}
+
+void Graphics::End()
+{
+    if ( headless )
+        return;
+
+    // The frame bitmap already holds what an unchanged frame would draw.
+    if ( frameDirty || frameHash != lastFrameHash )
     {
-        al_destroy_bitmap( tileSheets[slot] );
-        tileSheets[slot] = nullptr;
+        SubmitDraws();
+        frameChanged = true;
     }
-
-    tileSheets[slot] = al_load_bitmap( path );
-    assert( tileSheets[slot] != nullptr );
-
-    if ( tileSheets[slot] == nullptr )
+    else
     {
-        tileSheets[slot] = al_create_bitmap( 1, 1 );
+        drawStats.UnchangedFrames++;
     }
+
+    drawCommandCount = 0;
+    recordingDraws = false;
+    lastFrameHash = frameHash;
+    frameDirty = false;
 }
 
-void Graphics::LoadTileSheet( int slot, const char* imagePath, const char* animPath )
+bool Graphics::IsFrameChanged()
 {
-    LoadTileSheet( slot, imagePath );
-    Util::LoadResource( animPath, &animSpecs[slot] );
+    return frameChanged;
 }
 
-const SpriteAnim* Graphics::GetAnimation( int slot, int animIndex )
+void Graphics::InvalidateFrame()
 {
-    return animSpecs[slot].GetItem( animIndex );
+    frameDirty = true;
 }
 
-void Graphics::LoadSystemPalette( const int* colorsArgb8 )
+void Graphics::Present()
 {
-    memcpy( systemPalette, colorsArgb8, sizeof systemPalette );
+    if ( headless )
+        return;
 
-    for ( int i = 0; i < SysPaletteLength; i++ )
-    {
-        grayscalePalette[i] = systemPalette[i & 0x30];
-    }
-}
+    frameChanged = false;
 
-ALLEGRO_COLOR Graphics::GetSystemColor( int sysColor )
-{
-    int argb8 = activeSystemPalette[sysColor];
-    return al_map_rgba( 
-        (argb8 >> 16) & 0xFF,
-        (argb8 >>  8) & 0xFF,
-        (argb8 >>  0) & 0xFF,
-        (argb8 >> 24) & 0xFF
-        );
-}
+    al_set_target_backbuffer( al_get_current_display() );
+    al_reset_clipping_rectangle();
+    al_clear_to_color( al_map_rgb( 0, 0, 0 ) );
 
-// TODO: this method has to consider the picture format
-void Graphics::SetColor( int paletteIndex, int colorIndex, int colorArgb8 )
-{
-    int y = paletteIndex;
-    int x = colorIndex;
+    if ( sharpScaling )
+    {
+        int texWidth;
+        int texHeight;
 
-    unsigned char* line = paletteBuf + y * paletteStride;
-    ((int*) line)[x] = colorArgb8;
-}
+        GetTextureSize( frameBmp, &texWidth, &texHeight );
 
-void Graphics::SetPalette( int paletteIndex, const int* colorsArgb8 )
-{
-    int y = paletteIndex;
-    unsigned char* line = paletteBuf + y * paletteStride;
+        float texSize[2] = { (float) texWidth, (float) texHeight };
 
-    for ( int x = 0; x < PaletteLength; x++ )
+        al_use_shader( presentShader );
+        al_set_shader_float_vector( "texSize", 2, texSize, 1 );
+        al_set_shader_float( "scale", viewScale );
+    }
+    else
     {
-        ((int*) line)[x] = colorsArgb8[x];
+        al_use_shader( nullptr );
     }
-}
-
-void Graphics::SetColorIndexed( int paletteIndex, int colorIndex, int sysColor )
-{
-    int colorArgb8 = 0;
-    if ( colorIndex != 0 )
-        colorArgb8 = activeSystemPalette[sysColor];
-    SetColor( paletteIndex, colorIndex, colorArgb8 );
-    palettes[paletteIndex][colorIndex] = sysColor;
-}
 
-void Graphics::SetPaletteIndexed( int paletteIndex, const uint8_t* sysColors )
-{
-    int colorsArgb8[4] = 
-    {
+    al_draw_scaled_bitmap(
+        frameBmp,
         0,
-        activeSystemPalette[sysColors[1]],
-        activeSystemPalette[sysColors[2]],
-        activeSystemPalette[sysColors[3]],
-    };
-    SetPalette( paletteIndex, colorsArgb8 );
-    memcpy( palettes[paletteIndex], sysColors, PaletteLength );
+        0,
+        StdViewWidth,
+        StdViewHeight,
+        viewOffsetX,
+        viewOffsetY,
+        StdViewWidth * viewScale,
+        StdViewHeight * viewScale,
+        0 );
+
+    // Draws outside Begin and End go to the frame bitmap too, so make it the
+    // target again for the next frame.
+    al_set_target_bitmap( frameBmp );
+    al_use_shader( tileShader );
+    paletteUniformsStale = true;
 }
 
-void Graphics::UpdatePalettes()
+void Graphics::Clear()
 {
-    int format = al_get_bitmap_format( paletteBmp );
-    ALLEGRO_LOCKED_REGION*  region = al_lock_bitmap( paletteBmp, format, ALLEGRO_LOCK_WRITEONLY );
-    assert( region != nullptr );
+    if ( software )
+    {
+        FillFrame( Frame_Black );
+        return;
+    }
 
-    unsigned char* base = (unsigned char*) region->data;
-    if ( region->pitch < 0 )
-        base += region->pitch * (PaletteBmpHeight - 1);
+    if ( headless )
+        return;
 
-    memcpy( base, paletteBuf, paletteBufSize );
+    if ( recordingDraws && layerTarget == nullptr )
+    {
+        RecordClear( -1 );
+        return;
+    }
 
-    al_unlock_bitmap( paletteBmp );
+    frameDirty = true;
+    al_clear_to_color( al_map_rgb( 0, 0, 0 ) );
 }
 
-void Graphics::SwitchSystemPalette( int* newSystemPalette )
+void Graphics::Clear( int sysColor )
 {
-    if ( activeSystemPalette == newSystemPalette )
+    if ( software )
+    {
+        FillFrame( ToFrameColor( sysColor ) );
         return;
+    }
 
-    activeSystemPalette = newSystemPalette;
+    if ( headless )
+        return;
 
-    for ( int i = 0; i < PaletteCount; i++ )
+    if ( recordingDraws && layerTarget == nullptr )
     {
-        const uint8_t* sysColors = palettes[i];
-        int colorsArgb8[4] = 
-        {
-            0,
-            activeSystemPalette[sysColors[1]],
-            activeSystemPalette[sysColors[2]],
-            activeSystemPalette[sysColors[3]],
-        };
-        SetPalette( i, colorsArgb8 );
+        RecordClear( sysColor );
+        return;
     }
-    UpdatePalettes();
-}
 
-void Graphics::EnableGrayscale()
-{
-    SwitchSystemPalette( grayscalePalette );
+    frameDirty = true;
+    al_clear_to_color( GetSystemColor( sysColor ) );
 }
 
-void Graphics::DisableGrayscale()
-{
-    SwitchSystemPalette( systemPalette );
-}
+// The palette shader reads the palette from the tint's red channel. Layers
+// are drawn with the plain shader, which mustn't change the indexes.
 
-void Graphics::Begin()
+static ALLEGRO_COLOR GetPaletteTint( int palette )
 {
-    bool bRet;
-
-    bRet = al_set_shader_sampler( "palTex", paletteBmp, 1 );
-    assert( bRet );
-
-    al_hold_bitmap_drawing( true );
-}
+    if ( layerTarget != nullptr )
+        return al_map_rgba_f( 1, 1, 1, 1 );
 
-void Graphics::End()
-{
-    al_hold_bitmap_drawing( false );
+    float palRed = palette / (float) PaletteBmpHeight;
+    return al_map_rgba_f( palRed, 0, 0, 1 );
 }
 
 void Graphics::DrawBitmap(
@@ -300,8 +2011,28 @@ void Graphics::DrawBitmap(
     int flags
     )
 {
-    float palRed = palette / (float) PaletteBmpHeight;
-    ALLEGRO_COLOR tint = al_map_rgba_f( palRed, 0, 0, 1 );
+    if ( software )
+    {
+        DrawFrameRegion( 
+            FindIndexedSheet( bitmap ), srcX, srcY, width, height, destX, destY, palette, flags );
+        return;
+    }
+
+    if ( headless )
+        return;
+
+    FlushPalettes();
+
+    if ( recordingDraws && layerTarget == nullptr )
+    {
+        RecordDraw( bitmap, srcX, srcY, width, height, destX, destY, palette, flags );
+        return;
+    }
+
+    ALLEGRO_COLOR tint = GetPaletteTint( palette );
+
+    frameDirty = true;
+    CountDraw( bitmap );
 
     al_draw_tinted_bitmap_region(
         bitmap,
@@ -353,11 +2084,33 @@ void Graphics::DrawTile(
 {
     assert( slot < Sheet_Max );
 
-    float palRed = palette / (float) PaletteBmpHeight;
-    ALLEGRO_COLOR tint = al_map_rgba_f( palRed, 0, 0, 1 );
+    if ( software )
+    {
+        DrawFrameRegion( 
+            ctx->indexedSheets[slot], srcX, srcY, width, height, destX, destY, palette, flags );
+        return;
+    }
+
+    if ( headless )
+        return;
+
+    ALLEGRO_BITMAP* sheet = ctx->tileSheets[slot];
+
+    FlushPalettes();
+
+    if ( recordingDraws && layerTarget == nullptr )
+    {
+        RecordDraw( sheet, srcX, srcY, width, height, destX, destY, palette, flags );
+        return;
+    }
+
+    ALLEGRO_COLOR tint = GetPaletteTint( palette );
+
+    frameDirty = true;
+    CountDraw( sheet );
 
     al_draw_tinted_bitmap_region(
-        tileSheets[slot],
+        sheet,
         tint,
         srcX,
         srcY,
@@ -399,6 +2152,241 @@ void Graphics::DrawStripSprite16x16(
     }
 }
 
+
+
+//----------------------------------------------------------------------------
+//  Layers
+//----------------------------------------------------------------------------
+
+Graphics::Layer* Graphics::CreateLayer( int width, int height )
+{
+    if ( headless && !software )
+        return nullptr;
+
+    Layer* layer = new Layer();
+
+    if ( software )
+    {
+        layer->indexed.width = width;
+        layer->indexed.height = height;
+        layer->indexed.indexes = new uint8_t[width * height]();
+        return layer;
+    }
+
+    layer->bitmap = al_create_bitmap( width, height );
+    if ( layer->bitmap == nullptr )
+    {
+        delete layer;
+        return nullptr;
+    }
+
+    return layer;
+}
+
+void Graphics::DestroyLayer( Layer* layer )
+{
+    if ( layer == nullptr )
+        return;
+
+    assert( layer != layerTarget );
+
+    if ( layer->bitmap != nullptr )
+        al_destroy_bitmap( layer->bitmap );
+
+    delete [] layer->indexed.indexes;
+    delete layer;
+}
+
+void Graphics::BeginLayer( Layer* layer, bool clear )
+{
+    assert( layer != nullptr );
+    assert( layerTarget == nullptr );
+
+    if ( software )
+    {
+        if ( clear )
+            memset( layer->indexed.indexes, 0, layer->indexed.width * layer->indexed.height );
+        layerTarget = layer;
+        return;
+    }
+
+    if ( headless )
+    {
+        layerTarget = layer;
+        return;
+    }
+
+    // Held draws go to the target that was current when they were made, so
+    // they have to be flushed before switching. Draws into the layer aren't
+    // recorded. Frames that draw the layer have to be drawn again.
+    SubmitDraws();
+    frameDirty = true;
+
+    savedHeld = al_is_bitmap_drawing_held();
+    if ( savedHeld )
+        al_hold_bitmap_drawing( false );
+
+    savedTarget = al_get_target_bitmap();
+    al_get_blender( &savedBlendOp, &savedBlendSrc, &savedBlendDest );
+
+    // The layer uses the default shader. With this blender, it copies each
+    // sheet pixel as it is.
+    batchTexture = nullptr;
+
+    al_set_target_bitmap( layer->bitmap );
+    al_use_shader( nullptr );
+    al_set_blender( ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_ZERO );
+    if ( clear )
+        al_clear_to_color( al_map_rgba( 0, 0, 0, 0 ) );
+    al_hold_bitmap_drawing( true );
+
+    layerTarget = layer;
+}
+
+void Graphics::EndLayer()
+{
+    assert( layerTarget != nullptr );
+
+    layerTarget = nullptr;
+
+    if ( headless )
+        return;
+
+    al_hold_bitmap_drawing( false );
+    batchTexture = nullptr;
+    al_set_target_bitmap( savedTarget );
+    al_set_blender( savedBlendOp, savedBlendSrc, savedBlendDest );
+
+    SetPaletteUniforms();
+    paletteUniformsStale = false;
+
+    al_hold_bitmap_drawing( savedHeld );
+}
+
+void Graphics::DrawLayer(
+    Layer* layer,
+    int srcX,
+    int srcY,
+    int width,
+    int height,
+    int destX,
+    int destY,
+    int palette
+    )
+{
+    assert( layer != nullptr );
+
+    if ( software )
+    {
+        DrawFrameRegion( &layer->indexed, srcX, srcY, width, height, destX, destY, palette, 0 );
+        return;
+    }
+
+    DrawBitmap( layer->bitmap, srcX, srcY, width, height, destX, destY, palette, 0 );
+}
+
+
+
+//----------------------------------------------------------------------------
+//  Tile grids
+//----------------------------------------------------------------------------
+
+Graphics::TileGrid* Graphics::CreateTileGrid()
+{
+    if ( headless || tileMapShader == nullptr )
+        return nullptr;
+
+    ALLEGRO_BITMAP* bitmap = al_create_bitmap( TileGrid_Size, TileGrid_Size );
+    if ( bitmap == nullptr )
+        return nullptr;
+
+    TileGrid* grid = new TileGrid();
+    grid->bitmap = bitmap;
+    return grid;
+}
+
+void Graphics::DestroyTileGrid( TileGrid* grid )
+{
+    if ( grid == nullptr )
+        return;
+
+    al_destroy_bitmap( grid->bitmap );
+    delete grid;
+}
+
+void Graphics::SetTileGrid( 
+    TileGrid* grid, 
+    const uint8_t* tileRefs, 
+    const uint8_t* palettes, 
+    int columns, 
+    int rows )
+{
+    assert( grid != nullptr );
+    assert( columns <= TileGrid_Size && rows <= TileGrid_Size );
+
+    frameDirty = true;
+
+    ALLEGRO_LOCKED_REGION* region = al_lock_bitmap( 
+        grid->bitmap, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_WRITEONLY );
+    assert( region != nullptr );
+    if ( region == nullptr )
+        return;
+
+    for ( int y = 0; y < TileGrid_Size; y++ )
+    {
+        // Pixels are R, G, B, A bytes in memory.
+        uint8_t* texels = (uint8_t*) region->data + y * region->pitch;
+
+        for ( int x = 0; x < TileGrid_Size; x++, texels += 4 )
+        {
+            int palette = TileGrid_Empty;
+            int tileRef = 0;
+
+            if ( y < rows && x < columns )
+            {
+                palette = palettes[y * columns + x];
+                tileRef = tileRefs[y * columns + x];
+            }
+
+            texels[0] = tileRef;
+            texels[1] = palette;
+            texels[2] = 0;
+            texels[3] = (palette == TileGrid_Empty) ? 0 : 0xFF;
+        }
+    }
+
+    al_unlock_bitmap( grid->bitmap );
+}
+
+void Graphics::DrawTileGrid(
+    TileGrid* grid,
+    int slot,
+    int firstCol,
+    int firstRow,
+    int columns,
+    int rows,
+    int destX,
+    int destY )
+{
+    assert( grid != nullptr );
+    assert( slot < Sheet_Max );
+
+    FlushPalettes();
+
+    ALLEGRO_BITMAP* sheet = ctx->tileSheets[slot];
+
+    drawStats.Draws++;
+
+    if ( recordingDraws && layerTarget == nullptr )
+    {
+        RecordTileGrid( grid->bitmap, sheet, firstCol, firstRow, columns, rows, destX, destY );
+        return;
+    }
+
+    frameDirty = true;
+    DrawTileGridNow( grid->bitmap, sheet, firstCol, firstRow, columns, rows, destX, destY );
+}
+
 void Graphics::SetViewParams( float scale, float x, float y )
 {
     viewScale = scale;
@@ -408,11 +2396,8 @@ void Graphics::SetViewParams( float scale, float x, float y )
 
 void Graphics::SetClip( int x, int y, int width, int height )
 {
-    al_get_clipping_rectangle( 
-        &savedClipX,
-        &savedClipY,
-        &savedClipWidth,
-        &savedClipHeight );
+    if ( headless && !software )
+        return;
 
     int y2 = y + height;
 
@@ -440,23 +2425,52 @@ void Graphics::SetClip( int x, int y, int width, int height )
         }
     }
 
-    int clipX = viewOffsetX + x * viewScale;
-    int clipY = viewOffsetY + y * viewScale;
-    int clipWidth = width * viewScale;
-    int clipHeight = height * viewScale;
+    if ( software )
+    {
+        savedFrameClipX = frameClipX;
+        savedFrameClipY = frameClipY;
+        savedFrameClipWidth = frameClipWidth;
+        savedFrameClipHeight = frameClipHeight;
 
-    al_set_clipping_rectangle( 
-        clipX, 
-        clipY, 
-        clipWidth, 
-        clipHeight );
+        int x2 = Util::Min( x + width, StdViewWidth );
+
+        frameClipX = Util::Max( x, 0 );
+        frameClipY = y;
+        frameClipWidth = Util::Max( x2 - frameClipX, 0 );
+        frameClipHeight = height;
+        return;
+    }
+
+    al_get_clipping_rectangle( 
+        &savedClipX,
+        &savedClipY,
+        &savedClipWidth,
+        &savedClipHeight );
+
+    al_set_clipping_rectangle( x, y, width, height );
+
+    RecordClip();
 }
 
 void Graphics::ResetClip()
 {
+    if ( software )
+    {
+        frameClipX = savedFrameClipX;
+        frameClipY = savedFrameClipY;
+        frameClipWidth = savedFrameClipWidth;
+        frameClipHeight = savedFrameClipHeight;
+        return;
+    }
+
+    if ( headless )
+        return;
+
     al_set_clipping_rectangle( 
         savedClipX,
         savedClipY,
         savedClipWidth,
         savedClipHeight );
+
+    RecordClip();
 }
@@ -19,6 +19,18 @@ enum TileSheetSlot
     Sheet_Max
 };
 
+enum
+{
+    // A frame color that's black, whatever the system palette.
+    Frame_Black = SysPaletteLength,
+
+    // Tile grids have room for this many columns and rows. The tile map
+    // shader has to agree.
+    TileGrid_Size   = 32,
+    // A tile grid cell with this palette isn't drawn.
+    TileGrid_Empty  = 0xFF,
+};
+
 
 struct SpriteFrame
 {
@@ -39,13 +51,73 @@ struct SpriteAnim
 class Graphics
 {
 public:
+    struct Context;
+    struct DrawStats
+    {
+        // Bitmap regions drawn.
+        uint32_t    Draws;
+        // Draw calls. Recorded draws are sent a batch per texture and clip.
+        // Draws into layers are estimated: a held batch is cut when the
+        // texture changes.
+        uint32_t    Batches;
+        // Locks of the palette buffer.
+        uint32_t    PaletteUploads;
+        // Frames that drew the same as the one before, and weren't sent.
+        uint32_t    UnchangedFrames;
+        // Atlas pages made, and sheets loaded as textures of their own,
+        // because the atlas is off or they didn't fit.
+        uint32_t    AtlasPages;
+        uint32_t    SeparateSheets;
+    };
+
+    struct Layer;
+    struct TileGrid;
+
     static bool Init();
+    static bool InitHeadless();
+    // Like InitHeadless, but draws go to a frame in memory. See GetFrame.
+    static bool InitSoftware();
+    static bool IsHeadless();
+    static bool IsSoftware();
+    // Tile sheets and shared bitmaps are packed into a few large atlas
+    // bitmaps as they're loaded, so that draws from different sheets can
+    // be batched. Call before anything is loaded.
+    static void SetAtlasEnabled( bool enable );
+    // Scales the frame with sharp bilinear filtering, so that it can be
+    // shown at any size. Returns false if the shader for it isn't available.
+    static bool SetSharpScaling( bool enable );
+
+    static void GetDrawStats( DrawStats& stats );
+    static void ResetDrawStats();
+
+    static Context* CreateContext();
+    static void DestroyContext( Context* context );
+    // Contexts hold plain data, so they can be copied as bytes.
+    static size_t GetContextSize();
+    static void SetContext( Context* context );
 
     static void LoadTileSheet( int slot, const char* path );
     static void LoadTileSheet( int slot, const char* imagePath, const char* animPath );
+    // Bitmaps loaded this way are shared by all worlds, and never destroyed.
+    static ALLEGRO_BITMAP* LoadSharedBitmap( const char* path );
 
+    // Draws between Begin and End are recorded, and sent to the GPU in
+    // batches. They're sent early when a layer is drawn or palettes are
+    // uploaded.
+    // The frame is drawn at its native size between Begin and End. Present
+    // scales it up to the display once.
     static void Begin();
     static void End();
+    static void Present();
+    // Whether the frame changed since it was last presented. Frames drawn
+    // the same as the one before aren't sent to the GPU at all.
+    static bool IsFrameChanged();
+    // Makes the next frame be drawn, such as when the frame bitmap was lost.
+    // It isn't preserved, so this has to be called whenever it's lost.
+    static void InvalidateFrame();
+    // Clears the clip rectangle.
+    static void Clear();
+    static void Clear( int sysColor );
     static void DrawSpriteTile( 
         int slot, 
         int srcX, 
@@ -92,18 +164,94 @@ public:
     static void SetColor( int paletteIndex, int colorIndex, int colorArgb8 );
     static void SetColorIndexed( int paletteIndex, int colorIndex, int sysColor );
     static void SetPaletteIndexed( int paletteIndex, const uint8_t* sysColors );
+    // Makes the palettes changed since the last call take effect. They're
+    // uploaded before the next draw, so that all the changes made while
+    // updating a frame go up together.
     static void UpdatePalettes();
+    // Like UpdatePalettes, but for every palette, as when the context was
+    // replaced.
+    static void UpdateAllPalettes();
+
+    // Effect palettes are colors for fades and flashes, loaded ahead of
+    // time. Setting them changes the palettes like SetPaletteIndexed and
+    // UpdatePalettes. But the palette shader reads them from a texture that
+    // was already uploaded, until one of those palettes is changed some
+    // other way.
+    static void LoadEffectPalettes( const uint8_t (*sysColors)[PaletteLength], int count );
+    static void SetEffectPalettes( int firstPalette, int effectIndex, int count );
 
     static void EnableGrayscale();
     static void DisableGrayscale();
 
+    // Where Present puts the frame on the display.
     static void SetViewParams( float scale, float x, float y );
     static void SetClip( int x, int y, int width, int height );
     static void ResetClip();
 
     static const SpriteAnim* GetAnimation( int slot, int animIndex );
+    // The bitmap loaded into a slot. Callers can use it to tell whether the
+    // sheet changed.
+    static ALLEGRO_BITMAP* GetTileSheet( int slot );
+
+    // A layer is an offscreen bitmap of palette color indexes. What's drawn
+    // into it keeps its indexes, so the layer can be drawn later with any
+    // palette, like a tile sheet. Returns null if layers can't be made, as
+    // when headless without the software renderer.
+    static Layer* CreateLayer( int width, int height );
+    static void DestroyLayer( Layer* layer );
+    // Until EndLayer, draws go to the layer instead of the screen. The layer
+    // starts out all color index 0, which palettes leave transparent. If
+    // clear is false, it keeps what was drawn into it before, so that parts
+    // of it can be drawn over.
+    static void BeginLayer( Layer* layer, bool clear = true );
+    static void EndLayer();
+    static void DrawLayer(
+        Layer* layer,
+        int srcX,
+        int srcY,
+        int width,
+        int height,
+        int destX,
+        int destY,
+        int palette
+        );
+
+    // A tile grid is a texture of tile refs and palettes, one texel for
+    // each 8x8 tile. The tile map shader draws any part of it in one quad.
+    // Returns null if the shader isn't available, as when headless.
+    static TileGrid* CreateTileGrid();
+    static void DestroyTileGrid( TileGrid* grid );
+    // Both arrays have a byte for each tile, row by row. Cells outside the
+    // given columns and rows are empty.
+    static void SetTileGrid( 
+        TileGrid* grid, 
+        const uint8_t* tileRefs, 
+        const uint8_t* palettes, 
+        int columns, 
+        int rows 
+        );
+    static void DrawTileGrid(
+        TileGrid* grid,
+        int slot,
+        int firstCol,
+        int firstRow,
+        int columns,
+        int rows,
+        int destX,
+        int destY
+        );
+
+    // The software renderer draws into a frame for each thread, of
+    // StdViewWidth by StdViewHeight bytes. Each byte is a system color, with
+    // grayscale already applied, or Frame_Black.
+    static const uint8_t* GetFrame();
+    // Converts the frame to ARGB, with the current world's system palette.
+    static void GetFrameArgb( uint32_t* pixelsArgb8 );
+    // Reads back what was drawn, at StdViewWidth by StdViewHeight, from the
+    // software frame or the display's back buffer.
+    static bool ReadFrameArgb( uint32_t* pixelsArgb8 );
 
 private:
     static void SetPalette( int paletteIndex, const int* colorsArgb8 );
-    static void SwitchSystemPalette( int* newSystemPalette );
+    static void SwitchSystemPalette( bool grayscale );
 };
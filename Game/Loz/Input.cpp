@@ -60,11 +60,30 @@ static AxisMapping joystickAxisMappings[2] =
 
 static const char InputSection[] = "input";
 
-static InputButtons oldInputState( 0 );
-static InputButtons inputState( 0 );
+// Input state that belongs to one world. The mappings above are read-only
+// once loaded.
 
-static ALLEGRO_KEYBOARD_STATE oldKeyboardState;
-static ALLEGRO_KEYBOARD_STATE keyboardState;
+struct Input::Context
+{
+    InputButtons            oldInputState;
+    InputButtons            inputState;
+
+    ALLEGRO_KEYBOARD_STATE  oldKeyboardState;
+    ALLEGRO_KEYBOARD_STATE  keyboardState;
+
+    Context()
+        :   oldInputState( 0 ),
+            inputState( 0 ),
+            oldKeyboardState(),
+            keyboardState()
+    {
+    }
+};
+
+static thread_local Input::Context* ctx;
+
+// Without devices, no keys or buttons are ever down.
+static bool headless;
 
 
 InputButtons::InputButtons( uint value )
@@ -91,16 +110,16 @@ InputButtons Input::GetButtons()
 {
     uint buttons = 0;
 
-    buttons = (oldInputState.Buttons ^ inputState.Buttons) 
-        & inputState.Buttons 
-        | (inputState.Buttons & 0xF);
+    buttons = (ctx->oldInputState.Buttons ^ ctx->inputState.Buttons) 
+        & ctx->inputState.Buttons 
+        | (ctx->inputState.Buttons & 0xF);
 
     return (InputButtons) buttons;
 }
 
 bool Input::IsKeyDown( int keyCode )
 {
-    return al_key_down( &keyboardState, keyCode );
+    return al_key_down( &ctx->keyboardState, keyCode );
 }
 
 bool Input::IsKeyPressing( int keyCode )
@@ -110,15 +129,15 @@ bool Input::IsKeyPressing( int keyCode )
 
 ButtonState Input::GetKey( int keyCode )
 {
-    int isDown = al_key_down( &keyboardState, keyCode ) ? 1 : 0;
-    int wasDown = al_key_down( &oldKeyboardState, keyCode ) ? 1 : 0;
+    int isDown = al_key_down( &ctx->keyboardState, keyCode ) ? 1 : 0;
+    int wasDown = al_key_down( &ctx->oldKeyboardState, keyCode ) ? 1 : 0;
 
     return (ButtonState) ((wasDown << 1) | isDown);
 }
 
 bool Input::IsButtonDown( int buttonCode )
 {
-    return inputState.Buttons & buttonCode;
+    return ctx->inputState.Buttons & buttonCode;
 }
 
 bool Input::IsButtonPressing( int buttonCode )
@@ -128,8 +147,8 @@ bool Input::IsButtonPressing( int buttonCode )
 
 ButtonState Input::GetButton( int buttonCode )
 {
-    int isDown = (inputState.Buttons & buttonCode) ? 1 : 0;
-    int wasDown = (oldInputState.Buttons & buttonCode) ? 1 : 0;
+    int isDown = (ctx->inputState.Buttons & buttonCode) ? 1 : 0;
+    int wasDown = (ctx->oldInputState.Buttons & buttonCode) ? 1 : 0;
 
     return (ButtonState) ((wasDown << 1) | isDown);
 }
@@ -158,8 +177,8 @@ Direction Input::GetInputDirection()
 
 static void PollKeyboard()
 {
-    memcpy( &oldKeyboardState, &keyboardState, sizeof keyboardState );
-    al_get_keyboard_state( &keyboardState );
+    memcpy( &ctx->oldKeyboardState, &ctx->keyboardState, sizeof ctx->keyboardState );
+    al_get_keyboard_state( &ctx->keyboardState );
 
     for ( int i = 0; i < _countof( keyboardMappings ); i++ )
     {
@@ -167,8 +186,8 @@ static void PollKeyboard()
         if ( mapping.DstCode == InputButtons::None )
             continue;
 
-        if ( al_key_down( &keyboardState, mapping.SrcCode ) )
-            inputState.Buttons |= mapping.DstCode;
+        if ( al_key_down( &ctx->keyboardState, mapping.SrcCode ) )
+            ctx->inputState.Buttons |= mapping.DstCode;
     }
 }
 
@@ -191,7 +210,7 @@ static void PollJoystick()
             continue;
 
         if ( mapping.SrcCode < numButtons && joystickState.button[mapping.SrcCode] > 0 )
-            inputState.Buttons |= mapping.DstCode;
+            ctx->inputState.Buttons |= mapping.DstCode;
     }
 
     for ( int i = 0; i < _countof( joystickAxisMappings ); i++ )
@@ -209,16 +228,16 @@ static void PollJoystick()
                 if ( axisValue > 0 )
                 {
                     if ( mapping.DstAxis == InputAxis_Horizontal )
-                        inputState.Buttons |= InputButtons::Right;
+                        ctx->inputState.Buttons |= InputButtons::Right;
                     else
-                        inputState.Buttons |= InputButtons::Down;
+                        ctx->inputState.Buttons |= InputButtons::Down;
                 }
                 else if ( axisValue < 0 )
                 {
                     if ( mapping.DstAxis == InputAxis_Horizontal )
-                        inputState.Buttons |= InputButtons::Left;
+                        ctx->inputState.Buttons |= InputButtons::Left;
                     else
-                        inputState.Buttons |= InputButtons::Up;
+                        ctx->inputState.Buttons |= InputButtons::Up;
                 }
             }
         }
@@ -227,8 +246,11 @@ static void PollJoystick()
 
 static void Poll()
 {
-    oldInputState = inputState;
-    inputState = 0;
+    ctx->oldInputState = ctx->inputState;
+    ctx->inputState = 0;
+
+    if ( headless )
+        return;
 
     PollKeyboard();
     PollJoystick();
@@ -239,6 +261,21 @@ void Input::Update()
     Poll();
 }
 
+void Input::Update( InputButtons buttons )
+{
+    ctx->oldInputState = ctx->inputState;
+    ctx->inputState = buttons;
+
+    // Only the buttons come from outside. No keys are down.
+    memcpy( &ctx->oldKeyboardState, &ctx->keyboardState, sizeof ctx->keyboardState );
+    memset( &ctx->keyboardState, 0, sizeof ctx->keyboardState );
+}
+
+InputButtons Input::GetPolledButtons()
+{
+    return ctx->inputState;
+}
+
 static bool ParseInt( const char* str, int& value )
 {
     if ( str == nullptr )
@@ -297,3 +334,29 @@ void Input::Init()
 {
     LoadMappings();
 }
+
+void Input::InitHeadless()
+{
+    headless = true;
+}
+
+Input::Context* Input::CreateContext()
+{
+    Context* context = new Context();
+    return context;
+}
+
+void Input::DestroyContext( Context* context )
+{
+    delete context;
+}
+
+size_t Input::GetContextSize()
+{
+    return sizeof( Context );
+}
+
+void Input::SetContext( Context* context )
+{
+    ctx = context;
+}
@@ -44,7 +44,16 @@ struct InputButtons
 class Input
 {
 public:
+    struct Context;
+
     static void Init();
+    static void InitHeadless();
+
+    static Context* CreateContext();
+    static void DestroyContext( Context* context );
+    // Contexts hold plain data, so they can be copied as bytes.
+    static size_t GetContextSize();
+    static void SetContext( Context* context );
 
     static InputButtons GetButtons();
 
@@ -58,4 +67,8 @@ public:
     static Direction GetInputDirection();
 
     static void Update();
+    // Updates with the given buttons instead of polling the devices.
+    static void Update( InputButtons buttons );
+    // Returns the buttons that are down, as polled or given in the last update.
+    static InputButtons GetPolledButtons();
 };
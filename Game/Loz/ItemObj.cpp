@@ -17,6 +17,7 @@
 #include "Monsters.h"
 #include "Sound.h"
 #include "SoundId.h"
+#include "StateHash.h"
 #include "TextBox.h"
 
 
@@ -112,6 +113,13 @@ Ladder::Ladder()
     image.anim = Graphics::GetAnimation( Sheet_PlayerAndItems, Anim_PI_Ladder );
 }
 
+void Ladder::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    hash.AddValue( state );
+    hash.AddValue( origDir );
+}
+
 int  Ladder::GetState()
 {
     return state;
@@ -181,12 +189,27 @@ BlockSpec blockSpec =
 BlockObjBase::BlockObjBase( ObjType type, const BlockSpec* spec )
     :   Object( type ),
         timer( 0 ),
+        targetPos( 0 ),
         spec( spec ),
+        origX( 0 ),
+        origY( 0 ),
         curUpdate( &BlockObjBase::UpdateIdle )
 {
     decoration = 0;
 }
 
+void BlockObjBase::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    hash.AddValue( timer );
+    hash.AddValue( targetPos );
+    hash.AddValue( origX );
+    hash.AddValue( origY );
+
+    uint8_t isMoving = curUpdate == &BlockObjBase::UpdateMoving ? 1 : 0;
+    hash.AddValue( isMoving );
+}
+
 void BlockObjBase::SetX( int x )
 {
     objX = x;
@@ -364,6 +387,13 @@ Fire::Fire()
     decoration = 0;
 }
 
+void Fire::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    hash.AddValue( state );
+    HashAnimator( hash, animator );
+}
+
 void Fire::SetMoving( Direction dir )
 {
     facing = dir;
@@ -464,11 +494,20 @@ void Fire::Draw()
 //----------------------------------------------------------------------------
 
 Tree::Tree()
-    :   Object( Obj_Tree )
+    :   Object( Obj_Tree ),
+        x( 0 ),
+        y( 0 )
 {
     decoration = 0;
 }
 
+void Tree::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    hash.AddValue( x );
+    hash.AddValue( y );
+}
+
 void Tree::SetX( int x )
 {
     this->x = x;
@@ -554,6 +593,13 @@ Bomb::Bomb()
     animator.durationFrames = 1;
 }
 
+void Bomb::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    hash.AddValue( state );
+    HashAnimator( hash, animator );
+}
+
 Bomb::State Bomb::GetLifetimeState()
 {
     return state;
@@ -639,11 +685,20 @@ void Bomb::Draw()
 //----------------------------------------------------------------------------
 
 RockWall::RockWall()
-    :   Object( Obj_RockWall )
+    :   Object( Obj_RockWall ),
+        x( 0 ),
+        y( 0 )
 {
     decoration = 0;
 }
 
+void RockWall::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    hash.AddValue( x );
+    hash.AddValue( y );
+}
+
 void RockWall::SetX( int x )
 {
     this->x = x;
@@ -769,6 +824,13 @@ PlayerSword::PlayerSword( ObjType type )
     decoration = 0;
 }
 
+void PlayerSword::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    hash.AddValue( state );
+    hash.AddValue( timer );
+}
+
 int PlayerSword::GetState()
 {
     return state;
@@ -909,6 +971,13 @@ Shot::Shot( ObjType type )
         World::SetActiveShots( World::GetActiveShots() + 1 );
 }
 
+void Shot::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    hash.AddValue( state );
+    hash.AddValue( bounceDir );
+}
+
 Shot::~Shot()
 {
     if ( !IsPlayerWeapon() )
@@ -997,6 +1066,12 @@ PlayerSwordShot::PlayerSwordShot( int x, int y, Direction moving )
     image.anim = Graphics::GetAnimation( Sheet_PlayerAndItems, animIndex );
 }
 
+void PlayerSwordShot::HashState( StateHash& hash )
+{
+    Shot::HashState( hash );
+    hash.AddValue( distance );
+}
+
 void PlayerSwordShot::Update()
 {
     switch ( state )
@@ -1175,6 +1250,16 @@ Fireball::Fireball( ObjType type, int x, int y, float speed )
     speedY = sin( angle ) * speed;
 }
 
+void Fireball::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    hash.AddValue( state );
+    hash.AddValue( x );
+    hash.AddValue( y );
+    hash.AddValue( speedX );
+    hash.AddValue( speedY );
+}
+
 void Fireball::SetY( int y )
 {
     this->y = y;
@@ -1252,6 +1337,21 @@ Boomerang::Boomerang( int x, int y, Direction moving, int distance, float speed,
         World::SetActiveShots( World::GetActiveShots() + 1 );
 }
 
+void Boomerang::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    hash.AddValue( startX );
+    hash.AddValue( startY );
+    hash.AddValue( distanceTarget );
+    hash.AddValue( ownerRef.Id );
+    hash.AddValue( x );
+    hash.AddValue( y );
+    hash.AddValue( leaveSpeed );
+    hash.AddValue( state );
+    hash.AddValue( animTimer );
+    HashAnimator( hash, animator );
+}
+
 Boomerang::~Boomerang()
 {
     if ( !IsPlayerWeapon() )
@@ -1349,7 +1449,7 @@ void Boomerang::UpdateLeaveSlow()
 
 void Boomerang::UpdateReturn()
 {
-    Object* owner = ownerRef.Obj;
+    Object* owner = ownerRef.Get();
     if ( owner == nullptr || owner->GetDecoration() != 0 )
     {
         isDeleted = true;
@@ -1424,7 +1524,8 @@ void Boomerang::AdvanceAnimAndCheckCollision()
         // The original game sets animTimer to 2.
         // But the sound from the NSF doesn't sound right at that speed.
         animTimer = 11;
-        if ( ownerRef.Obj != nullptr && ownerRef.Obj->IsPlayer() )
+        Object* owner = ownerRef.Get();
+        if ( owner != nullptr && owner->IsPlayer() )
             Sound::PlayEffect( SEffect_boomerang );
     }
 
@@ -1557,6 +1658,12 @@ Arrow::Arrow( int x, int y, Direction moving )
     image.anim = Graphics::GetAnimation( Sheet_PlayerAndItems, arrowAnimMap[dirOrd] );
 }
 
+void Arrow::HashState( StateHash& hash )
+{
+    Shot::HashState( hash );
+    hash.AddValue( timer );
+}
+
 void Arrow::SetSpark( int frames )
 {
     state = Spark;
@@ -1695,7 +1802,9 @@ Person::Person( ObjType type, int x, int y, const CaveSpec* spec )
         spec( *spec ),
         textBox( nullptr ),
         chosenIndex( 0 ),
-        showNumbers( false )
+        showNumbers( false ),
+        gamblingAmounts(),
+        gamblingIndexes()
 {
     objX = x;
     objY = y;
@@ -1754,7 +1863,7 @@ Person::Person( ObjType type, int x, int y, const CaveSpec* spec )
     int animId = sPersonGraphics[animIndex].AnimId;
     image.anim = Graphics::GetAnimation( Sheet_PlayerAndItems, animId );
 
-    textBox = new TextBox( World::GetString( stringId ) );
+    textBox.Reset( World::GetString( stringId ) );
 
     memset( priceStrs, Char_Space, sizeof priceStrs );
 
@@ -1793,6 +1902,19 @@ Person::Person( ObjType type, int x, int y, const CaveSpec* spec )
         World::GetPlayer()->SetState( Player::Paused );
 }
 
+void Person::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    hash.AddValue( state );
+    hash.AddValue( spec );
+    textBox.HashState( hash );
+    hash.AddValue( chosenIndex );
+    hash.AddValue( showNumbers );
+    hash.AddValue( priceStrs );
+    hash.AddValue( gamblingAmounts );
+    hash.AddValue( gamblingIndexes );
+}
+
 void Person::Update()
 {
     if ( state == Idle )
@@ -1830,12 +1952,12 @@ void Person::Update()
 
 void Person::UpdateDialog()
 {
-    if ( textBox->IsDone() )
+    if ( textBox.IsDone() )
         return;
 
-    textBox->Update();
+    textBox.Update();
 
-    if ( textBox->IsDone() )
+    if ( textBox.IsDone() )
     {
         if ( spec.GetStringId() == String_DoorRepair )
         {
@@ -1941,7 +2063,7 @@ void Person::HandlePickUpHint( int index )
             assert( false );
     }
 
-    textBox->Reset( World::GetString( stringId ) );
+    textBox.Reset( World::GetString( stringId ) );
 
     spec.ClearShowPrices();
     spec.ClearPickUp();
@@ -2171,7 +2293,7 @@ void Person::Draw()
 
 void Person::DrawDialog()
 {
-    textBox->Draw();
+    textBox.Draw();
 }
 
 
@@ -2193,6 +2315,14 @@ ItemObj::ItemObj( int itemId, int x, int y, bool isRoomItem )
         timer = 0x1FF;
 }
 
+void ItemObj::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    hash.AddValue( itemId );
+    hash.AddValue( isRoomItem );
+    hash.AddValue( timer );
+}
+
 bool ItemObj::TouchesObject( Object* obj )
 {
     int distanceX = abs( obj->GetX() + 0 - objX );
@@ -2294,6 +2424,12 @@ Food::Food( int x, int y )
     objTimer = 0xFF;
 }
 
+void Food::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    hash.AddValue( periods );
+}
+
 void Food::Update()
 {
     if ( objTimer == 0 )
@@ -2342,6 +2478,13 @@ Whirlwind::Whirlwind( int x, int y )
     animator.time = 0;
 }
 
+void Whirlwind::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    hash.AddValue( prevRoomId );
+    HashAnimator( hash, animator );
+}
+
 void Whirlwind::SetTeleportPrevRoomId( int roomId )
 {
     prevRoomId = roomId;
@@ -2418,6 +2561,12 @@ Dock::Dock( int x, int y )
     raftImage.anim = Graphics::GetAnimation( Sheet_PlayerAndItems, Anim_PI_Raft );
 }
 
+void Dock::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    hash.AddValue( state );
+}
+
 void Dock::Update()
 {
     if ( World::GetItem( ItemSlot_Raft ) == 0 )
@@ -9,8 +9,7 @@
 
 #include "Object.h"
 #include "SpriteAnimator.h"
-
-class TextBox;
+#include "TextBox.h"
 
 
 class Ladder : public Object
@@ -24,6 +23,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 
     int  GetState();
     void SetState( int state );
@@ -50,6 +50,7 @@ public:
     virtual void Update();
     virtual void Draw();
     virtual void* GetInterface( ObjInterfaces iface );
+    virtual void HashState( StateHash& hash );
 
     void SetX( int x );
     void SetY( int y );
@@ -106,6 +107,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 
 private:
     void CheckCollisionWithPlayer();
@@ -127,6 +129,7 @@ public:
     virtual void Draw();
     virtual int GetX();
     virtual int GetY();
+    virtual void HashState( StateHash& hash );
 };
 
 
@@ -156,6 +159,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 };
 
 
@@ -174,6 +178,7 @@ public:
     virtual void Draw();
     virtual int GetX();
     virtual int GetY();
+    virtual void HashState( StateHash& hash );
 };
 
 
@@ -190,6 +195,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 
 private:
     void Put();
@@ -223,6 +229,7 @@ public:
 
     virtual void* GetInterface( ObjInterfaces iface );
     virtual bool IsInShotStartState();
+    virtual void HashState( StateHash& hash );
 
 protected:
     void Move( int speed );
@@ -243,6 +250,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 
     void SpreadOut();
 
@@ -285,6 +293,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 };
 
 
@@ -312,6 +321,7 @@ public:
     virtual void Draw();
     virtual void* GetInterface( ObjInterfaces iface );
     virtual bool IsInShotStartState();
+    virtual void HashState( StateHash& hash );
 
 private:
     void UpdateLeaveFast();
@@ -354,6 +364,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 
 private:
     void UpdateArrow();
@@ -410,7 +421,7 @@ class Person : public Object
     SpriteImage     image;
 
     CaveSpec        spec;
-    TextBox*        textBox;
+    TextBox         textBox;
     int             chosenIndex;
     bool            showNumbers;
 
@@ -424,6 +435,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 
 private:
     void UpdateDialog();
@@ -456,6 +468,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 
 private:
     bool TouchesObject( Object* obj );
@@ -471,6 +484,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 };
 
 
@@ -484,6 +498,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 
     void SetTeleportPrevRoomId( int roomId );
 };
@@ -499,6 +514,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 };
 
 
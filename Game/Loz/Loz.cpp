@@ -6,9 +6,19 @@
 */
 
 #include "Common.h"
+#include "Blit.h"
+#include "Capture.h"
 #include "Graphics.h"
 #include "Input.h"
+#include "Movie.h"
+#include "Profile.h"
+#include "Rewind.h"
+#include "SaveFolder.h"
 #include "Sound.h"
+#include "StateExport.h"
+#include "StateHash.h"
+#include "TextCache.h"
+#include "Verify.h"
 #include "World.h"
 #include <allegro5/allegro_acodec.h>
 #include <allegro5/allegro_audio.h>
@@ -18,19 +28,86 @@
 const double FrameTime = 1 / 60.0;
 
 static const char GraphicsSection[] = "graphics";
+static const char RewindSection[] = "rewind";
+static const char LatencySection[] = "latency";
+static const char ExportSection[] = "export";
+
+// Rewind keeps one keyframe a second.
+const int RewindKeyframeInterval = 60;
+const uint32_t MaxRunAheadFrames = 4;
+const uint32_t DefaultExportSlots = 4;
+// About four megabytes of frames.
+const int CaptureQueueLength = 16;
+// While the window is in the background, only every fourth frame is drawn.
+const int BackgroundDrawInterval = 4;
 
 
 static ALLEGRO_EVENT_QUEUE* eventQ;
 static ALLEGRO_DISPLAY* display;
 static ALLEGRO_CONFIG* globalConfig;
-static uint32_t frameCounter;
+
+// Command line options
+static bool headless;
+static uint32_t headlessFrameCount = 60 * 60 * 60;
+static bool softwareRender;
+static int startSlot = -1;
+static uint64_t randomSeed = Util::Random::DefaultSeed;
+static const char* recordPath;
+static const char* playPath;
+static bool fastPlayback;
+static const char* hashLogPath;
+static const char* checkPath;
+static const char* verifyPath;
+static uint32_t verifyThreads;
+static bool benchmark;
+static const char* capturePath;
+static const char* captureAudioPath;
+static bool showDrawStats;
+
+static MovieRecorder movieRecorder;
+static MoviePlayer moviePlayer;
+static StateHashLog hashLog;
+static StateHashLog checkLog;
+static StateExporter stateExporter;
+static FrameCapture frameCapture;
+static uint32_t frameNumber;
+static uint32_t drawnFrameCount;
+static bool checkFailed;
+
+// Config options
+static uint32_t rewindSeconds = 60;
+static uint32_t rewindMegabytes = 16;
+static int rewindKey = ALLEGRO_KEY_BACKSPACE;
+static uint32_t runAheadFrames;
+static char exportName[64];
+static uint32_t exportSlots = DefaultExportSlots;
+static bool useAtlas = true;
+static bool sharpScaling;
+
+static RewindBuffer rewindBuffer;
+static WorldSnapshot* runAheadSnapshot;
 
 
 void ResizeView( int screenWidth, int screenHeight );
+static bool StartGame();
+static void UpdateFrame();
+static void DrawFrame();
+static void EndGame();
+static void LoadRewindConfig();
+static void LoadLatencyConfig();
+static void LoadExportConfig();
+static void LoadGraphicsConfig();
+static void CaptureAudio( const int16_t* samples, int frameCount, void* data );
+static bool DrawCapturedFrame();
+
+static bool IsFastForwarding()
+{
+    return fastPlayback && moviePlayer.IsOpen();
+}
 
-uint32_t GetFrameCounter()
+static bool IsRunningAhead()
 {
-    return frameCounter;
+    return runAheadSnapshot != nullptr && !IsFastForwarding();
 }
 
 void Run()
@@ -51,10 +128,18 @@ void Run()
     al_register_event_source( eventQ, displaySource );
     al_register_event_source( eventQ, joystickSource );
 
-    World::Init();
+    if ( !StartGame() )
+        return;
 
     double startTime = al_get_time();
     double waitSpan = 0;
+    // The display has to be shown the frame again, even if it didn't change.
+    bool presentNeeded = true;
+    bool drawingHalted = false;
+    bool switchedOut = false;
+    int framesSinceDraw = 0;
+    // Whether the frame of the last update was drawn for the capture.
+    bool capturedLast = false;
 
     while ( true )
     {
@@ -76,6 +161,39 @@ void Run()
                 ResizeView( event.display.width, event.display.height );
 
                 updated = true;
+                presentNeeded = true;
+            }
+            else if ( event.any.type == ALLEGRO_EVENT_DISPLAY_EXPOSE
+                || event.any.type == ALLEGRO_EVENT_DISPLAY_SWITCH_IN )
+            {
+                switchedOut = false;
+                updated = true;
+                presentNeeded = true;
+            }
+            else if ( event.any.type == ALLEGRO_EVENT_DISPLAY_SWITCH_OUT )
+            {
+                switchedOut = true;
+            }
+            else if ( event.any.type == ALLEGRO_EVENT_DISPLAY_HALT_DRAWING )
+            {
+                al_acknowledge_drawing_halt( display );
+                drawingHalted = true;
+            }
+            else if ( event.any.type == ALLEGRO_EVENT_DISPLAY_LOST )
+            {
+                drawingHalted = true;
+            }
+            else if ( event.any.type == ALLEGRO_EVENT_DISPLAY_RESUME_DRAWING
+                || event.any.type == ALLEGRO_EVENT_DISPLAY_FOUND )
+            {
+                if ( event.any.type == ALLEGRO_EVENT_DISPLAY_RESUME_DRAWING )
+                    al_acknowledge_drawing_resume( display );
+
+                // The frame bitmap isn't kept while drawing is stopped.
+                drawingHalted = false;
+                Graphics::InvalidateFrame();
+                updated = true;
+                presentNeeded = true;
             }
             else if ( event.any.type == ALLEGRO_EVENT_JOYSTICK_CONFIGURATION )
             {
@@ -85,23 +203,54 @@ void Run()
 
         double now = al_get_time();
 
-        while ( (now - startTime) >= FrameTime )
+        if ( IsFastForwarding() )
         {
-            frameCounter++;
+            // Run as many frames as fit in one display frame, and only
+            // draw the last one.
+            do
+            {
+                UpdateFrame();
+                capturedLast = DrawCapturedFrame();
+            } while ( IsFastForwarding() && (al_get_time() - now) < FrameTime );
 
-            Input::Update();
-            World::Update();
-            Sound::Update();
+            startTime = al_get_time() - FrameTime;
+            updated = true;
+        }
+
+        while ( (now - startTime) >= FrameTime )
+        {
+            UpdateFrame();
+            capturedLast = DrawCapturedFrame();
 
             startTime += FrameTime;
             updated = true;
         }
 
         if ( updated )
+            framesSinceDraw++;
+
+        if ( switchedOut && framesSinceDraw < BackgroundDrawInterval )
+            updated = false;
+
+        // A frame that's the same as the one shown isn't shown again. Then,
+        // nothing waits for the display, and the loop sleeps until the
+        // next frame.
+        if ( updated && !drawingHalted )
         {
-            World::Draw();
+            // A captured frame is shown as it is, unless run-ahead shows
+            // a later one.
+            if ( !capturedLast || IsRunningAhead() )
+                DrawFrame();
+
+            capturedLast = false;
+            framesSinceDraw = 0;
 
-            al_flip_display();
+            if ( Graphics::IsFrameChanged() || presentNeeded )
+            {
+                Graphics::Present();
+                al_flip_display();
+                presentNeeded = false;
+            }
         }
 
         double timeLeft = startTime + FrameTime - al_get_time();
@@ -112,44 +261,428 @@ void Run()
     }
 
 Done:
-    World::Uninit();
+    EndGame();
 }
 
-void ResizeView( int screenWidth, int screenHeight )
+static void ReadStartProfile( int slot, Profile& profile )
 {
-    float viewAspect = StdViewWidth / (float) StdViewHeight;
-    float screenAspect = screenWidth / (float) screenHeight;
-    // Only allow whole number scaling
-    int scale = 1;
+    if ( !SaveFolder::ReadProfile( slot, profile ) )
+    {
+        profile.Items[ItemSlot_HeartContainers] = DefaultHearts;
+        profile.Items[ItemSlot_MaxBombs] = DefaultBombs;
+    }
+}
 
-    if ( viewAspect > screenAspect )
+static void StartFromSlot( int slot )
+{
+    Profile profile;
+
+    ReadStartProfile( slot, profile );
+
+    World::Start( slot, profile );
+}
+
+static bool OpenHashLogs()
+{
+    if ( hashLogPath != nullptr && !hashLog.Create( hashLogPath ) )
     {
-        scale = screenWidth / StdViewWidth;
+        fprintf( stderr, "Could not create hash log: %s\n", hashLogPath );
+        return false;
+    }
+
+    if ( checkPath != nullptr && !checkLog.Open( checkPath ) )
+    {
+        fprintf( stderr, "Could not open hash log: %s\n", checkPath );
+        return false;
+    }
+
+    return true;
+}
+
+static bool StartGame()
+{
+    if ( !OpenHashLogs() )
+        return false;
+
+    if ( exportName[0] != '\0' && !stateExporter.Open( exportName, exportSlots ) )
+        fprintf( stderr, "Could not open shared memory for the state export: %s\n", exportName );
+
+    if ( playPath != nullptr )
+    {
+        if ( !moviePlayer.Open( playPath ) )
+        {
+            fprintf( stderr, "Could not open movie: %s\n", playPath );
+            return false;
+        }
+
+        const MovieHeader& header = moviePlayer.GetHeader();
+
+        SaveFolder::SetReadOnly( true );
+
+        World::Init();
+        World::SetRandomSeed( header.Seed );
+        World::Start( header.Slot, header.StartProfile );
     }
     else
     {
-        scale = screenHeight / StdViewHeight;
+        World::Init();
+        World::SetRandomSeed( randomSeed );
+
+        if ( recordPath != nullptr )
+        {
+            // A movie can only reproduce a game that doesn't depend on the
+            // menus and the files they show. So, start straight from a slot.
+            Profile profile;
+            int slot = startSlot >= 0 ? startSlot : 0;
+
+            ReadStartProfile( slot, profile );
+
+            if ( !movieRecorder.Open( recordPath, randomSeed, slot, profile ) )
+            {
+                fprintf( stderr, "Could not create movie: %s\n", recordPath );
+                World::Uninit();
+                return false;
+            }
+
+            World::Start( slot, profile );
+        }
+        else if ( startSlot >= 0 )
+        {
+            StartFromSlot( startSlot );
+        }
+
+        // Stepping back would break the link between a movie and its frames.
+        if ( !headless && recordPath == nullptr && rewindSeconds > 0 )
+        {
+            size_t capacity = rewindMegabytes * 1024 * 1024;
+            int maxFrames = rewindSeconds * 60 + 1;
+
+            if ( !rewindBuffer.Init( capacity, maxFrames, RewindKeyframeInterval ) )
+                _RPT0( _CRT_WARN, "Could not allocate the rewind buffer.\n" );
+        }
+    }
+
+    // Playing a movie headless with the software renderer is the fastest
+    // way to capture it.
+    if ( capturePath != nullptr )
+    {
+        if ( !frameCapture.Open( capturePath, captureAudioPath, CaptureQueueLength ) )
+        {
+            fprintf( stderr, "Could not create capture: %s\n", capturePath );
+            World::Uninit();
+            return false;
+        }
+
+        if ( captureAudioPath != nullptr )
+            Sound::SetMixListener( CaptureAudio, &frameCapture );
+    }
+
+    // A movie being played runs ahead with its own buttons, which are the
+    // polled ones while it plays.
+    if ( !headless && runAheadFrames > 0 )
+        runAheadSnapshot = World::CreateSnapshot();
+
+    return true;
+}
+
+static void CaptureAudio( const int16_t* samples, int frameCount, void* data )
+{
+    FrameCapture* capture = (FrameCapture*) data;
+    capture->WriteAudio( samples, frameCount );
+}
+
+// The game loop never waits for the capture to write a frame, and drops
+// the frame instead. Without a display, there's no one to wait for, so no
+// frame is dropped.
+
+static void CaptureFrame( bool wait )
+{
+    if ( !frameCapture.IsOpen() )
+        return;
+
+    uint32_t* pixels = frameCapture.BeginFrame( wait );
+    if ( pixels == nullptr )
+        return;
+
+    if ( Graphics::ReadFrameArgb( pixels ) )
+        frameCapture.EndFrame();
+}
+
+// While capturing, every frame is drawn and captured, including the ones
+// that are never shown. The capture gets the world as it is, and not as
+// run-ahead predicts it. Returns true if a frame was drawn.
+
+static bool DrawCapturedFrame()
+{
+    if ( !frameCapture.IsOpen() )
+        return false;
+
+    drawnFrameCount++;
+    World::Draw();
+    CaptureFrame( false );
+    return true;
+}
+
+static void HashFrame()
+{
+    if ( !hashLog.IsOpen() && !checkLog.IsOpen() )
+        return;
+
+    uint64_t hash = World::HashState();
+
+    hashLog.Write( frameNumber, hash );
+
+    if ( !checkLog.IsOpen() )
+        return;
+
+    uint32_t refFrame = 0;
+    uint64_t refHash = 0;
+
+    if ( !checkLog.Read( refFrame, refHash ) )
+    {
+        printf( "Frame %u: the reference ends before the movie\n", frameNumber );
+        checkFailed = true;
+    }
+    else if ( refFrame != frameNumber || refHash != hash )
+    {
+        printf( "Frame %u: hash %016llx differs from the reference's %016llx\n",
+            frameNumber, (unsigned long long) hash, (unsigned long long) refHash );
+        checkFailed = true;
+    }
+
+    // Only the first difference matters. Everything after it follows.
+    if ( checkFailed )
+        checkLog.Close();
+}
+
+static void SaveRewindFrame()
+{
+    if ( !rewindBuffer.IsEnabled() )
+        return;
+
+    GameMode mode = World::GetMode();
+
+    // Menus aren't part of a saved frame. So, rewinding stops when it
+    // reaches the last menu.
+    if ( mode == Mode_GameMenu || mode == Mode_Register || mode == Mode_Elimination )
+    {
+        rewindBuffer.Clear();
+        return;
+    }
+
+    rewindBuffer.Push();
+}
+
+static void UpdateFrame()
+{
+    if ( moviePlayer.IsOpen() )
+    {
+        InputButtons buttons = 0;
+
+        if ( moviePlayer.Next( buttons ) )
+        {
+            Input::Update( buttons );
+        }
+        else
+        {
+            // Hand control back to the devices.
+            moviePlayer.Close();
+            Input::Update();
+        }
+    }
+    else
+    {
+        Input::Update();
+        movieRecorder.Record( Input::GetPolledButtons() );
+    }
+
+    // While the rewind key is held, go back one frame instead of running one.
+    if ( rewindBuffer.IsEnabled() && Input::IsKeyDown( rewindKey ) && rewindBuffer.StepBack() )
+        return;
+
+    World::Update();
+    Sound::Update();
+
+    frameNumber++;
+
+    HashFrame();
+    stateExporter.Write( frameNumber );
+    SaveRewindFrame();
+}
+
+// The game acts on input a frame or two after it's read, like the original.
+// To hide that delay, run the world ahead with the latest input, draw what
+// it shows, then put the world back. Only the frames run by UpdateFrame
+// count, so the game itself stays the same.
+
+static void DrawFrame()
+{
+    drawnFrameCount++;
+
+    if ( !IsRunningAhead() )
+    {
+        World::Draw();
+        return;
+    }
+
+    InputButtons buttons = Input::GetPolledButtons();
+    bool readOnly = SaveFolder::IsReadOnly();
+
+    World::SaveSnapshot( runAheadSnapshot );
+
+    SaveFolder::SetReadOnly( true );
+    Sound::SetMuted( true );
+
+    for ( uint32_t i = 0; i < runAheadFrames; i++ )
+    {
+        Input::Update( buttons );
+        World::Update();
+        Sound::Update();
+    }
+
+    World::Draw();
+
+    World::LoadSnapshot( runAheadSnapshot );
+
+    Sound::SetMuted( false );
+    SaveFolder::SetReadOnly( readOnly );
+}
+
+static void EndGame()
+{
+    if ( checkLog.IsOpen() )
+    {
+        uint32_t refFrame = 0;
+        uint64_t refHash = 0;
+
+        if ( checkLog.Read( refFrame, refHash ) )
+        {
+            printf( "Frame %u: the movie ends before the reference\n", refFrame );
+            checkFailed = true;
+        }
+        else
+        {
+            printf( "All %u frames match the reference\n", frameNumber );
+        }
+
+        checkLog.Close();
+    }
+
+    hashLog.Close();
+    stateExporter.Close();
+
+    if ( frameCapture.IsOpen() )
+    {
+        Sound::SetMixListener( nullptr, nullptr );
+        frameCapture.Close();
+
+        printf( "Captured %u frames, dropped %u frames and %u samples\n",
+            frameCapture.GetFrameCount(),
+            frameCapture.GetDroppedFrameCount(),
+            frameCapture.GetDroppedSampleCount() );
+    }
+
+    if ( showDrawStats && drawnFrameCount > 0 )
+    {
+        Graphics::DrawStats stats;
+        Graphics::GetDrawStats( stats );
+
+        printf( "Drew %u frames: %.1f draws, %.1f batches and %.2f palette uploads a frame\n",
+            drawnFrameCount,
+            stats.Draws / (double) drawnFrameCount,
+            stats.Batches / (double) drawnFrameCount,
+            stats.PaletteUploads / (double) drawnFrameCount );
+        printf( "%u frames were the same as the one before\n", stats.UnchangedFrames );
+        // So that runs with [graphics] atlas=0 and atlas=1 can be told apart.
+        printf( "The atlas was %s: %u pages, and %u sheets on their own\n",
+            useAtlas ? "on" : "off",
+            stats.AtlasPages,
+            stats.SeparateSheets );
+
+        // A second of game time. Capturing and run-ahead draw more frames
+        // than the game runs, and fast-forwarding and switching out fewer.
+        uint32_t redrawCount = StatusBar::GetRedrawCount();
+        double gameSeconds = frameNumber * FrameTime;
+
+        printf( "The status bar was drawn again %u times, %.2f a second\n",
+            redrawCount,
+            gameSeconds > 0 ? redrawCount / gameSeconds : 0.0 );
     }
 
-    if ( scale <= 0 )
+    if ( movieRecorder.IsOpen() && !movieRecorder.Close() )
+        fprintf( stderr, "Could not finish movie: %s\n", recordPath );
+
+    moviePlayer.Close();
+    rewindBuffer.Uninit();
+
+    if ( runAheadSnapshot != nullptr )
+    {
+        World::DestroySnapshot( runAheadSnapshot );
+        runAheadSnapshot = nullptr;
+    }
+
+    World::Uninit();
+    TextCache::Uninit();
+}
+
+void RunHeadless()
+{
+    if ( !StartGame() )
+        return;
+
+    uint32_t frameCount = headlessFrameCount;
+
+    // Play the whole movie, and nothing after it.
+    if ( moviePlayer.IsOpen() )
+        frameCount = moviePlayer.GetHeader().FrameCount;
+
+    double startTime = al_get_time();
+
+    for ( uint32_t i = 0; i < frameCount && !checkFailed; i++ )
+    {
+        UpdateFrame();
+
+        if ( Graphics::IsSoftware() )
+        {
+            DrawFrame();
+            CaptureFrame( true );
+        }
+    }
+
+    frameCount = frameNumber;
+
+    double elapsed = al_get_time() - startTime;
+    double framesPerSec = 0;
+
+    if ( elapsed > 0 )
+        framesPerSec = frameCount / elapsed;
+
+    printf( "%u frames in %.3f s: %.0f frames/s\n", frameCount, elapsed, framesPerSec );
+
+    EndGame();
+}
+
+void ResizeView( int screenWidth, int screenHeight )
+{
+    float scale = Util::Min( 
+        screenWidth / (float) StdViewWidth, 
+        screenHeight / (float) StdViewHeight );
+
+    // Only allow whole number scaling, unless the frame is filtered for
+    // other sizes.
+    if ( !sharpScaling )
+        scale = floorf( scale );
+
+    if ( scale < 1 )
         scale = 1;
 
-    int viewWidth = StdViewWidth * scale;
-    int viewHeight = StdViewHeight * scale;
+    int viewWidth = (int) (StdViewWidth * scale);
+    int viewHeight = (int) (StdViewHeight * scale);
 
     // It looks better when the offsets are whole numbers
     int offsetX = (screenWidth - viewWidth) / 2;
     int offsetY = (screenHeight - viewHeight) / 2;
 
-    al_set_clipping_rectangle( offsetX, offsetY, viewWidth, viewHeight );
-
-    ALLEGRO_TRANSFORM t;
-
-    al_identity_transform( &t );
-    al_scale_transform( &t, scale, scale );
-    al_translate_transform( &t, offsetX, offsetY );
-    al_use_transform( &t );
-
     Graphics::SetViewParams( scale, offsetX, offsetY );
 }
 
@@ -188,7 +721,7 @@ bool MakeDisplay()
 {
     int width = StdViewWidth * 2;
     int height = StdViewHeight * 2;
-    int newFlags = ALLEGRO_RESIZABLE | ALLEGRO_PROGRAMMABLE_PIPELINE;
+    int newFlags = ALLEGRO_RESIZABLE | ALLEGRO_PROGRAMMABLE_PIPELINE | ALLEGRO_GENERATE_EXPOSE_EVENTS;
     int rendererFlag = GetGraphicsRendererDisplayFlag();
 
     if ( rendererFlag == 0 )
@@ -256,6 +789,11 @@ bool InitAllegro()
 
     globalConfig = LoadConfig();
 
+    LoadRewindConfig();
+    LoadLatencyConfig();
+    LoadExportConfig();
+    LoadGraphicsConfig();
+
     if ( !MakeDisplay() )
         return false;
 
@@ -266,6 +804,15 @@ bool InitAllegro()
     if ( !Graphics::Init() )
         return false;
 
+    Graphics::SetAtlasEnabled( useAtlas );
+
+    if ( sharpScaling && !Graphics::SetSharpScaling( true ) )
+    {
+        fprintf( stderr, "Sharp scaling is not available\n" );
+        sharpScaling = false;
+        ResizeView( al_get_display_width( display ), al_get_display_height( display ) );
+    }
+
     if ( !Sound::Init() )
         return false;
 
@@ -277,12 +824,309 @@ bool InitAllegro()
     return true;
 }
 
+bool InitAllegroHeadless( bool software )
+{
+    if ( !al_init() )
+        return false;
+
+    globalConfig = LoadConfig();
+
+    LoadExportConfig();
+
+    if ( software )
+    {
+        if ( !al_init_image_addon() )
+            return false;
+
+        if ( !Graphics::InitSoftware() )
+            return false;
+    }
+    else if ( !Graphics::InitHeadless() )
+    {
+        return false;
+    }
+
+    if ( !Sound::InitHeadless() )
+        return false;
+
+    Input::InitHeadless();
+
+    al_destroy_config( globalConfig );
+    globalConfig = nullptr;
+
+    return true;
+}
+
+static bool ParseUInt( const char* str, uint32_t& value )
+{
+    if ( str == nullptr )
+        return false;
+    char* endPtr = nullptr;
+    value = strtoul( str, &endPtr, 10 );
+    return endPtr != str && *endPtr == '\0';
+}
+
+static bool ParseUInt64( const char* str, uint64_t& value )
+{
+    if ( str == nullptr )
+        return false;
+    char* endPtr = nullptr;
+    value = _strtoui64( str, &endPtr, 0 );
+    return endPtr != str && *endPtr == '\0';
+}
+
+static void LoadRewindConfig()
+{
+    if ( globalConfig == nullptr )
+        return;
+
+    const char* strValue = nullptr;
+    uint32_t value = 0;
+
+    strValue = al_get_config_value( globalConfig, RewindSection, "seconds" );
+    if ( ParseUInt( strValue, value ) && value <= 60 * 60 )
+        rewindSeconds = value;
+
+    strValue = al_get_config_value( globalConfig, RewindSection, "megabytes" );
+    if ( ParseUInt( strValue, value ) && value > 0 && value < 4096 )
+        rewindMegabytes = value;
+
+    strValue = al_get_config_value( globalConfig, RewindSection, "key" );
+    if ( ParseUInt( strValue, value ) && value > 0 && value < ALLEGRO_KEY_MAX )
+        rewindKey = value;
+}
+
+static void LoadLatencyConfig()
+{
+    if ( globalConfig == nullptr )
+        return;
+
+    const char* strValue = al_get_config_value( globalConfig, LatencySection, "runahead" );
+    uint32_t value = 0;
+
+    if ( ParseUInt( strValue, value ) && value <= MaxRunAheadFrames )
+        runAheadFrames = value;
+}
+
+static void LoadExportConfig()
+{
+    if ( globalConfig == nullptr )
+        return;
+
+    const char* strValue = al_get_config_value( globalConfig, ExportSection, "name" );
+    uint32_t value = 0;
+
+    if ( strValue != nullptr && strlen( strValue ) < sizeof exportName )
+        strcpy_s( exportName, strValue );
+
+    strValue = al_get_config_value( globalConfig, ExportSection, "slots" );
+    if ( ParseUInt( strValue, value ) && value > 0 && value <= 256 )
+        exportSlots = value;
+}
+
+static void LoadGraphicsConfig()
+{
+    if ( globalConfig == nullptr )
+        return;
+
+    const char* strValue = al_get_config_value( globalConfig, GraphicsSection, "atlas" );
+    uint32_t value = 0;
+
+    if ( ParseUInt( strValue, value ) && value <= 1 )
+        useAtlas = value != 0;
+
+    strValue = al_get_config_value( globalConfig, GraphicsSection, "scaling" );
+
+    if ( strValue != nullptr )
+    {
+        if ( 0 == _stricmp( strValue, "sharp" ) )
+            sharpScaling = true;
+        else if ( 0 == _stricmp( strValue, "whole" ) )
+            sharpScaling = false;
+    }
+}
+
+static bool ParseCommandLine( int argc, char* argv[] )
+{
+    for ( int i = 1; i < argc; i++ )
+    {
+        const char* arg = argv[i];
+
+        if ( 0 == _stricmp( arg, "-headless" ) )
+        {
+            headless = true;
+
+            // The frame count is optional.
+            if ( i + 1 < argc && ParseUInt( argv[i + 1], headlessFrameCount ) )
+                i++;
+        }
+        else if ( 0 == _stricmp( arg, "-software" ) )
+        {
+            softwareRender = true;
+        }
+        else if ( 0 == _stricmp( arg, "-bench" ) )
+        {
+            benchmark = true;
+        }
+        else if ( 0 == _stricmp( arg, "-drawstats" ) )
+        {
+            showDrawStats = true;
+        }
+        else if ( 0 == _stricmp( arg, "-capture" ) )
+        {
+            if ( i + 1 >= argc )
+                return false;
+
+            capturePath = argv[++i];
+        }
+        else if ( 0 == _stricmp( arg, "-captureaudio" ) )
+        {
+            if ( i + 1 >= argc )
+                return false;
+
+            captureAudioPath = argv[++i];
+        }
+        else if ( 0 == _stricmp( arg, "-slot" ) )
+        {
+            uint32_t slot = 0;
+
+            if ( i + 1 >= argc || !ParseUInt( argv[++i], slot ) || slot >= MaxProfiles )
+                return false;
+
+            startSlot = slot;
+        }
+        else if ( 0 == _stricmp( arg, "-seed" ) )
+        {
+            if ( i + 1 >= argc || !ParseUInt64( argv[++i], randomSeed ) )
+                return false;
+        }
+        else if ( 0 == _stricmp( arg, "-record" ) )
+        {
+            if ( i + 1 >= argc )
+                return false;
+
+            recordPath = argv[++i];
+        }
+        else if ( 0 == _stricmp( arg, "-play" ) )
+        {
+            if ( i + 1 >= argc )
+                return false;
+
+            playPath = argv[++i];
+        }
+        else if ( 0 == _stricmp( arg, "-fast" ) )
+        {
+            fastPlayback = true;
+        }
+        else if ( 0 == _stricmp( arg, "-hashlog" ) )
+        {
+            if ( i + 1 >= argc )
+                return false;
+
+            hashLogPath = argv[++i];
+        }
+        else if ( 0 == _stricmp( arg, "-verify" ) )
+        {
+            if ( i + 1 >= argc )
+                return false;
+
+            verifyPath = argv[++i];
+        }
+        else if ( 0 == _stricmp( arg, "-threads" ) )
+        {
+            if ( i + 1 >= argc || !ParseUInt( argv[++i], verifyThreads ) )
+                return false;
+        }
+        else if ( 0 == _stricmp( arg, "-check" ) )
+        {
+            if ( i + 1 >= argc )
+                return false;
+
+            checkPath = argv[++i];
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    // A movie can't be recorded while another is playing.
+    if ( recordPath != nullptr && playPath != nullptr )
+        return false;
+
+    // Frames are drawn in memory only when there's no display.
+    if ( softwareRender && !headless )
+        return false;
+
+    // Without a display, frames can only be captured if they're drawn in
+    // memory, and there's no audio.
+    if ( captureAudioPath != nullptr && (capturePath == nullptr || headless) )
+        return false;
+    if ( capturePath != nullptr && headless && !softwareRender )
+        return false;
+
+    // Checking compares the frames of a movie.
+    if ( checkPath != nullptr && playPath == nullptr )
+        return false;
+
+    // Only the display counts draws.
+    if ( showDrawStats && headless )
+        return false;
+
+    return true;
+}
+
+// A library build of LozEnv.h has no main. See LozEnv.h.
+
+#ifndef LOZENV_EXPORTS
+
 int main( int argc, char* argv[] )
 {
-    if ( InitAllegro() )
+    if ( !ParseCommandLine( argc, argv ) )
+    {
+        fprintf( stderr, "Usage: %s [-headless [frames] [-software]] [-slot n] [-seed n]\n"
+            "       [-record file | -play file [-fast] [-check hashlog]]\n"
+            "       [-hashlog file] [-capture file [-captureaudio file]] [-drawstats]\n"
+            "       %s -verify folder [-threads n]\n"
+            "       %s -bench\n", argv[0], argv[0], argv[0] );
+        return 1;
+    }
+
+    if ( benchmark )
+    {
+        if ( !al_init() )
+            return 1;
+
+        Blit::RunBenchmark();
+        return 0;
+    }
+
+    if ( verifyPath != nullptr )
+    {
+        bool passed = false;
+
+        // Replays must never touch the player's files.
+        SaveFolder::SetReadOnly( true );
+
+        if ( InitAllegroHeadless( softwareRender ) )
+            passed = VerifyMovies( verifyPath, verifyThreads );
+
+        return passed ? 0 : 2;
+    }
+
+    if ( headless )
+    {
+        if ( InitAllegroHeadless( softwareRender ) )
+        {
+            RunHeadless();
+        }
+    }
+    else if ( InitAllegro() )
     {
         Run();
     }
 
-    return 0;
+    return checkFailed ? 2 : 0;
 }
+
+#endif
@@ -0,0 +1,111 @@
+/*
+   Copyright 2017 Aldo J. Nunez
+
+   Licensed under the Apache License, Version 2.0.
+   See the LICENSE text file for details.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+
+/*
+   A C interface for driving a batch of worlds in lockstep, one action a
+   step for each, the way agent training wants them.
+
+   An action is a buttons byte, the same as InputButtons. Each step repeats
+   the action for the frame skip count of frames, and adds up the rewards.
+   Stepping never allocates memory in this interface.
+
+   The default reward is the change in hearts, in whole hearts, plus one
+   for every monster killed. A world is done when the player dies or wins.
+   A done world stays put until it's reset.
+
+   Frames are drawn with the software renderer. Each byte of a frame is a
+   system palette color, or LozEnv_FrameBlack.
+
+   To build a library that exports these functions, compile the game's
+   sources with LOZENV_EXPORTS defined. That leaves out the game's main.
+   The Visual Studio project only builds the game itself.
+*/
+
+#if defined( LOZENV_EXPORTS ) && defined( _WIN32 )
+#define LOZENV_API __declspec(dllexport)
+#elif defined( LOZENV_EXPORTS )
+#define LOZENV_API __attribute__(( visibility( "default" ) ))
+#else
+#define LOZENV_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum
+{
+    LozEnv_MaxObjects   = 26,
+    LozEnv_MaxItems     = 32,
+
+    LozEnv_FrameWidth   = 256,
+    LozEnv_FrameHeight  = 240,
+    LozEnv_FrameSize    = LozEnv_FrameWidth * LozEnv_FrameHeight,
+    LozEnv_FrameBlack   = 64,
+};
+
+typedef struct LozEnvObject
+{
+    uint8_t     Type;       /* 0 for an empty slot */
+    uint8_t     X;
+    uint8_t     Y;
+    uint8_t     Facing;
+    uint8_t     HP;
+    uint8_t     Reserved[3];
+} LozEnvObject;
+
+typedef struct LozEnvObservation
+{
+    int32_t         Mode;
+    int32_t         RoomId;
+    uint8_t         PlayerX;
+    uint8_t         PlayerY;
+    uint8_t         PlayerFacing;
+    uint8_t         Reserved;
+    uint16_t        Hearts;     /* 0x100 for each heart */
+    uint8_t         HeartContainers;
+    uint8_t         Reserved2;
+    uint8_t         Items[LozEnv_MaxItems];
+    LozEnvObject    Objects[LozEnv_MaxObjects];
+} LozEnvObservation;
+
+typedef struct LozEnv LozEnv;
+
+/* Returns null if the game's resources can't be loaded. */
+LOZENV_API LozEnv* LozEnv_Create( int count, int frameSkip );
+LOZENV_API void LozEnv_Destroy( LozEnv* env );
+
+LOZENV_API int LozEnv_GetCount( const LozEnv* env );
+
+/* World i is seeded with seed + i. */
+LOZENV_API void LozEnv_Reset( LozEnv* env, uint64_t seed );
+LOZENV_API void LozEnv_ResetOne( LozEnv* env, int index, uint64_t seed );
+
+/* Each array has one element for each world, and frames has
+   LozEnv_FrameSize bytes for each. Any output can be null. Frames are only
+   drawn when asked for. */
+LOZENV_API void LozEnv_Step(
+    LozEnv* env,
+    const uint8_t* actions,
+    LozEnvObservation* observations,
+    float* rewards,
+    uint8_t* dones,
+    uint8_t* frames );
+
+LOZENV_API void LozEnv_Observe( LozEnv* env, int index, LozEnvObservation* observation );
+
+/* Draws a world's frame into LozEnv_FrameSize bytes. */
+LOZENV_API void LozEnv_Render( LozEnv* env, int index, uint8_t* frame );
+
+#ifdef __cplusplus
+}
+#endif
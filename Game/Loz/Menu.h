@@ -14,4 +14,5 @@ public:
     virtual ~Menu() { }
     virtual void Update() = 0;
     virtual void Draw() = 0;
+    virtual Menu* Clone() = 0;
 };
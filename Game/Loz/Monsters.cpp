@@ -19,6 +19,7 @@
 #include "Profile.h"
 #include "Sound.h"
 #include "SoundId.h"
+#include "StateHash.h"
 
 
 struct WalkerSpec
@@ -43,6 +44,12 @@ const ObjType ShotFromOctorock  = Obj_FlyingRock;
 
 const int DirCount = 4;
 
+
+static RoomMonsterData& GetRoomData()
+{
+    return World::GetRoomMonsterData();
+}
+
 static const uint8_t    armosAnimMap[DirCount] = 
 {
     Anim_OW_Armos_Right,
@@ -454,6 +461,15 @@ Walker::Walker( ObjType type, const WalkerSpec* spec, int x, int y )
     objY = y;
 }
 
+void Walker::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    HashAnimator( hash, animator );
+    hash.AddValue( curSpeed );
+    hash.AddValue( shootTimer );
+    hash.AddValue( wantToShoot );
+}
+
 void Walker::Draw()
 {
     SetFacingAnimation();
@@ -650,6 +666,12 @@ Goriya::Goriya( ObjType type, const WalkerSpec* spec, int x, int y )
     SetFacingAnimation();
 }
 
+void Goriya::HashState( StateHash& hash )
+{
+    ChaseWalker::HashState( hash );
+    hash.AddValue( shotRef.Id );
+}
+
 void* Goriya::GetInterface( ObjInterfaces iface )
 {
     if ( iface == ObjItf_IThrower )
@@ -678,7 +700,7 @@ void Goriya::Update()
 {
     animator.Advance();
 
-    if ( shotRef.Obj != nullptr )
+    if ( shotRef.Get() != nullptr )
         return;
 
     ObjMove( curSpeed );
@@ -736,6 +758,12 @@ Armos::Armos( int x, int y )
         curSpeed = 0x60;
 }
 
+void Armos::HashState( StateHash& hash )
+{
+    ChaseWalker::HashState( hash );
+    hash.AddValue( state );
+}
+
 void Armos::Update()
 {
     int slot = World::GetCurrentObjectSlot();
@@ -792,6 +820,13 @@ Wanderer::Wanderer( ObjType type, const WalkerSpec* spec, int turnRate, int x, i
 {
 }
 
+void Wanderer::HashState( StateHash& hash )
+{
+    Walker::HashState( hash );
+    hash.AddValue( turnTimer );
+    hash.AddValue( turnRate );
+}
+
 void Wanderer::Update()
 {
     animator.Advance();
@@ -1063,6 +1098,12 @@ Gel::Gel( ObjType type, int x, int y, Direction dir, int fraction )
     SetFacingAnimation();
 }
 
+void Gel::HashState( StateHash& hash )
+{
+    Wanderer::HashState( hash );
+    hash.AddValue( state );
+}
+
 void Gel::Update()
 {
     switch ( state )
@@ -1145,6 +1186,12 @@ Zol::Zol( int x, int y )
     SetFacingAnimation();
 }
 
+void Zol::HashState( StateHash& hash )
+{
+    Wanderer::HashState( hash );
+    hash.AddValue( state );
+}
+
 void Zol::Update()
 {
     switch ( state )
@@ -1318,6 +1365,12 @@ Vire::Vire( int x, int y )
     SetFacingAnimation();
 }
 
+void Vire::HashState( StateHash& hash )
+{
+    Wanderer::HashState( hash );
+    hash.AddValue( state );
+}
+
 void Vire::Update()
 {
     switch ( state )
@@ -1403,6 +1456,12 @@ LikeLike::LikeLike( int x, int y )
     SetFacingAnimation();
 }
 
+void LikeLike::HashState( StateHash& hash )
+{
+    Wanderer::HashState( hash );
+    hash.AddValue( framesHeld );
+}
+
 void LikeLike::Update()
 {
     Player* player = World::GetPlayer();
@@ -1542,6 +1601,12 @@ DigWanderer::DigWanderer( ObjType type, const WalkerSpec** stateSpecs, const int
     objTimer = 0;
 }
 
+void DigWanderer::HashState( StateHash& hash )
+{
+    Wanderer::HashState( hash );
+    hash.AddValue( state );
+}
+
 void DigWanderer::Update()
 {
     Move();
@@ -1697,8 +1762,6 @@ void Zora::Update()
 //  RedLeever
 //----------------------------------------------------------------------------
 
-int RedLeever::count;
-
 static const WalkerSpec redLeeverHiddenSpec = 
 {
     0,
@@ -1776,13 +1839,22 @@ RedLeever::RedLeever( int x, int y )
     World::SetStunTimer( RedLeeverClassTimerSlot, 5 );
 }
 
+void RedLeever::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    HashAnimator( hash, animator );
+    hash.AddValue( state );
+}
+
 void RedLeever::Update()
 {
+    int&    count = GetRoomData().RedLeeverCount;
+
     bool advanceState = false;
 
     if ( state == 0 )
     {
-        if ( RedLeever::count >= 2 
+        if ( count >= 2 
             || World::GetStunTimer( RedLeeverClassTimerSlot ) != 0 )
             return;
         if ( !TargetPlayer() )
@@ -1820,10 +1892,10 @@ void RedLeever::Update()
         SetSpec( redLeeverSpecs[state] );
 
         if ( state == 1 )
-            RedLeever::count++;
+            count++;
         else if ( state == 0 )
-            RedLeever::count--;
-        assert( RedLeever::count >= 0 && RedLeever::count <= 2 );
+            count--;
+        assert( count >= 0 && count <= 2 );
     }
 
     animator.Advance();
@@ -1832,7 +1904,7 @@ void RedLeever::Update()
     {
         CheckCollisions();
         if ( decoration != 0 && GetType() == Obj_RedLeever )
-            RedLeever::count--;
+            count--;
     }
 }
 
@@ -1909,7 +1981,7 @@ bool RedLeever::TargetPlayer()
 
 void RedLeever::ClearRoomData()
 {
-    RedLeever::count = 0;
+    GetRoomData().RedLeeverCount = 0;
 }
 
 
@@ -1970,6 +2042,18 @@ Flyer::Flyer( ObjType type, const FlyerSpec* spec, int x, int y )
     objY = y;
 }
 
+void Flyer::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    HashAnimator( hash, animator );
+    hash.AddValue( state );
+    hash.AddValue( sprintsLeft );
+    hash.AddValue( curSpeed );
+    hash.AddValue( accelStep );
+    hash.AddValue( deferredDir );
+    hash.AddValue( moveCounter );
+}
+
 void Flyer::UpdateStateAndMove()
 {
     Direction origFacing = facing;
@@ -2232,6 +2316,12 @@ FlyingGhini::FlyingGhini( int x, int y )
     curSpeed = 0x1F;
 }
 
+void FlyingGhini::HashState( StateHash& hash )
+{
+    Flyer::HashState( hash );
+    hash.AddValue( state );
+}
+
 void FlyingGhini::Update()
 {
     if ( state == 0 )
@@ -2437,6 +2527,12 @@ Moldorm::Moldorm( int x, int y )
     GoToState( 2, 1 );
 }
 
+void Moldorm::HashState( StateHash& hash )
+{
+    Flyer::HashState( hash );
+    hash.AddValue( oldFacing );
+}
+
 void Moldorm::Update()
 {
     if ( facing == Dir_None )
@@ -2615,9 +2711,6 @@ Patra* Patra::MakePatra( ObjType type )
     return patra;
 }
 
-static int patraAngle[9];
-static int patraState[9];
-
 Patra::Patra( ObjType type )
     :   Flyer( type, &patraSpec, 0x80, 0x70 ),
         xMove( 0 ),
@@ -2631,8 +2724,18 @@ Patra::Patra( ObjType type )
 
     Sound::PlayEffect( SEffect_boss_roar3, true, Sound::AmbientInstance );
 
-    memset( patraAngle, 0, sizeof patraAngle );
-    memset( patraState, 0, sizeof patraState );
+    RoomMonsterData& roomData = GetRoomData();
+    memset( roomData.PatraAngles, 0, sizeof roomData.PatraAngles );
+    memset( roomData.PatraStates, 0, sizeof roomData.PatraStates );
+}
+
+void Patra::HashState( StateHash& hash )
+{
+    Flyer::HashState( hash );
+    hash.AddValue( xMove );
+    hash.AddValue( yMove );
+    hash.AddValue( maneuverState );
+    hash.AddValue( childStateTimer );
 }
 
 int Patra::GetXMove()
@@ -2652,6 +2755,8 @@ int Patra::GetManeuverState()
 
 void Patra::Update()
 {
+    int*    patraAngle = GetRoomData().PatraAngles;
+
     if ( childStateTimer > 0 )
         childStateTimer--;
 
@@ -2725,6 +2830,15 @@ PatraChild::PatraChild( ObjType type )
     animator.anim = Graphics::GetAnimation( Sheet_Boss, Anim_B3_PatraChild );
 }
 
+void PatraChild::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    hash.AddValue( x );
+    hash.AddValue( y );
+    HashAnimator( hash, animator );
+    hash.AddValue( angleAccum );
+}
+
 static uint16_t ShiftMult( int mask, int addend, int shiftCount )
 {
     uint16_t n = 0;
@@ -2745,6 +2859,8 @@ static uint16_t ShiftMult( int mask, int addend, int shiftCount )
 
 void PatraChild::Update()
 {
+    int*    patraState = GetRoomData().PatraStates;
+
     int slot = World::GetCurrentObjectSlot();
 
     if ( patraState[slot] == 0 )
@@ -2770,6 +2886,8 @@ void PatraChild::Update()
 
 void PatraChild::Draw()
 {
+    int*    patraState = GetRoomData().PatraStates;
+
     int slot = World::GetCurrentObjectSlot();
 
     if ( patraState[slot] != 0 )
@@ -2781,6 +2899,9 @@ void PatraChild::Draw()
 
 void PatraChild::UpdateStart()
 {
+    int*    patraAngle = GetRoomData().PatraAngles;
+    int*    patraState = GetRoomData().PatraStates;
+
     static const uint8_t patraEntryAngles[] = 
     { 0x14, 0x10, 0xC, 0x8, 0x4, 0, 0x1C };
 
@@ -2813,6 +2934,8 @@ void PatraChild::UpdateStart()
 
 void PatraChild::UpdateTurn()
 {
+    int*    patraAngle = GetRoomData().PatraAngles;
+
     int     slot = World::GetCurrentObjectSlot();
     Patra*  patra = (Patra*) World::GetObject( 0 );
 
@@ -3015,6 +3138,17 @@ Jumper::Jumper( ObjType type, const JumperSpec* spec, int x, int y )
     }
 }
 
+void Jumper::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    hash.AddValue( curSpeed );
+    hash.AddValue( accelStep );
+    HashAnimator( hash, animator );
+    hash.AddValue( state );
+    hash.AddValue( targetY );
+    hash.AddValue( reversesPending );
+}
+
 Jumper::~Jumper()
 {
     if ( GetType() == Obj_Boulder )
@@ -3171,8 +3305,6 @@ void Jumper::ConstrainFacing()
 //  Boulders
 //----------------------------------------------------------------------------
 
-int Boulders::sCount;
-
 Boulders::Boulders()
     :   Object( Obj_Boulders )
 {
@@ -3186,7 +3318,7 @@ void Boulders::Update()
 {
     if ( objTimer == 0 )
     {
-        if ( sCount < MaxBoulders )
+        if ( Count() < MaxBoulders )
         {
             Point playerPos = World::GetObservedPlayerPos();
             int y = World::WorldLimitTop;
@@ -3221,12 +3353,12 @@ void Boulders::Draw()
 
 int& Boulders::Count()
 {
-    return sCount;
+    return GetRoomData().BoulderCount;
 }
 
 void Boulders::ClearRoomData()
 {
-    sCount = 0;
+    GetRoomData().BoulderCount = 0;
 }
 
 
@@ -3281,6 +3413,15 @@ Trap::Trap( int trapIndex, int x, int y )
     image.anim = Graphics::GetAnimation( Sheet_Npcs, Anim_UW_Trap );
 }
 
+void Trap::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    hash.AddValue( trapIndex );
+    hash.AddValue( state );
+    hash.AddValue( speed );
+    hash.AddValue( origCoord );
+}
+
 void Trap::Update()
 {
     if ( state == 0 )
@@ -3415,6 +3556,13 @@ Rope::Rope( int x, int y )
         hp = 0x40;
 }
 
+void Rope::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    HashAnimator( hash, animator );
+    hash.AddValue( speed );
+}
+
 void Rope::Update()
 {
     Direction origFacing = facing;
@@ -3523,6 +3671,17 @@ PolsVoice::PolsVoice( int x, int y )
     animator.time = 0;
 }
 
+void PolsVoice::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    hash.AddValue( curSpeed );
+    hash.AddValue( accelStep );
+    hash.AddValue( state );
+    hash.AddValue( stateTimer );
+    hash.AddValue( targetY );
+    HashAnimator( hash, animator );
+}
+
 void PolsVoice::Update()
 {
     if ( !IsStunned() && (GetFrameCounter() & 1) == 0 )
@@ -3683,6 +3842,14 @@ RedWizzrobe::RedWizzrobe()
     animator.time = 0;
 }
 
+void RedWizzrobe::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    HashAnimator( hash, animator );
+    hash.AddValue( stateTimer );
+    hash.AddValue( flashTimer );
+}
+
 void RedWizzrobe::Update()
 {
     if ( World::GetItem( ItemSlot_Clock ) != 0 )
@@ -3873,6 +4040,13 @@ BlueWizzrobeBase::BlueWizzrobeBase( ObjType type, int x, int y )
     decoration = 0;
 }
 
+void BlueWizzrobeBase::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    hash.AddValue( flashTimer );
+    hash.AddValue( turnTimer );
+}
+
 void BlueWizzrobeBase::TruncatePosition()
 {
     objX = (objX + 8) & 0xF0;
@@ -4059,6 +4233,12 @@ BlueWizzrobe::BlueWizzrobe( int x, int y )
     animator.time = 0;
 }
 
+void BlueWizzrobe::HashState( StateHash& hash )
+{
+    BlueWizzrobeBase::HashState( hash );
+    HashAnimator( hash, animator );
+}
+
 void BlueWizzrobe::Update()
 {
     if ( World::GetItem( ItemSlot_Clock ) != 0 )
@@ -4335,6 +4515,16 @@ Wallmaster::Wallmaster()
     animator.anim = Graphics::GetAnimation( Sheet_Npcs, Anim_UW_Wallmaster );
 }
 
+void Wallmaster::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    HashAnimator( hash, animator );
+    hash.AddValue( state );
+    hash.AddValue( dirIndex );
+    hash.AddValue( tilesCrossed );
+    hash.AddValue( holdingPlayer );
+}
+
 void Wallmaster::CalcStartPosition( 
     int playerOrthoCoord, int playerCoord, int dir, 
     int baseDirIndex, int leastCoord, int& orthoCoord, int& coordIndex )
@@ -4490,7 +4680,8 @@ void Wallmaster::UpdateMoving()
 
 Aquamentus::Aquamentus()
     :   Object( Obj_Aquamentus ),
-        distance( 0 )
+        distance( 0 ),
+        fireballOffsets()
 {
     invincibilityMask = 0xE2;
     objX = 0xB0;
@@ -4509,6 +4700,14 @@ Aquamentus::Aquamentus()
     Graphics::UpdatePalettes();
 }
 
+void Aquamentus::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    HashAnimator( hash, animator );
+    hash.AddValue( distance );
+    hash.AddValue( fireballOffsets );
+}
+
 void Aquamentus::Update()
 {
     if ( World::GetItem( ItemSlot_Clock ) == 0 )
@@ -4684,6 +4883,15 @@ Dodongo::Dodongo( int x, int y )
     Graphics::UpdatePalettes();
 }
 
+void Dodongo::HashState( StateHash& hash )
+{
+    Wanderer::HashState( hash );
+    hash.AddValue( state );
+    hash.AddValue( bloatedSubstate );
+    hash.AddValue( bloatedTimer );
+    hash.AddValue( bombHits );
+}
+
 void Dodongo::Update()
 {
     UpdateState();
@@ -4938,10 +5146,6 @@ static const uint8_t manhandlaAnimMap[5] =
     Anim_B2_Manhandla_Body,
 };
 
-int         Manhandla::sPartsDied;
-Direction   Manhandla::sFacingAtFrameBegin;
-Direction   Manhandla::sBounceDir;
-
 
 Object* Manhandla::Make( int x, int y )
 {
@@ -4986,6 +5190,17 @@ Manhandla::Manhandla( int index, int x, int y, Direction facing )
     animator.anim = Graphics::GetAnimation( Sheet_Boss, manhandlaAnimMap[index] );
 }
 
+void Manhandla::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    HashAnimator( hash, animator );
+    hash.AddValue( curSpeedFix );
+    hash.AddValue( speedAccum );
+    hash.AddValue( frameAccum );
+    hash.AddValue( frame );
+    hash.AddValue( oldFrame );
+}
+
 void Manhandla::SetPartFacings( Direction dir )
 {
     for ( int i = 0; i < 5; i++ )
@@ -4999,18 +5214,19 @@ void Manhandla::SetPartFacings( Direction dir )
 void Manhandla::Update()
 {
     int slot = World::GetCurrentObjectSlot();
+    RoomMonsterData& roomData = GetRoomData();
 
     if ( slot == 4 )
     {
         UpdateBody();
-        sFacingAtFrameBegin = facing;
+        roomData.ManhandlaFacingAtFrameBegin = facing;
     }
 
     Move();
     CheckManhandlaCollisions();
 
-    if ( facing != sFacingAtFrameBegin )
-        sBounceDir = facing;
+    if ( facing != roomData.ManhandlaFacingAtFrameBegin )
+        roomData.ManhandlaBounceDir = facing;
 
     frame = (frameAccum & 0x10) >> 4;
 
@@ -5035,7 +5251,9 @@ void Manhandla::Draw()
 
 void Manhandla::UpdateBody()
 {
-    if ( sPartsDied != 0 )
+    RoomMonsterData& roomData = GetRoomData();
+
+    if ( roomData.ManhandlaPartsDied != 0 )
     {
         for ( int i = 0; i < 5; i++ )
         {
@@ -5043,13 +5261,13 @@ void Manhandla::UpdateBody()
             if ( manhandla != nullptr )
                 manhandla->curSpeedFix += 0x80;
         }
-        sPartsDied = 0;
+        roomData.ManhandlaPartsDied = 0;
     }
 
-    if ( sBounceDir != Dir_None )
+    if ( roomData.ManhandlaBounceDir != Dir_None )
     {
-        SetPartFacings( sBounceDir );
-        sBounceDir = Dir_None;
+        SetPartFacings( roomData.ManhandlaBounceDir );
+        roomData.ManhandlaBounceDir = Dir_None;
     }
 
     assert( World::GetCurrentObjectSlot() == MonsterSlot1 + 4 );
@@ -5152,14 +5370,16 @@ void Manhandla::CheckManhandlaCollisions()
         World::SetObject( 4, dummy );
     }
 
-    sPartsDied++;
+    GetRoomData().ManhandlaPartsDied++;
 }
 
 void Manhandla::ClearRoomData()
 {
-    sPartsDied = 0;
-    sFacingAtFrameBegin = Dir_None;
-    sBounceDir = Dir_None;
+    RoomMonsterData& roomData = GetRoomData();
+
+    roomData.ManhandlaPartsDied = 0;
+    roomData.ManhandlaFacingAtFrameBegin = Dir_None;
+    roomData.ManhandlaBounceDir = Dir_None;
 }
 
 
@@ -5184,6 +5404,16 @@ DigdoggerBase::DigdoggerBase( ObjType type, int x, int y )
     Sound::PlayEffect( SEffect_boss_roar3, true, Sound::AmbientInstance );
 }
 
+void DigdoggerBase::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    hash.AddValue( curSpeedFix );
+    hash.AddValue( speedAccum );
+    hash.AddValue( targetSpeedFix );
+    hash.AddValue( accelDir );
+    hash.AddValue( isChild );
+}
+
 void DigdoggerBase::UpdateMove()
 {
     if ( objTimer == 0 )
@@ -5275,6 +5505,15 @@ Digdogger::Digdogger( int x, int y, int childCount )
     Graphics::UpdatePalettes();
 }
 
+void Digdogger::HashState( StateHash& hash )
+{
+    DigdoggerBase::HashState( hash );
+    HashAnimator( hash, animator );
+    HashAnimator( hash, littleAnimator );
+    hash.AddValue( childCount );
+    hash.AddValue( updateBig );
+}
+
 void Digdogger::Update()
 {
     if ( !IsStunned() )
@@ -5383,6 +5622,12 @@ DigdoggerChild::DigdoggerChild( int x, int y )
     animator.anim = Graphics::GetAnimation( Sheet_Boss, Anim_B1_Digdogger_Little );
 }
 
+void DigdoggerChild::HashState( StateHash& hash )
+{
+    DigdoggerBase::HashState( hash );
+    HashAnimator( hash, animator );
+}
+
 void DigdoggerChild::Update()
 {
     if ( !IsStunned() )
@@ -5443,6 +5688,24 @@ Gohma::Gohma( ObjType type )
     rightAnimator.anim = Graphics::GetAnimation( Sheet_Boss, Anim_B2_Gohma_Legs_R );
 }
 
+void Gohma::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    HashAnimator( hash, animator );
+    HashAnimator( hash, leftAnimator );
+    HashAnimator( hash, rightAnimator );
+    hash.AddValue( changeFacing );
+    hash.AddValue( speedAccum );
+    hash.AddValue( distance );
+    hash.AddValue( sprints );
+    hash.AddValue( startOpenEyeTimer );
+    hash.AddValue( eyeOpenTimer );
+    hash.AddValue( eyeClosedTimer );
+    hash.AddValue( shootTimer );
+    hash.AddValue( frame );
+    hash.AddValue( curCheckPart );
+}
+
 int Gohma::GetCurrentCheckPart()
 {
     return curCheckPart;
@@ -5669,6 +5932,19 @@ Gleeok::Gleeok( ObjType type, int x, int y )
     Sound::PlayEffect( SEffect_boss_roar1, true, Sound::AmbientInstance );
 }
 
+void Gleeok::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    HashAnimator( hash, animator );
+    hash.AddValue( writhingTimer );
+    hash.AddValue( neckCount );
+
+    for ( int i = 0; i < neckCount; i++ )
+    {
+        necks[i].HashState( hash );
+    }
+}
+
 void Gleeok::Update()
 {
     Animate();
@@ -5854,6 +6130,19 @@ void GleeokNeck::Init( int index )
     headImage.anim = Graphics::GetAnimation( Sheet_Boss, Anim_B2_Gleeok_Head );
 }
 
+void GleeokNeck::HashState( StateHash& hash )
+{
+    hash.AddValue( parts );
+    hash.AddValue( startHeadTimer );
+    hash.AddValue( xSpeed );
+    hash.AddValue( ySpeed );
+    hash.AddValue( changeXDirTimer );
+    hash.AddValue( changeYDirTimer );
+    hash.AddValue( changeDirsTimer );
+    hash.AddValue( isAlive );
+    hash.AddValue( hp );
+}
+
 void GleeokNeck::Update()
 {
     MoveNeck();
@@ -6109,7 +6398,10 @@ Ganon::Ganon( int x, int y )
         lastHitTimer( 0 ),
         dyingTimer( 0 ),
         frame( 0 ),
-        cloudDist( 0 )
+        cloudDist( 0 ),
+        sparksX(),
+        sparksY(),
+        piecesDir()
 {
     invincibilityMask = 0xFA;
 
@@ -6131,6 +6423,22 @@ Ganon::Ganon( int x, int y )
     // The original game starts roaring here. But, I think it sounds better later.
 }
 
+void Ganon::HashState( StateHash& hash )
+{
+    BlueWizzrobeBase::HashState( hash );
+    hash.AddValue( visual );
+    hash.AddValue( state );
+    hash.AddValue( lastHitTimer );
+    hash.AddValue( dyingTimer );
+    hash.AddValue( frame );
+    hash.AddValue( cloudDist );
+    hash.AddValue( sparksX );
+    hash.AddValue( sparksY );
+    hash.AddValue( piecesDir );
+    HashAnimator( hash, animator );
+    HashAnimator( hash, cloudAnimator );
+}
+
 void Ganon::Update()
 {
     visual = Visual_None;
@@ -6486,6 +6794,12 @@ Zelda::Zelda()
     image.anim = Graphics::GetAnimation( Sheet_Boss, Anim_B3_Zelda_Stand );
 }
 
+void Zelda::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    hash.AddValue( state );
+}
+
 void Zelda::Update()
 {
     Player* player = World::GetPlayer();
@@ -6540,6 +6854,12 @@ StandingFire::StandingFire( int x, int y )
     animator.time = 0;
 }
 
+void StandingFire::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    HashAnimator( hash, animator );
+}
+
 void StandingFire::Update()
 {
     CheckPlayerCollision();
@@ -6567,6 +6887,12 @@ GuardFire::GuardFire( int x, int y )
     animator.time = 0;
 }
 
+void GuardFire::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    HashAnimator( hash, animator );
+}
+
 void GuardFire::Update()
 {
     animator.Advance();
@@ -6661,6 +6987,12 @@ Fairy::Fairy( int x, int y )
     curSpeed = 0x7F;
 }
 
+void Fairy::HashState( StateHash& hash )
+{
+    Flyer::HashState( hash );
+    hash.AddValue( timer );
+}
+
 void Fairy::Update()
 {
     if ( (GetFrameCounter() & 1) == 1 )
@@ -6748,6 +7080,15 @@ PondFairy::PondFairy()
     Sound::PlayEffect( SEffect_item );
 }
 
+void PondFairy::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    hash.AddValue( state );
+    HashAnimator( hash, animator );
+    hash.AddValue( heartState );
+    hash.AddValue( heartAngle );
+}
+
 void PondFairy::Update()
 {
     animator.Advance();
@@ -6866,12 +7207,10 @@ void DeadDummy::Draw()
 //  Statues
 //----------------------------------------------------------------------------
 
-uint8_t Statues::timers[];
-
-
 void Statues::Init()
 {
-    memset( timers, 0, sizeof timers );
+    RoomMonsterData& roomData = GetRoomData();
+    memset( roomData.StatueTimers, 0, sizeof roomData.StatueTimers );
 }
 
 void Statues::Update( int pattern )
@@ -6891,6 +7230,7 @@ void Statues::Update( int pattern )
 
     Player* player = World::GetPlayer();
     int statueCount = statueCounts[pattern];
+    uint8_t* timers = GetRoomData().StatueTimers;
 
     for ( int i = 0; i < statueCount; i++ )
     {
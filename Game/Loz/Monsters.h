@@ -34,6 +34,7 @@ public:
     Walker( ObjType type, const WalkerSpec* spec, int x, int y );
 
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 
 protected:
     void SetSpec( const WalkerSpec* spec );
@@ -75,6 +76,7 @@ public:
 
     virtual void Update();
     virtual void* GetInterface( ObjInterfaces iface );
+    virtual void HashState( StateHash& hash );
 
     virtual void Catch();
 
@@ -92,6 +94,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 };
 
 
@@ -104,6 +107,7 @@ public:
     Wanderer( ObjType type, const WalkerSpec* spec, int turnRate, int x, int y );
 
     virtual void Update();
+    virtual void HashState( StateHash& hash );
 
 protected:
     void Move();
@@ -178,6 +182,7 @@ public:
     Gel( ObjType type, int x, int y, Direction dir, int fraction );
 
     virtual void Update();
+    virtual void HashState( StateHash& hash );
 
 private:
     void UpdateShove();
@@ -193,6 +198,7 @@ public:
     Zol( int x, int y );
 
     virtual void Update();
+    virtual void HashState( StateHash& hash );
 
 private:
     void UpdateWander();
@@ -219,6 +225,7 @@ public:
     Vire( int x, int y );
 
     virtual void Update();
+    virtual void HashState( StateHash& hash );
 
 private:
     void UpdateWander();
@@ -235,6 +242,7 @@ public:
     LikeLike( int x, int y );
 
     virtual void Update();
+    virtual void HashState( StateHash& hash );
 };
 
 
@@ -251,6 +259,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 
 protected:
     void UpdateDig();
@@ -280,13 +289,12 @@ class RedLeever : public Object
     int                 state;
     const WalkerSpec*   spec;
 
-    static int          count;
-
 public:
     RedLeever( int x, int y );
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 
     static void ClearRoomData();
 
@@ -320,6 +328,7 @@ public:
     Flyer( ObjType type, const FlyerSpec* spec, int x, int y );
 
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 
 protected:
     void UpdateStateAndMove();
@@ -368,6 +377,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 
 protected:
     virtual void UpdateFullSpeedImpl();
@@ -414,6 +424,7 @@ public:
     Moldorm( int x, int y );
 
     virtual void Update();
+    virtual void HashState( StateHash& hash );
 
     static Object* MakeSet();
 
@@ -443,6 +454,7 @@ public:
 
     virtual void Update();
     virtual void UpdateFullSpeedImpl();
+    virtual void HashState( StateHash& hash );
 
     static Patra* MakePatra( ObjType type );
 
@@ -464,6 +476,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 
 private:
     void UpdateStart();
@@ -488,6 +501,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 
 private:
     void UpdateStill();
@@ -504,8 +518,6 @@ class Boulders : public Object
 {
     static const int MaxBoulders = 3;
 
-    static int      sCount;
-
 public:
     Boulders();
 
@@ -531,6 +543,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 
     static Object* MakeSet( int count );
 
@@ -551,6 +564,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 
 private:
     void SetFacingAnimation();
@@ -572,6 +586,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 
 private:
     void Move();
@@ -599,6 +614,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 
 private:
     int GetState();
@@ -622,6 +638,8 @@ protected:
 public:
     BlueWizzrobeBase( ObjType type, int x, int y );
 
+    virtual void HashState( StateHash& hash );
+
 protected:
     void TruncatePosition();
 
@@ -645,6 +663,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 
 private:
     void SetFacingAnimation();
@@ -694,6 +713,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 
 private:
     void CalcStartPosition( 
@@ -718,6 +738,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 
 private:
     void Move();
@@ -743,6 +764,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 
 private:
     void UpdateState();
@@ -777,15 +799,12 @@ class Manhandla : public Object
     int             frame;
     int             oldFrame;
 
-    static int          sPartsDied;
-    static Direction    sFacingAtFrameBegin;
-    static Direction    sBounceDir;
-
 public:
     static Object* Make( int x, int y );
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 
     static void ClearRoomData();
 
@@ -812,6 +831,8 @@ protected:
 protected:
     DigdoggerBase( ObjType type, int x, int y );
 
+    virtual void HashState( StateHash& hash );
+
     void UpdateMove();
 
 private:
@@ -836,6 +857,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 
 private:
     Digdogger( int x, int y, int childCount );
@@ -853,6 +875,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 
 private:
     DigdoggerChild( int x, int y );
@@ -881,6 +904,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 
     int GetCurrentCheckPart();
     int GetEyeFrame();
@@ -950,6 +974,7 @@ public:
     void Init( int index );
     void Update();
     void Draw();
+    void HashState( StateHash& hash );
 
 private:
     void TryShooting();
@@ -987,6 +1012,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 
 private:
     void Animate();
@@ -1024,6 +1050,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 
 private:
     void UpdateHoldDark();
@@ -1053,6 +1080,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 
     static Object* Make();
 };
@@ -1067,6 +1095,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 };
 
 
@@ -1079,6 +1108,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 };
 
 
@@ -1102,6 +1132,7 @@ public:
     Fairy( int x, int y );
 
     virtual void Update();
+    virtual void HashState( StateHash& hash );
 
 protected:
     virtual void UpdateFullSpeedImpl();
@@ -1131,6 +1162,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual void HashState( StateHash& hash );
 
 private:
     void UpdateIdle();
@@ -1156,13 +1188,30 @@ class Statues
         MaxStatues = 4,
     };
 
-    static uint8_t timers[MaxStatues];
-
 public:
     static void Init();
     static void Update( int pattern );
 };
 
 
+// Monster state that's shared by all the monsters of a kind in a room,
+// instead of belonging to one object. Each world has its own.
+
+struct RoomMonsterData
+{
+    static const int MaxStatues = 4;
+    static const int PatraParts = 9;
+
+    int         RedLeeverCount;
+    int         BoulderCount;
+    int         ManhandlaPartsDied;
+    Direction   ManhandlaFacingAtFrameBegin;
+    Direction   ManhandlaBounceDir;
+    uint8_t     StatueTimers[MaxStatues];
+    int         PatraAngles[PatraParts];
+    int         PatraStates[PatraParts];
+};
+
+
 Object* MakeMonster( ObjType type, int x, int y );
 void ClearRoomMonsterData();
@@ -0,0 +1,234 @@
+/*
+   Copyright 2017 Aldo J. Nunez
+
+   Licensed under the Apache License, Version 2.0.
+   See the LICENSE text file for details.
+*/
+
+#include "Common.h"
+#include "Movie.h"
+#include "SaveFolder.h"
+
+
+const uint32_t MovieMagic = 0x4D5A4F4C;     // "LOZM"
+const uint16_t MovieVersion = 1;
+
+
+//----------------------------------------------------------------------------
+//  MovieRecorder
+//----------------------------------------------------------------------------
+
+MovieRecorder::MovieRecorder()
+    :   file(),
+        header(),
+        runButtons(),
+        runLength()
+{
+}
+
+MovieRecorder::~MovieRecorder()
+{
+    Close();
+}
+
+bool MovieRecorder::Open( const char* path, uint64_t seed, int slot, const Profile& profile )
+{
+    Close();
+
+    errno_t err = fopen_s( &file, path, "wb" );
+    if ( err != 0 )
+    {
+        file = nullptr;
+        return false;
+    }
+
+    memset( &header, 0, sizeof header );
+    header.Magic = MovieMagic;
+    header.Version = MovieVersion;
+    header.Slot = slot;
+    header.Seed = seed;
+    header.StartProfile = profile;
+
+    runButtons = 0;
+    runLength = 0;
+
+    // The frame count is filled in when the movie is closed.
+    if ( fwrite( &header, sizeof header, 1, file ) < 1 )
+    {
+        fclose( file );
+        file = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+bool MovieRecorder::Close()
+{
+    if ( file == nullptr )
+        return true;
+
+    WriteRun();
+
+    bool ok = fseek( file, offsetof( MovieHeader, FrameCount ), SEEK_SET ) == 0
+        && fwrite( &header.FrameCount, sizeof header.FrameCount, 1, file ) == 1;
+
+    if ( fclose( file ) != 0 )
+        ok = false;
+    file = nullptr;
+
+    return ok;
+}
+
+bool MovieRecorder::IsOpen() const
+{
+    return file != nullptr;
+}
+
+void MovieRecorder::Record( InputButtons buttons )
+{
+    if ( file == nullptr )
+        return;
+
+    if ( runLength > 0 && buttons.Buttons != runButtons )
+        WriteRun();
+
+    runButtons = buttons.Buttons;
+    runLength++;
+    header.FrameCount++;
+}
+
+void MovieRecorder::WriteRun()
+{
+    if ( runLength == 0 )
+        return;
+
+    uint8_t bytes[6];
+    int     count = 0;
+    uint32_t length = runLength;
+
+    bytes[count++] = runButtons;
+
+    while ( length >= 0x80 )
+    {
+        bytes[count++] = (length & 0x7F) | 0x80;
+        length >>= 7;
+    }
+    bytes[count++] = length;
+
+    fwrite( bytes, 1, count, file );
+
+    runLength = 0;
+}
+
+
+//----------------------------------------------------------------------------
+//  MoviePlayer
+//----------------------------------------------------------------------------
+
+MoviePlayer::MoviePlayer()
+    :   file(),
+        header(),
+        framesLeft(),
+        runButtons(),
+        runLength()
+{
+}
+
+MoviePlayer::~MoviePlayer()
+{
+    Close();
+}
+
+bool MoviePlayer::Open( const char* path )
+{
+    Close();
+
+    errno_t err = fopen_s( &file, path, "rb" );
+    if ( err != 0 )
+    {
+        file = nullptr;
+        return false;
+    }
+
+    if ( fread( &header, sizeof header, 1, file ) < 1
+        || header.Magic != MovieMagic
+        || header.Version != MovieVersion
+        || header.Slot >= MaxProfiles )
+    {
+        _RPT1( _CRT_WARN, "Invalid movie file: %s\n", path );
+        Close();
+        return false;
+    }
+
+    framesLeft = header.FrameCount;
+    runButtons = 0;
+    runLength = 0;
+
+    return true;
+}
+
+void MoviePlayer::Close()
+{
+    if ( file != nullptr )
+    {
+        fclose( file );
+        file = nullptr;
+    }
+}
+
+bool MoviePlayer::IsOpen() const
+{
+    return file != nullptr;
+}
+
+const MovieHeader& MoviePlayer::GetHeader() const
+{
+    return header;
+}
+
+bool MoviePlayer::Next( InputButtons& buttons )
+{
+    if ( file == nullptr || framesLeft == 0 )
+        return false;
+
+    if ( runLength == 0 && !ReadRun() )
+    {
+        framesLeft = 0;
+        return false;
+    }
+
+    buttons.Buttons = runButtons;
+    runLength--;
+    framesLeft--;
+
+    return true;
+}
+
+bool MoviePlayer::ReadRun()
+{
+    int c = fgetc( file );
+    if ( c == EOF )
+        return false;
+
+    runButtons = c;
+    runLength = 0;
+
+    for ( int shift = 0; shift < 32; shift += 7 )
+    {
+        c = fgetc( file );
+        if ( c == EOF )
+            return false;
+
+        // The fifth byte only has the top 4 bits of 32.
+        if ( shift == 28 && (c & 0x70) != 0 )
+            return false;
+
+        runLength |= (uint32_t) (c & 0x7F) << shift;
+
+        if ( (c & 0x80) == 0 )
+            return runLength > 0;
+    }
+
+    return false;
+}
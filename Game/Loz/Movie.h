@@ -0,0 +1,79 @@
+/*
+   Copyright 2017 Aldo J. Nunez
+
+   Licensed under the Apache License, Version 2.0.
+   See the LICENSE text file for details.
+*/
+
+#pragma once
+
+#include "Input.h"
+#include "Profile.h"
+
+
+// A movie is the input of every frame of a game, along with everything
+// else needed to start that game again the same way: the random seed, and
+// the profile and slot it started with.
+//
+// After the header, the input is stored as runs. Each run is the buttons
+// byte, followed by the number of frames it lasted as a variable length
+// number: 7 bits in each byte, lowest first, with the top bit set on every
+// byte but the last.
+
+struct MovieHeader
+{
+    uint32_t    Magic;
+    uint16_t    Version;
+    uint16_t    Slot;
+    uint64_t    Seed;
+    uint32_t    FrameCount;
+    Profile     StartProfile;
+};
+
+
+class MovieRecorder
+{
+    FILE*       file;
+    MovieHeader header;
+    uint8_t     runButtons;
+    uint32_t    runLength;
+
+public:
+    MovieRecorder();
+    ~MovieRecorder();
+
+    bool Open( const char* path, uint64_t seed, int slot, const Profile& profile );
+    bool Close();
+    bool IsOpen() const;
+
+    void Record( InputButtons buttons );
+
+private:
+    void WriteRun();
+};
+
+
+class MoviePlayer
+{
+    FILE*       file;
+    MovieHeader header;
+    uint32_t    framesLeft;
+    uint8_t     runButtons;
+    uint32_t    runLength;
+
+public:
+    MoviePlayer();
+    ~MoviePlayer();
+
+    bool Open( const char* path );
+    void Close();
+    bool IsOpen() const;
+
+    const MovieHeader& GetHeader() const;
+
+    // Returns false when the movie has no more frames.
+    bool Next( InputButtons& buttons );
+
+private:
+    bool ReadRun();
+};
@@ -16,6 +16,7 @@
 #include "Sound.h"
 #include "SoundId.h"
 #include "SpriteAnimator.h"
+#include "StateHash.h"
 #include "World.h"
 #include "Monsters.h"
 
@@ -43,9 +44,9 @@ enum TileCollisionStep
 
 Object::Object( ObjType type )
     :   type( type ),
+        id( World::MakeObjectId() ),
         isDeleted( false ),
         decoration( 1 ),
-        firstRef(),
         invincibilityTimer( 0 ),
         invincibilityMask( 0 ),
         shoveDir( 0 ),
@@ -75,7 +76,66 @@ Object::Object( ObjType type )
 
 Object::~Object()
 {
-    DeleteRefs();
+}
+
+void Object::HashState( StateHash& hash )
+{
+    hash.AddValue( type );
+    hash.AddValue( id );
+    hash.AddValue( isDeleted );
+    hash.AddValue( decoration );
+    hash.AddValue( hp );
+    hash.AddValue( invincibilityTimer );
+    hash.AddValue( invincibilityMask );
+    hash.AddValue( shoveDir );
+    hash.AddValue( shoveDistance );
+    hash.AddValue( facing );
+    hash.AddValue( objX );
+    hash.AddValue( objY );
+    hash.AddValue( tileOffset );
+    hash.AddValue( fraction );
+    hash.AddValue( moving );
+    hash.AddValue( objTimer );
+    hash.AddValue( stunTimer );
+    hash.AddValue( objFlags );
+}
+
+void Object::HashAnimator( StateHash& hash, const SpriteAnimator& animator )
+{
+    hash.AddValue( animator.time );
+    hash.AddValue( animator.durationFrames );
+}
+
+// The size is kept in a header in front of the object. The header is as big
+// as the strictest alignment that the allocator guarantees.
+
+union ObjAllocHeader
+{
+    size_t      Size;
+    double      Align;
+    uint64_t    Align2;
+};
+
+void* Object::operator new( size_t size )
+{
+    ObjAllocHeader* header = (ObjAllocHeader*) ::operator new( sizeof( ObjAllocHeader ) + size );
+    header->Size = size;
+    return header + 1;
+}
+
+void Object::operator delete( void* p )
+{
+    if ( p == nullptr )
+        return;
+
+    ObjAllocHeader* header = (ObjAllocHeader*) p - 1;
+    ::operator delete( header );
+}
+
+size_t Object::GetAllocSize( const Object* obj )
+{
+    const ObjAllocHeader* header = (const ObjAllocHeader*) obj - 1;
+    return header->Size;
 }
 
 ObjType Object::GetType()
@@ -83,6 +143,11 @@ ObjType Object::GetType()
     return (ObjType) type;
 }
 
+uint32_t Object::GetId()
+{
+    return id;
+}
+
 bool Object::IsDeleted()
 {
     return isDeleted;
@@ -123,6 +188,11 @@ uint Object::GetX()
     return objX;
 }
 
+uint Object::GetHP()
+{
+    return hp;
+}
+
 uint Object::GetY()
 {
     return objY;
@@ -1226,47 +1296,20 @@ void Object::MoveShoveWhole()
     }
 }
 
-void Object::AddRef( ObjRef& ref )
+Object* ObjRef::Get() const
 {
-    ref.Obj = this;
-    ref.Next = firstRef;
-    firstRef = &ref;
-}
+    if ( Id == 0 )
+        return nullptr;
 
-void Object::RemoveRef( ObjRef& ref )
-{
-    for ( ObjRef** ppRef = &firstRef; *ppRef != nullptr; ppRef = &(*ppRef)->Next )
-    {
-        if ( *ppRef == &ref )
-        {
-            *ppRef = (*ppRef)->Next;
-            ref.Next = nullptr;
-            ref.Obj = nullptr;
-            break;
-        }
-    }
-}
-
-void Object::DeleteRefs()
-{
-    for ( ObjRef* ref = firstRef; ref != nullptr; )
-    {
-        auto next = ref->Next;
-        ref->Obj = nullptr;
-        ref->Next = nullptr;
-        ref = next;
-    }
-    firstRef = nullptr;
+    return World::GetObjectById( Id );
 }
 
 void ObjRef::Take( Object* obj )
 {
-    if ( obj != nullptr )
-        obj->AddRef( *this );
+    Id = obj != nullptr ? obj->GetId() : 0;
 }
 
 void ObjRef::Drop()
 {
-    if ( Obj != nullptr )
-        Obj->RemoveRef( *this );
+    Id = 0;
 }
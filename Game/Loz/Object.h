@@ -11,7 +11,9 @@
 enum CollisionResponse;
 enum ObjType;
 struct TileCollision;
+struct SpriteAnimator;
 class Object;
+class StateHash;
 
 
 enum ObjInterfaces
@@ -73,14 +75,17 @@ struct ObjFlags
 };
 
 
+// Refers to an object by its ID instead of its address, so that copies of
+// the world keep their references. It reads as null once the object has
+// left the world.
+
 struct ObjRef
 {
-    Object* Obj;
-    ObjRef* Next;
+    uint32_t Id;
 
-    ObjRef() : Obj( nullptr ), Next( nullptr ) { }
-    ~ObjRef() { Drop(); }
+    ObjRef() : Id( 0 ) { }
 
+    Object* Get() const;
     void Take( Object* obj );
     void Drop();
 };
@@ -89,16 +94,12 @@ struct ObjRef
 class Object
 {
     const uint8_t   type;
+    uint32_t        id;
 
 protected:
     bool        isDeleted;
     uint8_t     decoration;
     uint8_t     hp;
-
-private:
-    ObjRef*     firstRef;
-
-protected:
     uint8_t     invincibilityTimer;
     uint8_t     invincibilityMask;
     uint8_t     shoveDir;
@@ -117,7 +118,14 @@ public:
     Object( ObjType type );
     virtual ~Object();
 
+    // Objects remember the size they were allocated with, so that they can
+    // be copied without knowing their types.
+    static void* operator new( size_t size );
+    static void operator delete( void* p );
+    static size_t GetAllocSize( const Object* obj );
+
     ObjType GetType();
+    uint32_t GetId();
     bool IsDeleted();
     void SetDeleted();
     bool IsPlayer();
@@ -127,6 +135,7 @@ public:
     Direction GetMoving();
     uint GetX();
     uint GetY();
+    uint GetHP();
     void SetX( uint x );
     void SetY( uint y );
     int  GetTileOffset();
@@ -139,6 +148,11 @@ public:
     void SetShoveDistance( int distance );
     ObjFlags GetFlags();
 
+    // Adds the object's state to a hash of the world. Each class with state
+    // of its own adds it after its base class's. Pointers to specs and
+    // sprites aren't added. They're read-only, and differ from run to run.
+    virtual void HashState( StateHash& hash );
+
     void DecrementObjectTimer();
     void DecrementStunTimer();
 
@@ -149,13 +163,9 @@ public:
     virtual void Draw() = 0;
     virtual void* GetInterface( ObjInterfaces iface );
 
-    void AddRef( ObjRef& ref );
-    void RemoveRef( ObjRef& ref );
-
-private:
-    void DeleteRefs();
-
 protected:
+    static void HashAnimator( StateHash& hash, const SpriteAnimator& animator );
+
     int CalcPalette( int wantedPalette );
     bool IsStunned();
 
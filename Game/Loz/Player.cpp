@@ -16,6 +16,7 @@
 #include "Profile.h"
 #include "Sound.h"
 #include "SoundId.h"
+#include "StateHash.h"
 #include "TileAttr.h"
 
 
@@ -86,6 +87,20 @@ Player::Player()
     animator.durationFrames = WalkDurationFrames;
 }
 
+void Player::HashState( StateHash& hash )
+{
+    Object::HashState( hash );
+    hash.AddValue( state );
+    hash.AddValue( speed );
+    hash.AddValue( tileBehavior );
+    hash.AddValue( paralyzed );
+    hash.AddValue( animTimer );
+    hash.AddValue( avoidTurningWhenDiag );
+    hash.AddValue( keepGoingStraight );
+    hash.AddValue( curButtons.Buttons );
+    HashAnimator( hash, animator );
+}
+
 void Player::DecInvincibleTimer()
 {
     if ( invincibilityTimer > 0 && (GetFrameCounter() & 1) == 0 )
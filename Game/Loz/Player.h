@@ -50,6 +50,7 @@ public:
     virtual void Update();
     virtual void Draw();
     virtual void* GetInterface( ObjInterfaces iface );
+    virtual void HashState( StateHash& hash );
 
     int GetState();
     void SetState( State state );
@@ -248,11 +248,17 @@ void RegisterMenu::Update()
     }
 }
 
-void RegisterMenu::Draw()
+Menu* RegisterMenu::Clone()
 {
-    Graphics::Begin();
+    RegisterMenu* menu = new RegisterMenu( *this );
+    // Give the copy its own summaries, so that neither sees the other's changes.
+    menu->summaries = std::make_shared<ProfileSummarySnapshot>( *summaries );
+    return menu;
+}
 
-    al_clear_to_color( al_map_rgb( 0, 0, 0 ) );
+void RegisterMenu::Draw()
+{
+    Graphics::Clear();
 
     int x, y;
 
@@ -294,6 +300,4 @@ void RegisterMenu::Draw()
     else
         y = 0x78 + (selectedIndex - 3) * 16;
     DrawChar( Char_FullHeart, 0x44, y, 7 );
-
-    Graphics::End();
 }
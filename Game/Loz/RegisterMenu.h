@@ -25,6 +25,7 @@ public:
 
     virtual void Update();
     virtual void Draw();
+    virtual Menu* Clone();
 
 private:
     void SelectNext();
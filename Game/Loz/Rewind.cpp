@@ -0,0 +1,463 @@
+/*
+   Copyright 2017 Aldo J. Nunez
+
+   Licensed under the Apache License, Version 2.0.
+   See the LICENSE text file for details.
+*/
+
+#include "Common.h"
+#include "Rewind.h"
+#include "World.h"
+
+
+// Zero runs shorter than this are cheaper to keep in a literal run.
+const size_t MinZeroRun = 4;
+const size_t MaxCountSize = 5;
+
+
+static size_t GetMaxEncodedSize( size_t size )
+{
+    // Every run after the first starts with at least MinZeroRun zeros.
+    return size + (size / MinZeroRun + 2) * MaxCountSize * 2;
+}
+
+static bool ReserveBuffer( uint8_t*& buffer, size_t& capacity, size_t size )
+{
+    if ( size <= capacity )
+        return true;
+
+    uint8_t* newBuffer = new uint8_t[size];
+    if ( newBuffer == nullptr )
+        return false;
+
+    delete [] buffer;
+    buffer = newBuffer;
+    capacity = size;
+    return true;
+}
+
+static uint8_t* WriteCount( uint8_t* out, uint32_t count )
+{
+    while ( count >= 0x80 )
+    {
+        *out++ = (count & 0x7F) | 0x80;
+        count >>= 7;
+    }
+    *out++ = count;
+    return out;
+}
+
+static bool ReadCount( const uint8_t*& in, const uint8_t* end, uint32_t& count )
+{
+    count = 0;
+
+    for ( int shift = 0; shift < 32 && in < end; shift += 7 )
+    {
+        uint8_t c = *in++;
+
+        count |= (uint32_t) (c & 0x7F) << shift;
+
+        if ( (c & 0x80) == 0 )
+            return true;
+    }
+
+    return false;
+}
+
+static size_t Encode( const uint8_t* data, size_t size, uint8_t* out )
+{
+    uint8_t*    outStart = out;
+    size_t      pos = 0;
+
+    while ( pos < size )
+    {
+        size_t zeroStart = pos;
+        while ( pos < size && data[pos] == 0 )
+            pos++;
+
+        size_t litStart = pos;
+        size_t litEnd = pos;
+
+        for ( size_t scan = pos; scan < size; )
+        {
+            if ( data[scan] != 0 )
+            {
+                scan++;
+                litEnd = scan;
+                continue;
+            }
+
+            size_t zeroEnd = scan;
+            while ( zeroEnd < size && data[zeroEnd] == 0 && (zeroEnd - scan) < MinZeroRun )
+                zeroEnd++;
+
+            if ( (zeroEnd - scan) >= MinZeroRun || zeroEnd == size )
+                break;
+
+            scan = zeroEnd;
+        }
+
+        out = WriteCount( out, litStart - zeroStart );
+        out = WriteCount( out, litEnd - litStart );
+        memcpy( out, &data[litStart], litEnd - litStart );
+        out += litEnd - litStart;
+
+        pos = litEnd;
+    }
+
+    return out - outStart;
+}
+
+static bool Decode( const uint8_t* in, size_t inSize, uint8_t* out, size_t size )
+{
+    const uint8_t*  end = in + inSize;
+    size_t          pos = 0;
+
+    while ( in < end )
+    {
+        uint32_t zeroCount = 0;
+        uint32_t litCount = 0;
+
+        if ( !ReadCount( in, end, zeroCount ) || !ReadCount( in, end, litCount ) )
+            return false;
+
+        if ( zeroCount > size - pos )
+            return false;
+
+        memset( &out[pos], 0, zeroCount );
+        pos += zeroCount;
+
+        if ( litCount > size - pos || litCount > (size_t) (end - in) )
+            return false;
+
+        memcpy( &out[pos], in, litCount );
+        pos += litCount;
+        in += litCount;
+    }
+
+    return pos == size;
+}
+
+static void XorBytes( uint8_t* data, size_t size, const uint8_t* base, size_t baseSize )
+{
+    size_t count = size < baseSize ? size : baseSize;
+
+    for ( size_t i = 0; i < count; i++ )
+    {
+        data[i] ^= base[i];
+    }
+}
+
+
+RewindBuffer::RewindBuffer()
+    :   ring(),
+        ringSize(),
+        entries(),
+        entryCapacity(),
+        firstEntry(),
+        entryCount(),
+        keyframeInterval(),
+        nextSeq(),
+        snapshot(),
+        keyframe(),
+        keyframeCapacity(),
+        keyframeSize(),
+        keyframeSeq(),
+        haveKeyframe(),
+        frame(),
+        frameCapacity(),
+        encoded(),
+        encodedCapacity()
+{
+}
+
+RewindBuffer::~RewindBuffer()
+{
+    Uninit();
+}
+
+bool RewindBuffer::Init( size_t capacity, int maxFrames, int keyframeInterval )
+{
+    assert( capacity > 0 && capacity <= UINT32_MAX );
+    assert( maxFrames > 0 );
+    assert( keyframeInterval > 0 );
+
+    Uninit();
+
+    ring = new uint8_t[capacity];
+    entries = new Entry[maxFrames];
+    snapshot = World::CreateSnapshot();
+
+    if ( ring == nullptr || entries == nullptr || snapshot == nullptr )
+    {
+        Uninit();
+        return false;
+    }
+
+    ringSize = capacity;
+    entryCapacity = maxFrames;
+    this->keyframeInterval = keyframeInterval;
+
+    Clear();
+    return true;
+}
+
+void RewindBuffer::Uninit()
+{
+    if ( snapshot != nullptr )
+        World::DestroySnapshot( snapshot );
+
+    delete [] ring;
+    delete [] entries;
+    delete [] keyframe;
+    delete [] frame;
+    delete [] encoded;
+
+    ring = nullptr;
+    ringSize = 0;
+    entries = nullptr;
+    entryCapacity = 0;
+    snapshot = nullptr;
+    keyframe = nullptr;
+    keyframeCapacity = 0;
+    frame = nullptr;
+    frameCapacity = 0;
+    encoded = nullptr;
+    encodedCapacity = 0;
+
+    Clear();
+}
+
+bool RewindBuffer::IsEnabled() const
+{
+    return ring != nullptr;
+}
+
+void RewindBuffer::Clear()
+{
+    firstEntry = 0;
+    entryCount = 0;
+    keyframeSize = 0;
+    haveKeyframe = false;
+}
+
+int RewindBuffer::GetFrameCount() const
+{
+    return entryCount;
+}
+
+RewindBuffer::Entry& RewindBuffer::GetEntry( int index )
+{
+    assert( index >= 0 && index < entryCapacity );
+    return entries[(firstEntry + index) % entryCapacity];
+}
+
+int RewindBuffer::FindKeyframe( int index )
+{
+    // The oldest frame is always a keyframe.
+    while ( index > 0 && !GetEntry( index ).Keyframe )
+        index--;
+    return index;
+}
+
+bool RewindBuffer::DecodeKeyframe( int index )
+{
+    Entry& entry = GetEntry( index );
+
+    assert( entry.Keyframe );
+
+    if ( haveKeyframe && keyframeSeq == entry.Seq )
+        return true;
+
+    haveKeyframe = false;
+
+    if ( !ReserveBuffer( keyframe, keyframeCapacity, entry.RawSize ) )
+        return false;
+
+    if ( !Decode( ring + entry.Offset, entry.Size, keyframe, entry.RawSize ) )
+        return false;
+
+    keyframeSize = entry.RawSize;
+    keyframeSeq = entry.Seq;
+    haveKeyframe = true;
+    return true;
+}
+
+bool RewindBuffer::FindSpace( size_t size, uint32_t& offset )
+{
+    if ( size > ringSize )
+        return false;
+
+    if ( entryCount == 0 )
+    {
+        offset = 0;
+        return true;
+    }
+
+    Entry&  oldest = GetEntry( 0 );
+    Entry&  newest = GetEntry( entryCount - 1 );
+    size_t  tail = oldest.Offset;
+    size_t  head = newest.Offset + newest.Size;
+
+    if ( head > tail )
+    {
+        if ( head + size <= ringSize )
+        {
+            offset = head;
+            return true;
+        }
+
+        // Wrap around to the start.
+        if ( size <= tail )
+        {
+            offset = 0;
+            return true;
+        }
+
+        return false;
+    }
+
+    if ( head + size <= tail )
+    {
+        offset = head;
+        return true;
+    }
+
+    return false;
+}
+
+bool RewindBuffer::Allocate( size_t size, bool keepNewestGroup, uint32_t& offset )
+{
+    while ( true )
+    {
+        if ( entryCount < entryCapacity && FindSpace( size, offset ) )
+            return true;
+
+        if ( entryCount == 0 )
+            return false;
+
+        if ( keepNewestGroup && FindKeyframe( entryCount - 1 ) == 0 )
+            return false;
+
+        DropOldestGroup();
+    }
+}
+
+void RewindBuffer::DropOldestGroup()
+{
+    do
+    {
+        firstEntry = (firstEntry + 1) % entryCapacity;
+        entryCount--;
+    } while ( entryCount > 0 && !GetEntry( 0 ).Keyframe );
+}
+
+void RewindBuffer::Push()
+{
+    if ( !IsEnabled() )
+        return;
+
+    World::SaveSnapshot( snapshot );
+
+    size_t          rawSize = 0;
+    const uint8_t*  raw = World::GetSnapshotData( snapshot, rawSize );
+
+    if ( rawSize > UINT32_MAX
+        || !ReserveBuffer( frame, frameCapacity, rawSize )
+        || !ReserveBuffer( encoded, encodedCapacity, GetMaxEncodedSize( rawSize ) ) )
+    {
+        Clear();
+        return;
+    }
+
+    bool isKeyframe = true;
+
+    if ( entryCount > 0 )
+    {
+        int keyIndex = FindKeyframe( entryCount - 1 );
+
+        if ( (entryCount - keyIndex) < keyframeInterval && DecodeKeyframe( keyIndex ) )
+            isKeyframe = false;
+    }
+
+    size_t      size = 0;
+    uint32_t    offset = 0;
+
+    if ( !isKeyframe )
+    {
+        memcpy( frame, raw, rawSize );
+        XorBytes( frame, rawSize, keyframe, keyframeSize );
+        size = Encode( frame, rawSize, encoded );
+
+        // Rather than drop the keyframe that this frame needs, start over
+        // with a new one.
+        if ( !Allocate( size, true, offset ) )
+            isKeyframe = true;
+    }
+
+    if ( isKeyframe )
+    {
+        size = Encode( raw, rawSize, encoded );
+
+        if ( !Allocate( size, false, offset ) )
+        {
+            Clear();
+            return;
+        }
+    }
+
+    memcpy( ring + offset, encoded, size );
+
+    Entry& entry = GetEntry( entryCount );
+    entry.Offset = offset;
+    entry.Size = size;
+    entry.RawSize = rawSize;
+    entry.Seq = nextSeq++;
+    entry.Keyframe = isKeyframe;
+    entryCount++;
+
+    if ( isKeyframe && ReserveBuffer( keyframe, keyframeCapacity, rawSize ) )
+    {
+        memcpy( keyframe, raw, rawSize );
+        keyframeSize = rawSize;
+        keyframeSeq = entry.Seq;
+        haveKeyframe = true;
+    }
+    else if ( isKeyframe )
+    {
+        haveKeyframe = false;
+    }
+}
+
+bool RewindBuffer::StepBack()
+{
+    if ( !IsEnabled() || entryCount == 0 )
+        return false;
+
+    if ( entryCount > 1 )
+        entryCount--;
+
+    int     index = entryCount - 1;
+    Entry&  entry = GetEntry( index );
+
+    if ( !DecodeKeyframe( FindKeyframe( index ) ) )
+        return false;
+
+    const uint8_t* data = keyframe;
+
+    if ( !entry.Keyframe )
+    {
+        if ( !ReserveBuffer( frame, frameCapacity, entry.RawSize ) )
+            return false;
+
+        if ( !Decode( ring + entry.Offset, entry.Size, frame, entry.RawSize ) )
+            return false;
+
+        XorBytes( frame, entry.RawSize, keyframe, keyframeSize );
+        data = frame;
+    }
+
+    World::SetSnapshotData( snapshot, data, entry.RawSize );
+    World::LoadSnapshot( snapshot );
+    return true;
+}
@@ -0,0 +1,85 @@
+/*
+   Copyright 2017 Aldo J. Nunez
+
+   Licensed under the Apache License, Version 2.0.
+   See the LICENSE text file for details.
+*/
+
+#pragma once
+
+
+class WorldSnapshot;
+
+
+// Keeps the last frames of the current world in a fixed amount of memory,
+// so that they can be stepped through backwards.
+//
+// Frames are stored in a ring of bytes. Every so often, a frame is stored
+// whole as a keyframe. Frames in between are stored as the XOR of their
+// snapshot with the keyframe's, which is mostly zeros. Both kinds are
+// written as runs: a count of zeros, a count of literal bytes, and the
+// literal bytes. Counts are variable length numbers like in movies.
+//
+// When the ring is full, the oldest keyframe and the frames that depend on
+// it are dropped together.
+
+class RewindBuffer
+{
+    struct Entry
+    {
+        uint32_t    Offset;
+        uint32_t    Size;
+        uint32_t    RawSize;
+        uint32_t    Seq;
+        bool        Keyframe;
+    };
+
+    uint8_t*        ring;
+    size_t          ringSize;
+    Entry*          entries;
+    int             entryCapacity;
+    int             firstEntry;
+    int             entryCount;
+    int             keyframeInterval;
+    uint32_t        nextSeq;
+
+    WorldSnapshot*  snapshot;
+
+    // The decoded keyframe that new frames are compared to.
+    uint8_t*        keyframe;
+    size_t          keyframeCapacity;
+    size_t          keyframeSize;
+    uint32_t        keyframeSeq;
+    bool            haveKeyframe;
+
+    // Work space for one frame before it's encoded, or after it's decoded.
+    uint8_t*        frame;
+    size_t          frameCapacity;
+    uint8_t*        encoded;
+    size_t          encodedCapacity;
+
+public:
+    RewindBuffer();
+    ~RewindBuffer();
+
+    bool Init( size_t capacity, int maxFrames, int keyframeInterval );
+    void Uninit();
+    bool IsEnabled() const;
+
+    void Clear();
+    int GetFrameCount() const;
+
+    // Saves the current world as the newest frame.
+    void Push();
+    // Drops the newest frame, and loads the one before it into the current
+    // world. The oldest frame stays, so holding rewind stops there.
+    bool StepBack();
+
+private:
+    Entry& GetEntry( int index );
+    int FindKeyframe( int index );
+    bool DecodeKeyframe( int index );
+    bool Allocate( size_t size, bool keepNewestGroup, uint32_t& offset );
+    bool FindSpace( size_t size, uint32_t& offset );
+    void DropOldestGroup();
+};
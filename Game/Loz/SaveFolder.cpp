@@ -17,6 +17,8 @@ enum OpenMode
 
 const char* SaveFileNamePattern = "z1_%d.sav";
 
+static bool readOnly;
+
 
 // The save should probably have a version and checksum
 // for compatibility and integrity testing
@@ -121,6 +123,9 @@ bool SaveFolder::WriteProfile( int index, const Profile& profile )
     errno_t err = 0;
     size_t lenWritten = 0;
 
+    if ( readOnly )
+        return true;
+
     err = OpenFile( &file, index, Open_Write );
     if ( err != 0 )
         return false;
@@ -133,3 +138,13 @@ bool SaveFolder::WriteProfile( int index, const Profile& profile )
 
     return true;
 }
+
+void SaveFolder::SetReadOnly( bool readOnly )
+{
+    ::readOnly = readOnly;
+}
+
+bool SaveFolder::IsReadOnly()
+{
+    return readOnly;
+}
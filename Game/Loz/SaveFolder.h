@@ -43,4 +43,9 @@ public:
     static void ReadSummaries( ProfileSummarySnapshot& summaries );
     static bool ReadProfile( int index, Profile& profile );
     static bool WriteProfile( int index, const Profile& profile );
+
+    // While read-only, writes are dropped. Replays use this, so that they
+    // don't overwrite the player's files.
+    static void SetReadOnly( bool readOnly );
+    static bool IsReadOnly();
 };
@@ -55,15 +55,49 @@ static ALLEGRO_AUDIO_STREAM* streams[Streams];
 static double savedPos[LoPriStreams];
 static SoundInfo songs[Songs];
 static SoundInfo effects[Effects];
-static EffectRequest effectRequests[Instances];
-static bool paused;
 static bool pausedSongs[Streams];
 static bool pausedEffects[Instances];
 static int pausedEffectPos[Instances];
 
+// Sound state that belongs to one world. The audio device state above is
+// only driven by the world that's displayed.
+
+struct Sound::Context
+{
+    EffectRequest   effectRequests[Instances];
+    bool            paused;
+};
+
+static thread_local Sound::Context* ctx;
+
+// Without an audio device, requests are still arbitrated by priority, but
+// nothing is played.
+static bool headless;
+
+// While muted, the audio device is left alone. Frames that are only run
+// ahead to be drawn use this.
+static bool muted;
+
+
+static Sound::MixListener mixListener;
+static void* mixListenerData;
+
+
+static bool IsSilent()
+{
+    return headless || muted;
+}
+
+static void MixerPostprocess( void* buffer, unsigned int frameCount, void* data )
+{
+    mixListener( (const int16_t*) buffer, frameCount, mixListenerData );
+}
 
 static void PlaySongInternal( int songId, int streamId, bool loop, bool play )
 {
+    if ( IsSilent() )
+        return;
+
     al_destroy_audio_stream( streams[streamId] );
 
     streams[streamId] = al_load_audio_stream( songs[songId].Filename, 2, 2048 );
@@ -101,11 +135,11 @@ static void PlaySongInternal( int songId, int streamId, bool loop, bool play )
 
 bool Sound::Init()
 {
-    defaultVoice = al_create_voice( 44100, ALLEGRO_AUDIO_DEPTH_INT16, ALLEGRO_CHANNEL_CONF_2 );
+    defaultVoice = al_create_voice( SampleRate, ALLEGRO_AUDIO_DEPTH_INT16, ALLEGRO_CHANNEL_CONF_2 );
     if ( defaultVoice == nullptr )
         return false;
 
-    defaultMixer = al_create_mixer( 44100, ALLEGRO_AUDIO_DEPTH_INT16, ALLEGRO_CHANNEL_CONF_2 );
+    defaultMixer = al_create_mixer( SampleRate, ALLEGRO_AUDIO_DEPTH_INT16, ALLEGRO_CHANNEL_CONF_2 );
     if ( defaultMixer == nullptr )
         return false;
 
@@ -114,9 +148,6 @@ bool Sound::Init()
 
     for ( int i = 0; i < Instances; i++ )
     {
-        effectRequests[i].SoundId = NoSound;
-        effectRequests[i].Loop = false;
-
         sampleInstances[i] = al_create_sample_instance( nullptr );
         if ( sampleInstances[i] == nullptr )
             return false;
@@ -140,6 +171,46 @@ bool Sound::Init()
     return true;
 }
 
+bool Sound::InitHeadless()
+{
+    headless = true;
+
+    if ( !Util::LoadList<SoundInfo>( "Songs.dat", songs, Songs ) )
+        return false;
+    if ( !Util::LoadList<SoundInfo>( "Effects.dat", effects, Effects ) )
+        return false;
+
+    return true;
+}
+
+Sound::Context* Sound::CreateContext()
+{
+    Context* context = new Context();
+
+    for ( int i = 0; i < Instances; i++ )
+    {
+        context->effectRequests[i].SoundId = NoSound;
+        context->effectRequests[i].Loop = false;
+    }
+
+    return context;
+}
+
+void Sound::DestroyContext( Context* context )
+{
+    delete context;
+}
+
+size_t Sound::GetContextSize()
+{
+    return sizeof( Context );
+}
+
+void Sound::SetContext( Context* context )
+{
+    ctx = context;
+}
+
 void Sound::Uninit()
 {
     for ( int i = 0; i < SEffect_Max; i++ )
@@ -163,7 +234,7 @@ void Sound::Uninit()
 
 static void UpdateSongs()
 {
-    if ( paused )
+    if ( ctx->paused || IsSilent() )
         return;
 
     if ( streams[Sound::EventSongStream] == nullptr
@@ -185,10 +256,17 @@ static void UpdateSongs()
 
 static void UpdateEffects()
 {
+    if ( IsSilent() )
+    {
+        for ( int i = 0; i < Instances; i++ )
+            ctx->effectRequests[i].SoundId = NoSound;
+        return;
+    }
+
     for ( int i = 0; i < Instances; i++ )
     {
-        int id = effectRequests[i].SoundId;
-        effectRequests[i].SoundId = NoSound;
+        int id = ctx->effectRequests[i].SoundId;
+        ctx->effectRequests[i].SoundId = NoSound;
         if ( id != NoSound )
         {
             ALLEGRO_SAMPLE_INSTANCE* instance = sampleInstances[i];
@@ -200,7 +278,7 @@ static void UpdateEffects()
 
                 ALLEGRO_PLAYMODE playMode = ALLEGRO_PLAYMODE_ONCE;
 
-                if ( effectRequests[i].Loop )
+                if ( ctx->effectRequests[i].Loop )
                     playMode = ALLEGRO_PLAYMODE_LOOP;
 
                 al_set_sample_instance_playmode( instance, playMode );
@@ -210,6 +288,25 @@ static void UpdateEffects()
     }
 }
 
+bool Sound::SetMixListener( MixListener listener, void* data )
+{
+    if ( headless || defaultMixer == nullptr )
+        return false;
+
+    if ( listener == nullptr )
+        return al_set_mixer_postprocess_callback( defaultMixer, nullptr, nullptr );
+
+    mixListener = listener;
+    mixListenerData = data;
+
+    return al_set_mixer_postprocess_callback( defaultMixer, MixerPostprocess, nullptr );
+}
+
+void Sound::SetMuted( bool muted )
+{
+    ::muted = muted;
+}
+
 void Sound::Update()
 {
     UpdateSongs();
@@ -222,6 +319,8 @@ void Sound::PlaySong( int songId, int streamId, bool loop )
         return;
     if ( songId < 0 || songId >= _countof( songs ) )
         return;
+    if ( IsSilent() )
+        return;
 
     if ( streams[EventSongStream] == nullptr || !al_get_audio_stream_playing( streams[EventSongStream] ) )
     {
@@ -237,6 +336,8 @@ void Sound::PushSong( int songId )
 {
     if ( songId < 0 || songId >= _countof( songs ) )
         return;
+    if ( IsSilent() )
+        return;
 
     for ( int i = 0; i < LoPriStreams; i++ )
     {
@@ -252,6 +353,9 @@ void Sound::PushSong( int songId )
 
 void Sound::StopSongs()
 {
+    if ( IsSilent() )
+        return;
+
     for ( int i = 0; i < Streams; i++ )
     {
         if ( streams[i] == nullptr )
@@ -277,20 +381,21 @@ void Sound::PlayEffect( int id, bool loop, int instance )
     else
         index = instance;
 
-    int prevId = effectRequests[index].SoundId;
+    int prevId = ctx->effectRequests[index].SoundId;
 
     if ( (prevId == NoSound) || (effects[id].Priority < effects[prevId].Priority) )
     {
-        effectRequests[index].SoundId = id;
-        effectRequests[index].Loop = loop;
+        ctx->effectRequests[index].SoundId = id;
+        ctx->effectRequests[index].Loop = loop;
     }
 }
 
 void Sound::StopEffect( int instance )
 {
-    al_stop_sample_instance( sampleInstances[instance] );
-    effectRequests[instance].SoundId = NoSound;
-    effectRequests[instance].Loop = false;
+    if ( !IsSilent() )
+        al_stop_sample_instance( sampleInstances[instance] );
+    ctx->effectRequests[instance].SoundId = NoSound;
+    ctx->effectRequests[instance].Loop = false;
 }
 
 void Sound::StopEffects()
@@ -309,7 +414,10 @@ void Sound::StopAll()
 
 void Sound::Pause()
 {
-    paused = true;
+    ctx->paused = true;
+
+    if ( IsSilent() )
+        return;
 
     for ( int i = Streams - 1; i >= 0; i-- )
     {
@@ -338,7 +446,10 @@ void Sound::Pause()
 
 void Sound::Unpause()
 {
-    paused = false;
+    ctx->paused = false;
+
+    if ( IsSilent() )
+        return;
 
     for ( int i = Streams - 1; i >= 0; i-- )
     {
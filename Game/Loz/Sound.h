@@ -22,12 +22,36 @@ public:
         AmbientInstance = 4,
     };
 
+    enum
+    {
+        SampleRate      = 44100,
+        ChannelCount    = 2,
+    };
+
+    struct Context;
+
+    // Gets each buffer the mixer makes, of 16-bit samples with the channels
+    // interleaved. It's called on the audio thread.
+    typedef void (*MixListener)( const int16_t* samples, int frameCount, void* data );
+
 public:
     static bool Init();
+    static bool InitHeadless();
     static void Uninit();
 
+    static Context* CreateContext();
+    static void DestroyContext( Context* context );
+    // Contexts hold plain data, so they can be copied as bytes.
+    static size_t GetContextSize();
+    static void SetContext( Context* context );
+
+    static void SetMuted( bool muted );
     static void Update();
 
+    // There's one listener. Pass null to remove it. Returns false if there's
+    // no audio device.
+    static bool SetMixListener( MixListener listener, void* data );
+
     static void PlaySong( int id, int stream, bool loop );
     static void PushSong( int id );
     static void StopSongs();
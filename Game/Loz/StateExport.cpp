@@ -0,0 +1,197 @@
+/*
+   Copyright 2017 Aldo J. Nunez
+
+   Licensed under the Apache License, Version 2.0.
+   See the LICENSE text file for details.
+*/
+
+#include "Common.h"
+#include "StateExport.h"
+#include "Object.h"
+#include "Profile.h"
+#include "World.h"
+#include "WorldImpl.h"
+
+#if !_WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+
+static_assert( StateExport_MaxObjects == MaxObjects, "Frames must have a slot for every object." );
+static_assert( StateExport_MaxItems == ItemSlot_MaxItems, "Frames must have every item." );
+static_assert( StateExport_Rows == World::Rows && StateExport_Columns == World::Columns,
+    "Frames must have the whole tile map." );
+static_assert( sizeof( std::atomic<uint32_t> ) == sizeof( uint32_t ),
+    "Readers see sequence numbers as plain 32-bit numbers." );
+
+const int MaxSlots = 256;
+
+
+StateExporter::StateExporter()
+    :   memory(),
+        memorySize(),
+        header(),
+        slots(),
+        slotCount(),
+#if _WIN32
+        mapping()
+#else
+        fd( -1 ),
+        name()
+#endif
+{
+}
+
+StateExporter::~StateExporter()
+{
+    Close();
+}
+
+bool StateExporter::Open( const char* name, int slotCount )
+{
+    assert( name != nullptr );
+
+    Close();
+
+    if ( slotCount <= 0 || slotCount > MaxSlots )
+        return false;
+
+    size_t size = sizeof( StateExportHeader ) + sizeof( StateExportSlot ) * slotCount;
+
+#if _WIN32
+    mapping = CreateFileMappingA( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, (DWORD) size, name );
+    if ( mapping == NULL )
+    {
+        mapping = nullptr;
+        return false;
+    }
+
+    memory = (uint8_t*) MapViewOfFile( mapping, FILE_MAP_ALL_ACCESS, 0, 0, size );
+#else
+    if ( name[0] == '/' )
+        snprintf( this->name, sizeof this->name, "%s", name );
+    else
+        snprintf( this->name, sizeof this->name, "/%s", name );
+
+    fd = shm_open( this->name, O_CREAT | O_RDWR, 0644 );
+    if ( fd < 0 )
+        return false;
+
+    if ( ftruncate( fd, size ) != 0 )
+    {
+        Close();
+        return false;
+    }
+
+    memory = (uint8_t*) mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    if ( memory == (uint8_t*) MAP_FAILED )
+        memory = nullptr;
+#endif
+
+    if ( memory == nullptr )
+    {
+        Close();
+        return false;
+    }
+
+    memset( memory, 0, size );
+
+    memorySize = size;
+    this->slotCount = slotCount;
+    header = (StateExportHeader*) memory;
+    slots = (StateExportSlot*) (memory + sizeof( StateExportHeader ));
+
+    header->SlotCount = slotCount;
+    header->SlotSize = sizeof( StateExportSlot );
+    header->Version = StateExport_Version;
+    header->LatestFrame.store( 0, std::memory_order_relaxed );
+
+    // Readers check the magic number last.
+    std::atomic_thread_fence( std::memory_order_release );
+    header->Magic = StateExport_Magic;
+
+    return true;
+}
+
+void StateExporter::Close()
+{
+#if _WIN32
+    if ( memory != nullptr )
+        UnmapViewOfFile( memory );
+    if ( mapping != nullptr )
+        CloseHandle( mapping );
+    mapping = nullptr;
+#else
+    if ( memory != nullptr )
+        munmap( memory, memorySize );
+    if ( fd >= 0 )
+    {
+        close( fd );
+        shm_unlink( name );
+    }
+    fd = -1;
+#endif
+
+    memory = nullptr;
+    memorySize = 0;
+    header = nullptr;
+    slots = nullptr;
+    slotCount = 0;
+}
+
+bool StateExporter::IsOpen() const
+{
+    return memory != nullptr;
+}
+
+void StateExporter::Write( uint32_t frameNumber )
+{
+    if ( memory == nullptr )
+        return;
+
+    WorldImpl* world = World::GetCurrent();
+    if ( world == nullptr )
+        return;
+
+    StateExportSlot& slot = slots[frameNumber % slotCount];
+    StateExportFrame& frame = slot.Frame;
+    uint32_t seq = slot.Sequence.load( std::memory_order_relaxed );
+
+    slot.Sequence.store( seq + 1, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+
+    frame.Frame = frameNumber;
+    frame.Mode = world->curMode;
+    frame.RoomId = world->curRoomId;
+    frame.Hearts = world->profile.Hearts;
+    memcpy( frame.Items, world->profile.Items, sizeof frame.Items );
+
+    for ( int i = 0; i < MaxObjects; i++ )
+    {
+        StateExportObject& objExport = frame.Objects[i];
+        Object* obj = World::GetObject( i );
+
+        if ( obj == nullptr )
+        {
+            memset( &objExport, 0, sizeof objExport );
+            continue;
+        }
+
+        objExport.Type = obj->GetType();
+        objExport.X = obj->GetX();
+        objExport.Y = obj->GetY();
+        objExport.Facing = obj->GetFacing();
+        objExport.HP = obj->GetHP();
+        objExport.Decoration = obj->GetDecoration();
+        objExport.ObjectTimer = obj->GetObjectTimer();
+        objExport.StunTimer = obj->GetStunTimer();
+    }
+
+    memcpy( frame.TileBehaviors, world->tileMaps[world->curTileMapIndex].tileBehaviors,
+        sizeof frame.TileBehaviors );
+
+    slot.Sequence.store( seq + 2, std::memory_order_release );
+    header->LatestFrame.store( frameNumber, std::memory_order_release );
+}
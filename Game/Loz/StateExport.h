@@ -0,0 +1,104 @@
+/*
+   Copyright 2017 Aldo J. Nunez
+
+   Licensed under the Apache License, Version 2.0.
+   See the LICENSE text file for details.
+*/
+
+#pragma once
+
+#include <atomic>
+
+
+// Publishes the live game state every frame to a block of shared memory
+// that other local processes can map and read in place.
+//
+// The block is a StateExportHeader followed by SlotCount slots. Frame n is
+// written to slot n % SlotCount, and then LatestFrame is set to n.
+//
+// Each slot is guarded by its own sequence number, like a seqlock. The
+// writer makes the number odd, writes the frame, and then makes it even
+// again. To read a frame: read the sequence number, copy the frame, and
+// read the sequence number again. The copy is good if the two numbers are
+// equal and even. The writer never waits on readers.
+
+enum
+{
+    StateExport_Magic       = 0x58455A4C,   // "LZEX"
+    StateExport_Version     = 1,
+    StateExport_MaxObjects  = 26,
+    StateExport_MaxItems    = 32,
+    StateExport_Rows        = 22,
+    StateExport_Columns     = 32,
+};
+
+struct StateExportObject
+{
+    uint8_t     Type;       // 0 for an empty slot
+    uint8_t     X;
+    uint8_t     Y;
+    uint8_t     Facing;
+    uint8_t     HP;
+    uint8_t     Decoration;
+    uint8_t     ObjectTimer;
+    uint8_t     StunTimer;
+};
+
+struct StateExportFrame
+{
+    uint32_t            Frame;
+    int32_t             Mode;
+    int32_t             RoomId;
+    uint16_t            Hearts;
+    uint8_t             Reserved[2];
+    uint8_t             Items[StateExport_MaxItems];
+    // The player is in its own slot, PlayerSlot.
+    StateExportObject   Objects[StateExport_MaxObjects];
+    uint8_t             TileBehaviors[StateExport_Rows][StateExport_Columns];
+};
+
+struct StateExportSlot
+{
+    std::atomic<uint32_t>   Sequence;
+    uint32_t                Reserved;
+    StateExportFrame        Frame;
+};
+
+struct StateExportHeader
+{
+    uint32_t                Magic;
+    uint16_t                Version;
+    uint16_t                SlotCount;
+    uint32_t                SlotSize;
+    std::atomic<uint32_t>   LatestFrame;
+};
+
+
+class StateExporter
+{
+    uint8_t*            memory;
+    size_t              memorySize;
+    StateExportHeader*  header;
+    StateExportSlot*    slots;
+    int                 slotCount;
+#if _WIN32
+    void*               mapping;
+#else
+    int                 fd;
+    char                name[64];
+#endif
+
+public:
+    StateExporter();
+    ~StateExporter();
+
+    // On Windows, the name is of a file mapping object. Elsewhere, it's a
+    // POSIX shared memory object, and is given a leading slash if it needs
+    // one.
+    bool Open( const char* name, int slotCount );
+    void Close();
+    bool IsOpen() const;
+
+    // Copies the current world's state into the next slot.
+    void Write( uint32_t frame );
+};
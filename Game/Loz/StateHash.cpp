@@ -0,0 +1,244 @@
+/*
+   Copyright 2017 Aldo J. Nunez
+
+   Licensed under the Apache License, Version 2.0.
+   See the LICENSE text file for details.
+*/
+
+#include "Common.h"
+#include "StateHash.h"
+
+
+const uint64_t Prime1 = 11400714785074694791ULL;
+const uint64_t Prime2 = 14029467366897019727ULL;
+const uint64_t Prime3 =  1609587929392839161ULL;
+const uint64_t Prime4 =  9650029242287828579ULL;
+const uint64_t Prime5 =  2870177450012600261ULL;
+
+
+static uint64_t RotateLeft( uint64_t value, int count )
+{
+    return (value << count) | (value >> (64 - count));
+}
+
+static uint64_t Read64( const uint8_t* data )
+{
+    uint64_t value;
+    memcpy( &value, data, sizeof value );
+    return value;
+}
+
+static uint32_t Read32( const uint8_t* data )
+{
+    uint32_t value;
+    memcpy( &value, data, sizeof value );
+    return value;
+}
+
+static uint64_t Round( uint64_t acc, uint64_t input )
+{
+    acc += input * Prime2;
+    acc = RotateLeft( acc, 31 );
+    return acc * Prime1;
+}
+
+static uint64_t MergeRound( uint64_t acc, uint64_t value )
+{
+    acc ^= Round( 0, value );
+    return acc * Prime1 + Prime4;
+}
+
+
+//----------------------------------------------------------------------------
+//  StateHash
+//----------------------------------------------------------------------------
+
+StateHash::StateHash( uint64_t seed )
+{
+    Reset( seed );
+}
+
+void StateHash::Reset( uint64_t seed )
+{
+    this->seed = seed;
+    lanes[0] = seed + Prime1 + Prime2;
+    lanes[1] = seed + Prime2;
+    lanes[2] = seed;
+    lanes[3] = seed - Prime1;
+    stripeSize = 0;
+    totalSize = 0;
+}
+
+void StateHash::AddStripe( const uint8_t* data )
+{
+    lanes[0] = Round( lanes[0], Read64( data ) );
+    lanes[1] = Round( lanes[1], Read64( data + 8 ) );
+    lanes[2] = Round( lanes[2], Read64( data + 16 ) );
+    lanes[3] = Round( lanes[3], Read64( data + 24 ) );
+}
+
+void StateHash::Add( const void* data, size_t size )
+{
+    const uint8_t* bytes = (const uint8_t*) data;
+
+    totalSize += size;
+
+    if ( stripeSize > 0 )
+    {
+        size_t count = sizeof stripe - stripeSize;
+        if ( count > size )
+            count = size;
+
+        memcpy( &stripe[stripeSize], bytes, count );
+        stripeSize += count;
+        bytes += count;
+        size -= count;
+
+        if ( stripeSize < sizeof stripe )
+            return;
+
+        AddStripe( stripe );
+        stripeSize = 0;
+    }
+
+    for ( ; size >= sizeof stripe; bytes += sizeof stripe, size -= sizeof stripe )
+    {
+        AddStripe( bytes );
+    }
+
+    memcpy( stripe, bytes, size );
+    stripeSize = size;
+}
+
+uint64_t StateHash::Finish() const
+{
+    uint64_t hash;
+
+    if ( totalSize >= sizeof stripe )
+    {
+        hash = RotateLeft( lanes[0], 1 ) + RotateLeft( lanes[1], 7 )
+            + RotateLeft( lanes[2], 12 ) + RotateLeft( lanes[3], 18 );
+        hash = MergeRound( hash, lanes[0] );
+        hash = MergeRound( hash, lanes[1] );
+        hash = MergeRound( hash, lanes[2] );
+        hash = MergeRound( hash, lanes[3] );
+    }
+    else
+    {
+        hash = seed + Prime5;
+    }
+
+    hash += totalSize;
+
+    const uint8_t*  bytes = stripe;
+    size_t          size = stripeSize;
+
+    for ( ; size >= 8; bytes += 8, size -= 8 )
+    {
+        hash ^= Round( 0, Read64( bytes ) );
+        hash = RotateLeft( hash, 27 ) * Prime1 + Prime4;
+    }
+
+    if ( size >= 4 )
+    {
+        hash ^= Read32( bytes ) * Prime1;
+        hash = RotateLeft( hash, 23 ) * Prime2 + Prime3;
+        bytes += 4;
+        size -= 4;
+    }
+
+    for ( ; size > 0; bytes++, size-- )
+    {
+        hash ^= *bytes * Prime5;
+        hash = RotateLeft( hash, 11 ) * Prime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= Prime2;
+    hash ^= hash >> 29;
+    hash *= Prime3;
+    hash ^= hash >> 32;
+
+    return hash;
+}
+
+
+//----------------------------------------------------------------------------
+//  StateHashLog
+//----------------------------------------------------------------------------
+
+StateHashLog::StateHashLog()
+    :   file()
+{
+}
+
+StateHashLog::~StateHashLog()
+{
+    Close();
+}
+
+bool StateHashLog::Create( const char* path )
+{
+    Close();
+
+    errno_t err = fopen_s( &file, path, "w" );
+    if ( err != 0 )
+    {
+        file = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+bool StateHashLog::Open( const char* path )
+{
+    Close();
+
+    errno_t err = fopen_s( &file, path, "r" );
+    if ( err != 0 )
+    {
+        file = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+void StateHashLog::Close()
+{
+    if ( file != nullptr )
+    {
+        fclose( file );
+        file = nullptr;
+    }
+}
+
+bool StateHashLog::IsOpen() const
+{
+    return file != nullptr;
+}
+
+bool StateHashLog::Write( uint32_t frame, uint64_t hash )
+{
+    if ( file == nullptr )
+        return false;
+
+    return fprintf( file, "%u %016llx\n", frame, (unsigned long long) hash ) > 0;
+}
+
+bool StateHashLog::Read( uint32_t& frame, uint64_t& hash )
+{
+    if ( file == nullptr )
+        return false;
+
+    unsigned int        frameValue = 0;
+    unsigned long long  hashValue = 0;
+
+    if ( fscanf_s( file, "%u %llx", &frameValue, &hashValue ) != 2 )
+        return false;
+
+    frame = frameValue;
+    hash = hashValue;
+    return true;
+}
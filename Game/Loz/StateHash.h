@@ -0,0 +1,59 @@
+/*
+   Copyright 2017 Aldo J. Nunez
+
+   Licensed under the Apache License, Version 2.0.
+   See the LICENSE text file for details.
+*/
+
+#pragma once
+
+
+// A streaming 64-bit hash in the style of xxHash64. Input is taken in
+// stripes of 32 bytes, spread over four independent lanes, so the main
+// loop pipelines and vectorizes well.
+
+class StateHash
+{
+    uint64_t    seed;
+    uint64_t    lanes[4];
+    uint8_t     stripe[32];
+    size_t      stripeSize;
+    uint64_t    totalSize;
+
+public:
+    StateHash( uint64_t seed = 0 );
+
+    void Reset( uint64_t seed = 0 );
+    void Add( const void* data, size_t size );
+    uint64_t Finish() const;
+
+    template <typename T>
+    void AddValue( const T& value )
+    {
+        Add( &value, sizeof value );
+    }
+
+private:
+    void AddStripe( const uint8_t* data );
+};
+
+
+// A text file with one line for each frame: the frame number and its hash.
+
+class StateHashLog
+{
+    FILE*       file;
+
+public:
+    StateHashLog();
+    ~StateHashLog();
+
+    bool Create( const char* path );
+    bool Open( const char* path );
+    void Close();
+    bool IsOpen() const;
+
+    bool Write( uint32_t frame, uint64_t hash );
+    // Returns false at the end of the log.
+    bool Read( uint32_t& frame, uint64_t& hash );
+};
@@ -37,8 +37,44 @@ enum
     Tile_FullHeart  = 0xF2,
     Tile_HalfHeart  = 0x65,
     Tile_EmptyHeart = 0x66,
+
+    // The cache layer has a band for each palette that the cached parts
+    // use: 0 for the frames and counters, and 1 for the hearts.
+    CachedPaletteCount = 2,
+};
+
+static_assert( RedBgPalette < CachedPaletteCount, "Hearts have to be in the cache layer." );
+
+// Everything that the cached parts are drawn from. When it changes, the
+// layer is drawn again. This catches every way that the inventory can
+// change, including damage and loading snapshots.
+
+struct CacheKey
+{
+    uint8_t     counters;
+    uint8_t     overworld;
+    uint8_t     levelNumber;
+    uint8_t     hasMap;
+    uint8_t     drawnMap[World::LevelInfoBlock::MapLength];
+    uint8_t     magicKey;
+    uint8_t     keys;
+    uint8_t     bombs;
+    uint8_t     rupees;
+    uint8_t     heartContainers;
+    uint16_t    hearts;
 };
 
+struct StatusBar::Cache
+{
+    Graphics::Layer*    layer;
+    bool                layerFailed;
+    bool                valid;
+    CacheKey            key;
+};
+
+// Counted for each thread, as worlds on other threads draw too.
+static thread_local uint32_t redrawCount;
+
 struct TileInst
 {
     uint8_t Id;
@@ -88,10 +124,17 @@ static const TileInst uiTiles[] =
 
 
 StatusBar::StatusBar()
-    :   features( Feature_All )
+    :   features( Feature_All ),
+        cache( new Cache() )
 {
 }
 
+StatusBar::~StatusBar()
+{
+    Graphics::DestroyLayer( cache->layer );
+    delete cache;
+}
+
 void StatusBar::EnableFeatures( Features features, bool enable )
 {
     if ( enable )
@@ -102,30 +145,173 @@ void StatusBar::EnableFeatures( Features features, bool enable )
 
 void StatusBar::Draw( int baseY )
 {
-    ALLEGRO_COLOR backColor = al_map_rgb( 0, 0, 0 );
-    Draw( baseY, backColor );
+    Draw( baseY, BlackBackground );
 }
 
-void StatusBar::Draw( int baseY, ALLEGRO_COLOR backColor )
+StatusBar::Cache* StatusBar::GetCache() const
+{
+    return cache;
+}
+
+void StatusBar::SetCache( Cache* cache )
+{
+    assert( cache != nullptr );
+    this->cache = cache;
+}
+
+uint32_t StatusBar::GetRedrawCount()
+{
+    return redrawCount;
+}
+
+// The cached parts don't depend on the background, which is drawn first.
+// Whatever blinks or flashes is drawn over the layer each frame.
+
+void StatusBar::Draw( int baseY, int backSysColor )
 {
     Graphics::SetClip( 0, baseY, StatusBarWidth, StatusBarHeight );
 
-    al_clear_to_color( backColor );
+    if ( backSysColor == BlackBackground )
+        Graphics::Clear();
+    else
+        Graphics::Clear( backSysColor );
 
-    for ( int i = 0; i < _countof( uiTiles ); i++ )
+    if ( UpdateCache() )
     {
-        const TileInst& tileInst = uiTiles[i];
-        DrawTile( tileInst.Id, tileInst.X, tileInst.Y + baseY, tileInst.Palette );
+        // Each band is a draw of its own, as each has its own palette. They
+        // have the same texture and clip, so they're recorded into one
+        // batch, and sent in one call.
+        for ( int palette = 0; palette < CachedPaletteCount; palette++ )
+        {
+            Graphics::DrawLayer( 
+                cache->layer,
+                0, palette * StatusBarHeight,
+                StatusBarWidth, StatusBarHeight,
+                0, baseY,
+                palette );
+        }
+    }
+    else
+    {
+        for ( int palette = 0; palette < CachedPaletteCount; palette++ )
+            DrawCachedParts( baseY, palette );
     }
 
-    DrawMiniMap( baseY );
-    DrawItems( baseY );
+    DrawMapCursors( baseY );
+    DrawEquipment( baseY );
 
     Graphics::ResetClip();
 }
 
+// Returns false if there's no layer, and the parts have to be drawn
+// directly.
+
+bool StatusBar::UpdateCache()
+{
+    if ( cache->layer == nullptr )
+    {
+        if ( cache->layerFailed )
+            return false;
+
+        cache->layer = Graphics::CreateLayer( StatusBarWidth, StatusBarHeight * CachedPaletteCount );
+        if ( cache->layer == nullptr )
+        {
+            cache->layerFailed = true;
+            return false;
+        }
+    }
+
+    CacheKey key;
+    Profile& profile = World::GetProfile();
+
+    memset( &key, 0, sizeof key );
+
+    key.counters = (features & Feature_Counters) != 0;
+    key.overworld = World::IsOverworld();
+
+    if ( !key.overworld )
+    {
+        const World::LevelInfoBlock* levelInfo = World::GetLevelInfo();
+
+        key.levelNumber = levelInfo->LevelNumber;
+        key.hasMap = World::HasCurrentMap();
+
+        if ( key.hasMap )
+            memcpy( key.drawnMap, levelInfo->DrawnMap, sizeof key.drawnMap );
+    }
+
+    if ( key.counters )
+    {
+        key.magicKey = World::GetItem( ItemSlot_MagicKey );
+        key.keys = World::GetItem( ItemSlot_Keys );
+        key.bombs = World::GetItem( ItemSlot_Bombs );
+        key.rupees = World::GetItem( ItemSlot_Rupees );
+        key.heartContainers = World::GetItem( ItemSlot_HeartContainers );
+        key.hearts = profile.Hearts;
+    }
+
+    if ( cache->valid && 0 == memcmp( &key, &cache->key, sizeof key ) )
+        return true;
+
+    Graphics::BeginLayer( cache->layer );
+
+    for ( int palette = 0; palette < CachedPaletteCount; palette++ )
+        DrawCachedParts( palette * StatusBarHeight, palette );
+
+    Graphics::EndLayer();
+
+    cache->key = key;
+    cache->valid = true;
+    redrawCount++;
+    return true;
+}
+
+// Draws the cached parts that use a palette.
+
+void StatusBar::DrawCachedParts( int baseY, int palette )
+{
+    for ( int i = 0; i < _countof( uiTiles ); i++ )
+    {
+        const TileInst& tileInst = uiTiles[i];
+
+        if ( tileInst.Palette == palette )
+            DrawTile( tileInst.Id, tileInst.X, tileInst.Y + baseY, tileInst.Palette );
+    }
+
+    if ( palette == 0 )
+    {
+        DrawMiniMap( baseY );
+        DrawCounters( baseY );
+    }
+    else if ( palette == RedBgPalette )
+    {
+        if ( (features & Feature_Counters) != 0 )
+            DrawHearts( baseY );
+    }
+}
+
 void StatusBar::DrawMiniMap( int baseY )
 {
+    if ( World::IsOverworld() )
+    {
+        DrawOWMiniMap( baseY );
+    }
+    else
+    {
+        uint8_t levelStr[] = { 0x15, 0x0E, 0x1F, 0x0E, 0x15, 0x62, 0 };
+        const World::LevelInfoBlock* levelInfo = World::GetLevelInfo();
+
+        levelStr[6] = levelInfo->LevelNumber;
+        DrawString( levelStr, _countof( levelStr ), LevelNameX, baseY + LevelNameY, 0 );
+        DrawUWMiniMap( baseY );
+    }
+}
+
+void StatusBar::DrawMapCursors( int baseY )
+{
+    if ( (features & Feature_MapCursors) == 0 )
+        return;
+
     int roomId = World::GetRoomId();
     int row = (roomId >> 4) & 0xF;
     int col = roomId & 0xF;
@@ -135,20 +321,13 @@ void StatusBar::DrawMiniMap( int baseY )
 
     if ( World::IsOverworld() )
     {
-        DrawOWMiniMap( baseY );
-
         cursorX += col * OWMapTileWidth;
         cursorY += row * OWMapTileHeight;
     }
     else
     {
-        uint8_t levelStr[] = { 0x15, 0x0E, 0x1F, 0x0E, 0x15, 0x62, 0 };
         const World::LevelInfoBlock* levelInfo = World::GetLevelInfo();
 
-        levelStr[6] = levelInfo->LevelNumber;
-        DrawString( levelStr, _countof( levelStr ), LevelNameX, baseY + LevelNameY, 0 );
-        DrawUWMiniMap( baseY );
-
         col = (col + levelInfo->DrawnMapOffset) & 0xF;
         col -= MiniMapColumnOffset;
 
@@ -158,8 +337,7 @@ void StatusBar::DrawMiniMap( int baseY )
         if ( !World::IsUWMain( roomId ) )
             showCursor = false;
 
-        if ( (features & Feature_MapCursors) != 0
-            && World::HasCurrentCompass() )
+        if ( World::HasCurrentCompass() )
         {
             int triforceRoomId = levelInfo->TriforceRoomId;
             int triforceRow = (triforceRoomId >> 4) & 0xF;
@@ -180,11 +358,8 @@ void StatusBar::DrawMiniMap( int baseY )
         }
     }
 
-    if ( (features & Feature_MapCursors) != 0 )
-    {
-        if ( showCursor )
-            DrawTile( 0xE0, cursorX, cursorY, PlayerPalette );
-    }
+    if ( showCursor )
+        DrawTile( 0xE0, cursorX, cursorY, PlayerPalette );
 }
 
 void StatusBar::DrawTile( int tile, int x, int y, int palette )
@@ -256,26 +431,27 @@ static void DrawCount( int itemSlot, int x, int y )
     DrawString( strLeft, length, x, y, 0 );
 }
 
-void StatusBar::DrawItems( int baseY )
+void StatusBar::DrawCounters( int baseY )
 {
-    if ( (features & Feature_Counters) != 0 )
-    {
-        if ( World::GetItem( ItemSlot_MagicKey ) != 0 )
-        {
-            static const uint8_t XA[] = { Char_X, 0x0A };
-            DrawString( XA, 2, CountersX, 0x28 + baseY, 0 );
-        }
-        else
-        {
-            DrawCount( ItemSlot_Keys, CountersX, 0x28 + baseY );
-        }
-
-        DrawCount( ItemSlot_Bombs, CountersX, 0x30 + baseY );
-        DrawCount( ItemSlot_Rupees, CountersX, 0x18 + baseY );
+    if ( (features & Feature_Counters) == 0 )
+        return;
 
-        DrawHearts( baseY );
+    if ( World::GetItem( ItemSlot_MagicKey ) != 0 )
+    {
+        static const uint8_t XA[] = { Char_X, 0x0A };
+        DrawString( XA, 2, CountersX, 0x28 + baseY, 0 );
+    }
+    else
+    {
+        DrawCount( ItemSlot_Keys, CountersX, 0x28 + baseY );
     }
 
+    DrawCount( ItemSlot_Bombs, CountersX, 0x30 + baseY );
+    DrawCount( ItemSlot_Rupees, CountersX, 0x18 + baseY );
+}
+
+void StatusBar::DrawEquipment( int baseY )
+{
     if ( (features & Feature_Equipment) != 0 )
     {
         DrawSword( baseY );
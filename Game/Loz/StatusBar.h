@@ -14,6 +14,9 @@ public:
     enum
     {
         StatusBarHeight = 0x40,
+
+        // Instead of a system color, for a background that's always black.
+        BlackBackground = -1,
     };
 
     enum Features
@@ -30,24 +33,44 @@ public:
         Feature_EquipmentAndMap = Feature_Equipment | Feature_MapCursors,
     };
 
+    // The parts that only change with the inventory and the level are drawn
+    // into a layer, and kept until they change.
+    struct Cache;
+
 private:
     Features features;
+    Cache*   cache;
 
 public:
     StatusBar();
+    ~StatusBar();
 
     void EnableFeatures( Features features, bool enable );
     void Draw( int baseY );
-    void Draw( int baseY, ALLEGRO_COLOR backColor );
+    void Draw( int baseY, int backSysColor );
+
+    // The cache belongs to the status bar, not to world snapshots. Loading
+    // a snapshot has to put it back.
+    Cache* GetCache() const;
+    void SetCache( Cache* cache );
+
+    // How many times the cached parts were drawn again on the calling
+    // thread.
+    static uint32_t GetRedrawCount();
 
 private:
     void DrawTile( int tile, int x, int y, int palette );
 
+    bool UpdateCache();
+    void DrawCachedParts( int baseY, int palette );
+
     void DrawMiniMap( int baseY );
     void DrawOWMiniMap( int baseY );
     void DrawUWMiniMap( int baseY );
+    void DrawMapCursors( int baseY );
 
-    void DrawItems( int baseY );
+    void DrawCounters( int baseY );
+    void DrawEquipment( int baseY );
     void DrawSword( int baseY );
     void DrawItemB( int baseY );
     void DrawHearts( int baseY );
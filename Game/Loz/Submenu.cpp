@@ -14,6 +14,7 @@
 #include "Profile.h"
 #include "Sound.h"
 #include "SoundId.h"
+#include "TextCache.h"
 #include "World.h"
 
 
@@ -334,7 +335,7 @@ void Submenu::Draw( int bottom )
 
 void Submenu::DrawBackground( int top )
 {
-    al_clear_to_color( al_map_rgb( 0, 0, 0 ) );
+    Graphics::Clear();
 
     for ( int i = 0; i < _countof( uiTiles ); i++ )
     {
@@ -452,13 +453,10 @@ void Submenu::DrawTriforce( int top )
     DrawChar( 0xF0, 0xA0, 0x90 + top, 1 );
     DrawChar( 0xEC, 0xA8, 0x90 + top, 1 );
 
-    DrawString( Triforce, _countof( Triforce ), 0x60, 0xA0 + top, 1 );
+    static const uint8_t TriforceBase[] = { 0xF1, 0xF1, 0xF1, 0xF1, 0xF1, 0xF1, 0xF1, 0xF1 };
 
-    int x = 0x60;
-    for ( int i = 0; i < 8; i++, x += 8 )
-    {
-        DrawChar( 0xF1, x, 0x90 + top, 1 );
-    }
+    TextCache::DrawString( Triforce, _countof( Triforce ), 0x60, 0xA0 + top, 1 );
+    TextCache::DrawString( TriforceBase, _countof( TriforceBase ), 0x60, 0x90 + top, 1 );
 
     uint pieces = World::GetItem( ItemSlot_TriforcePieces );
     uint piece = pieces;
@@ -510,20 +508,18 @@ void Submenu::DrawMap( int top )
     static const uint8_t BottomMapLine[] = 
     { 0xF5, 0xFE, 0xF5, 0xF5, 0xF5, 0xFE, 0xF5, 0xF5, 0xF5, 0xF5, 0xFE, 0xF5, 0xF5, 0xF5, 0xFE, 0xF5 };
 
-    DrawString( Map, _countof( Map ), 0x28, 0x58 + top, 1 );
-    DrawString( Compass, _countof( Compass ), 0x18, 0x80 + top, 1 );
-    DrawString( TopMapLine, _countof( TopMapLine ), 0x60, 0x50 + top, 1 );
-    DrawString( BottomMapLine, _countof( BottomMapLine ), 0x60, 0x98 + top, 1 );
+    static const uint8_t MapSide[] = { 0xF5, 0xF5, 0xF5, 0xF5 };
+
+    TextCache::DrawString( Map, _countof( Map ), 0x28, 0x58 + top, 1 );
+    TextCache::DrawString( Compass, _countof( Compass ), 0x18, 0x80 + top, 1 );
+    TextCache::DrawString( TopMapLine, _countof( TopMapLine ), 0x60, 0x50 + top, 1 );
+    TextCache::DrawString( BottomMapLine, _countof( BottomMapLine ), 0x60, 0x98 + top, 1 );
 
     int y = 0x58 + top;
     for ( int r = 0; r < 8; r++, y += 8 )
     {
-        int x = 0;
-        for ( int c = 0; c < 4; c++, x += 8 )
-        {
-            DrawChar( 0xF5, 0x60 + x, y, 1 );
-            DrawChar( 0xF5, 0xC0 + x, y, 1 );
-        }
+        TextCache::DrawString( MapSide, _countof( MapSide ), 0x60, y, 1 );
+        TextCache::DrawString( MapSide, _countof( MapSide ), 0xC0, y, 1 );
     }
 
     const World::LevelInfoBlock* levelInfo = World::GetLevelInfo();
@@ -535,37 +531,31 @@ void Submenu::DrawMap( int top )
     if ( hasCompass )
         DrawItemNarrow( Item_Compass, 0x30, 0x90 + top );
 
-    int x = ActiveMapX;
-    for ( int c = 0; c < 8; c++, x += 8 )
+    // The map is drawn a row at a time, from the text cache. So it's drawn
+    // again only when a tile changes, as when a room is visited or a door
+    // is opened.
+    uint8_t mapTiles[8][8];
+
+    for ( int c = 0; c < 8; c++ )
     {
         uint mapMaskByte = levelInfo->DrawnMap[c + 4];
-        y = ActiveMapY + top;
-        for ( int r = 0; r < 8; r++, y += 8, mapMaskByte <<= 1 )
+        for ( int r = 0; r < 8; r++, mapMaskByte <<= 1 )
         {
             int roomId = (r << 4) | (c - levelInfo->DrawnMapOffset + 0x10 + 4) & 0xF;
             UWRoomFlags& roomFlags = World::GetUWRoomFlags( roomId );
             uint8_t tile = 0xF5;
             if ( (mapMaskByte & 0x80) == 0x80 && roomFlags.GetVisitState() )
-            {
-                uint doorSum = 0;
-                uint doorBit = 8;
-                for ( ; doorBit != 0; doorBit >>= 1 )
-                {
-                    DoorType doorType = World::GetDoorType( roomId, (Direction) doorBit );
-                    if ( doorType == DoorType_Open )
-                        doorSum |= doorBit;
-                    else if ( roomFlags.GetDoorState( doorBit )
-                        && (doorType == DoorType_Bombable 
-                        ||  doorType == DoorType_Key 
-                        ||  doorType == DoorType_Key2) )
-                        doorSum |= doorBit;
-                }
-                tile = 0xD0 + doorSum;
-            }
-            DrawChar( tile, x, y, 1 );
+                tile = 0xD0 + World::GetMapDoors( roomId );
+            mapTiles[r][c] = tile;
         }
     }
 
+    y = ActiveMapY + top;
+    for ( int r = 0; r < 8; r++, y += 8 )
+    {
+        TextCache::DrawString( mapTiles[r], _countof( mapTiles[r] ), ActiveMapX, y, 1 );
+    }
+
     int curRoomId = World::GetRoomId();
     int playerRow = (curRoomId >> 4) & 0xF;
     int playerCol = curRoomId & 0xF;
@@ -573,6 +563,6 @@ void Submenu::DrawMap( int top )
     playerCol -= 4;
 
     y = ActiveMapY + top + playerRow * 8 + 3;
-    x = ActiveMapX + playerCol * 8 + 2;
+    int x = ActiveMapX + playerCol * 8 + 2;
     DrawChar( 0xE0, x, y, PlayerPalette );
 }
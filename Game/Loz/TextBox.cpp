@@ -10,6 +10,8 @@
 #include "ItemObj.h"
 #include "Sound.h"
 #include "SoundId.h"
+#include "StateHash.h"
+#include "TextCache.h"
 
 
 TextBox::TextBox( const uint8_t* str, int delay )
@@ -93,8 +95,13 @@ void TextBox::Update()
     }
 }
 
+// Each line is drawn as a run. The last one grows as the text is typed out,
+// so the text cache only has to add a char now and then.
+
 void TextBox::Draw()
 {
+    uint8_t line[StdViewWidth / 8];
+    int length = 0;
     int x = left;
     int y = top;
 
@@ -103,17 +110,40 @@ void TextBox::Draw()
         uint8_t attr = *charPtr & 0xC0;
         uint8_t ch   = *charPtr & 0x3F;
 
-        if ( ch != Char_JustSpace )
-            DrawChar( ch, x, y, 0 );
+        // A blank space is the same as no char.
+        if ( ch == Char_JustSpace )
+            ch = Char_Space;
 
-        if ( attr == 0 )
+        if ( length == _countof( line ) )
         {
-            x += 8;
+            TextCache::DrawString( line, length, x, y, 0 );
+            x += length * 8;
+            length = 0;
         }
-        else
+
+        line[length++] = ch;
+
+        if ( attr != 0 )
         {
+            TextCache::DrawString( line, length, x, y, 0 );
+            length = 0;
             x = StartX;
             y += 8;
         }
     }
+
+    TextCache::DrawString( line, length, x, y, 0 );
+}
+
+void TextBox::HashState( StateHash& hash )
+{
+    int shownLength = (int) (curCharPtr - startCharPtr);
+
+    hash.AddValue( left );
+    hash.AddValue( top );
+    hash.AddValue( height );
+    hash.AddValue( charDelay );
+    hash.AddValue( charTimer );
+    hash.AddValue( drawingDialog );
+    hash.AddValue( shownLength );
 }
@@ -8,6 +8,9 @@
 #pragma once
 
 
+class StateHash;
+
+
 class TextBox
 {
 public:
@@ -41,4 +44,7 @@ public:
 
     void Update();
     void Draw();
+    // Adds the box's state to a hash of the world. The text itself is
+    // read-only, so only how far it's shown is added.
+    void HashState( StateHash& hash );
 };
@@ -0,0 +1,153 @@
+/*
+   Copyright 2017 Aldo J. Nunez
+
+   Licensed under the Apache License, Version 2.0.
+   See the LICENSE text file for details.
+*/
+
+#include "Common.h"
+#include "TextCache.h"
+#include "Graphics.h"
+#include "ItemObj.h"
+
+
+enum
+{
+    GlyphSize       = 8,
+    MaxRunLength    = StdViewWidth / GlyphSize,
+    RunCount        = 64,
+};
+
+struct Run
+{
+    uint8_t     text[MaxRunLength];
+    int         length;
+    // When the run was last drawn, to find the one to replace.
+    uint32_t    lastUse;
+    uint32_t    lastFrame;
+};
+
+// Worlds on other threads draw with the software renderer, each into the
+// frame of its own thread. So each thread has its own runs too.
+static thread_local Graphics::Layer*    layer;
+static thread_local bool                layerFailed;
+static thread_local Run                 runs[RunCount];
+static thread_local uint32_t            useClock;
+
+
+static bool MakeLayer()
+{
+    if ( layer != nullptr )
+        return true;
+
+    if ( layerFailed )
+        return false;
+
+    layer = Graphics::CreateLayer( MaxRunLength * GlyphSize, RunCount * GlyphSize );
+    if ( layer == nullptr )
+    {
+        layerFailed = true;
+        return false;
+    }
+
+    return true;
+}
+
+// Draws the chars of a run from first on into its row. The rest of the row
+// is left as it is.
+
+static void DrawRun( int index, int first )
+{
+    const Run& run = runs[index];
+
+    Graphics::BeginLayer( layer, false );
+
+    for ( int i = first; i < run.length; i++ )
+        DrawChar( run.text[i], i * GlyphSize, index * GlyphSize, 0 );
+
+    Graphics::EndLayer();
+}
+
+// Looks for the run with the string, or makes it. A string can extend a
+// run that wasn't drawn yet this frame. Otherwise, the run used the longest
+// ago is replaced.
+
+static int FindRun( const uint8_t* str, int length )
+{
+    uint32_t frame = GetFrameCounter();
+    int prefixIndex = -1;
+    int oldestIndex = 0;
+
+    for ( int i = 0; i < RunCount; i++ )
+    {
+        const Run& run = runs[i];
+
+        if ( run.length == length )
+        {
+            if ( 0 == memcmp( run.text, str, length ) )
+                return i;
+        }
+        else if ( run.length > 0
+            && run.length < length
+            && run.lastFrame != frame
+            && 0 == memcmp( run.text, str, run.length ) )
+        {
+            if ( prefixIndex < 0 || run.length > runs[prefixIndex].length )
+                prefixIndex = i;
+        }
+
+        if ( run.lastUse < runs[oldestIndex].lastUse )
+            oldestIndex = i;
+    }
+
+    int index = oldestIndex;
+    int first = 0;
+
+    if ( prefixIndex >= 0 )
+    {
+        index = prefixIndex;
+        first = runs[index].length;
+    }
+
+    Run& run = runs[index];
+
+    memcpy( run.text, str, length );
+    run.length = length;
+    DrawRun( index, first );
+
+    return index;
+}
+
+void TextCache::DrawString( const uint8_t* str, int length, int x, int y, int palette )
+{
+    if ( length <= 0 )
+        return;
+
+    if ( length > MaxRunLength || !MakeLayer() )
+    {
+        ::DrawString( str, length, x, y, palette );
+        return;
+    }
+
+    int index = FindRun( str, length );
+    Run& run = runs[index];
+
+    run.lastUse = ++useClock;
+    run.lastFrame = GetFrameCounter();
+
+    Graphics::DrawLayer(
+        layer,
+        0, index * GlyphSize,
+        length * GlyphSize, GlyphSize,
+        x, y,
+        palette );
+}
+
+void TextCache::Uninit()
+{
+    Graphics::DestroyLayer( layer );
+    layer = nullptr;
+    layerFailed = false;
+    memset( runs, 0, sizeof runs );
+    useClock = 0;
+}
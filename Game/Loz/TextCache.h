@@ -0,0 +1,24 @@
+/*
+   Copyright 2017 Aldo J. Nunez
+
+   Licensed under the Apache License, Version 2.0.
+   See the LICENSE text file for details.
+*/
+
+#pragma once
+
+
+// Keeps runs of font chars drawn in a layer, one run to a row, so that a
+// string is drawn in one quad instead of one for each char. Runs are found
+// by their chars. A run that grows, as text being typed out does, only has
+// the new chars drawn.
+
+class TextCache
+{
+public:
+    // Like DrawString. Falls back to it if there's no layer, or the string
+    // doesn't fit in a row.
+    static void DrawString( const uint8_t* str, int length, int x, int y, int palette );
+    // Frees the runs of the calling thread.
+    static void Uninit();
+};
@@ -7,10 +7,30 @@
 
 #include "Common.h"
 #include "Util.h"
+#include <mutex>
+
 
 namespace Util
 {
 
+enum
+{
+    MaxSharedFiles  = 256,
+    MaxSharedPath   = 64,
+};
+
+struct SharedFile
+{
+    char        path[MaxSharedPath];
+    uint8_t*    data;
+    size_t      size;
+};
+
+static std::mutex   sharedFileLock;
+static SharedFile   sharedFiles[MaxSharedFiles];
+static int          sharedFileCount;
+
+
 bool LoadResource( const char* filename, ResourceLoader* loader )
 {
     FILE* file = nullptr;
@@ -31,6 +51,52 @@ bool LoadResource( const char* filename, ResourceLoader* loader )
     return true;
 }
 
+const uint8_t* LoadSharedFile( const char* filename, size_t& size )
+{
+    std::lock_guard<std::mutex> lock( sharedFileLock );
+
+    for ( int i = 0; i < sharedFileCount; i++ )
+    {
+        if ( 0 == strcmp( sharedFiles[i].path, filename ) )
+        {
+            size = sharedFiles[i].size;
+            return sharedFiles[i].data;
+        }
+    }
+
+    assert( sharedFileCount < MaxSharedFiles );
+    if ( sharedFileCount >= MaxSharedFiles )
+        return nullptr;
+
+    FILE* file = nullptr;
+
+    errno_t err = fopen_s( &file, filename, "rb" );
+    if ( err != 0 )
+        return nullptr;
+
+    fseek( file, 0, SEEK_END );
+    int fileSize = ftell( file );
+    fseek( file, 0, SEEK_SET );
+
+    uint8_t* data = new uint8_t[fileSize];
+    size_t lenRead = fread( data, 1, fileSize, file );
+    fclose( file );
+
+    if ( lenRead != fileSize )
+    {
+        delete [] data;
+        return nullptr;
+    }
+
+    SharedFile& entry = sharedFiles[sharedFileCount++];
+    strcpy_s( entry.path, filename );
+    entry.data = data;
+    entry.size = fileSize;
+
+    size = fileSize;
+    return data;
+}
+
 bool IsPerpendicular( Direction dir1, Direction dir2 )
 {
     switch ( dir1 )
@@ -203,9 +269,59 @@ void PolarToCart( float angle, float distance, float& x, float& y )
 }
 
 
+static thread_local Random* curRandom;
+
+void Random::Seed( uint64_t seed, uint64_t stream )
+{
+    State = 0;
+    Inc = (stream << 1) | 1;
+    Next();
+    State += seed;
+    Next();
+}
+
+uint32_t Random::Next()
+{
+    uint64_t    oldState = State;
+    State = oldState * 6364136223846793005ULL + Inc;
+
+    uint32_t    xorShifted = (uint32_t) (((oldState >> 18) ^ oldState) >> 27);
+    uint32_t    rot = (uint32_t) (oldState >> 59);
+
+    return (xorShifted >> rot) | (xorShifted << ((32 - rot) & 31));
+}
+
+// Scale a 32-bit draw into the range with a multiply, and reject the few
+// draws that would make some values more likely than others.
+uint32_t Random::Next( uint32_t max )
+{
+    assert( max > 0 );
+
+    uint64_t    m = (uint64_t) Next() * max;
+    uint32_t    low = (uint32_t) m;
+
+    if ( low < max )
+    {
+        uint32_t threshold = (0x100000000ULL - max) % max;
+
+        while ( low < threshold )
+        {
+            m = (uint64_t) Next() * max;
+            low = (uint32_t) m;
+        }
+    }
+
+    return (uint32_t) (m >> 32);
+}
+
+void SetRandom( Random* random )
+{
+    curRandom = random;
+}
+
 int GetRandom( int max )
 {
-    return rand() % max;
+    return curRandom->Next( max );
 }
 
 void MoveSimple( int& x, int& y, Direction dir, int speed )
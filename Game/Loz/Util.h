@@ -21,6 +21,14 @@ namespace Util
         return b;
     }
 
+    template <typename T>
+    T Min( T a, T b )
+    {
+        if ( a < b )
+            return a;
+        return b;
+    }
+
     bool IsPerpendicular( Direction dir1, Direction dir2 );
     Direction GetOppositeDir( Direction dir );
     int GetDirectionOrd( Direction dir );
@@ -45,6 +53,24 @@ namespace Util
     void Rotate( float angle, float& x, float& y );
     void PolarToCart( float angle, float distance, float& x, float& y );
 
+    // A small PCG32 generator. Each world owns one, so that its random draws
+    // don't depend on the C runtime or on other worlds.
+    struct Random
+    {
+        // Worlds start with the same sequence unless they're given a seed.
+        static const uint64_t DefaultSeed = 0x4C6F7A31;
+
+        uint64_t    State;
+        uint64_t    Inc;
+
+        void Seed( uint64_t seed, uint64_t stream = 0 );
+        uint32_t Next();
+        uint32_t Next( uint32_t max );
+    };
+
+    // Sets the generator that GetRandom draws from on the calling thread.
+    void SetRandom( Random* random );
+    // Returns an unbiased value from 0 to max - 1.
     int GetRandom( int max );
     void MoveSimple( int& x, int& y, Direction dir, int speed );
     void MoveSimple( uint8_t& x, uint8_t& y, Direction dir, int speed );
@@ -131,11 +157,13 @@ namespace Util
     {
         uint16_t    length;
         T*          items;
+        bool        shared;
 
     public:
         List()
             : length( 0 ),
-            items( nullptr )
+            items( nullptr ),
+            shared( false )
         {
         }
 
@@ -165,6 +193,18 @@ namespace Util
             return true;
         }
 
+        bool Share( const uint8_t* data, size_t size )
+        {
+            assert( data != nullptr && size >= sizeof length );
+            Free();
+
+            memcpy( &length, data, sizeof length );
+            items = (T*) (data + sizeof length);
+            shared = true;
+
+            return true;
+        }
+
         const T* GetItems()
         {
             return items;
@@ -178,10 +218,12 @@ namespace Util
     private:
         void Free()
         {
-            if ( items != nullptr )
+            if ( items != nullptr && !shared )
             {
                 delete[] items;
             }
+            items = nullptr;
+            shared = false;
         }
     };
 
@@ -192,12 +234,14 @@ namespace Util
         size_t      length;
         uint16_t*   offsets;
         uint8_t*    heap;
+        bool        shared;
 
     public:
         Table()
             :   length( 0 ),
                 offsets( nullptr ),
-                heap( nullptr )
+                heap( nullptr ),
+                shared( false )
         {
         }
 
@@ -228,6 +272,22 @@ namespace Util
             return true;
         }
 
+        bool Share( const uint8_t* data, size_t size )
+        {
+            assert( data != nullptr && size >= sizeof( uint16_t ) );
+            Free();
+
+            uint16_t len16;
+            memcpy( &len16, data, sizeof len16 );
+
+            length = len16;
+            offsets = (uint16_t*) (data + sizeof len16);
+            heap = (uint8_t*) (offsets + length);
+            shared = true;
+
+            return true;
+        }
+
         const T* GetItem( size_t index )
         {
             assert( index < length );
@@ -247,9 +307,11 @@ namespace Util
         {
             if ( offsets != nullptr )
             {
-                delete [] offsets;
+                if ( !shared )
+                    delete [] offsets;
                 offsets = nullptr;
                 heap = nullptr;
+                shared = false;
             }
         }
     };
@@ -341,6 +403,23 @@ namespace Util
 
     bool LoadResource( const char* filename, ResourceLoader* loader );
 
+    // Reads a file once, and keeps it for the rest of the run. All worlds
+    // share the same contents. Since the contents never move, copies of a
+    // world can keep pointing to them.
+    const uint8_t* LoadSharedFile( const char* filename, size_t& size );
+
+    template <typename TResource>
+    bool LoadSharedResource( const char* filename, TResource* resource )
+    {
+        size_t          size = 0;
+        const uint8_t*  data = LoadSharedFile( filename, size );
+
+        if ( data == nullptr )
+            return false;
+
+        return resource->Share( data, size );
+    }
+
 
     template <typename TTable>
     const void* FindSparseAttr( TTable& table, int attrId, int elemId )
@@ -0,0 +1,265 @@
+/*
+   Copyright 2017 Aldo J. Nunez
+
+   Licensed under the Apache License, Version 2.0.
+   See the LICENSE text file for details.
+*/
+
+#include "Common.h"
+#include "Verify.h"
+#include "Input.h"
+#include "Movie.h"
+#include "Sound.h"
+#include "StateHash.h"
+#include "World.h"
+#include <atomic>
+#include <thread>
+
+
+const int MaxPath = 260;
+const int MaxMessage = 128;
+const int MaxThreads = 64;
+
+static const char HashLogExtension[] = ".hash";
+
+
+struct VerifyJob
+{
+    char        Path[MaxPath];
+    char        Message[MaxMessage];
+    bool        Passed;
+    bool        HasReference;
+    uint32_t    FrameCount;
+};
+
+struct VerifyBatch
+{
+    VerifyJob*          Jobs;
+    int                 JobCount;
+    std::atomic<int>    NextJob;
+};
+
+
+static bool EndsWith( const char* str, const char* suffix )
+{
+    size_t strLen = strlen( str );
+    size_t suffixLen = strlen( suffix );
+
+    return strLen >= suffixLen && 0 == _stricmp( str + strLen - suffixLen, suffix );
+}
+
+// Calls the visitor with the path of every movie in the folder, and returns
+// how many there were.
+
+template <typename TVisitor>
+static int VisitMovies( const char* folder, TVisitor visitor )
+{
+    ALLEGRO_FS_ENTRY* dir = al_create_fs_entry( folder );
+    int count = 0;
+
+    if ( dir == nullptr )
+        return 0;
+
+    if ( al_open_directory( dir ) )
+    {
+        ALLEGRO_FS_ENTRY* entry = nullptr;
+
+        while ( (entry = al_read_directory( dir )) != nullptr )
+        {
+            const char* path = al_get_fs_entry_name( entry );
+
+            if ( (al_get_fs_entry_mode( entry ) & ALLEGRO_FILEMODE_ISFILE) != 0
+                && !EndsWith( path, HashLogExtension )
+                && strlen( path ) < MaxPath )
+            {
+                visitor( count, path );
+                count++;
+            }
+
+            al_destroy_fs_entry( entry );
+        }
+
+        al_close_directory( dir );
+    }
+
+    al_destroy_fs_entry( dir );
+    return count;
+}
+
+static void Fail( VerifyJob& job, const char* message )
+{
+    job.Passed = false;
+    strcpy_s( job.Message, message );
+}
+
+static void RunJob( VerifyJob& job )
+{
+    MoviePlayer     player;
+    StateHashLog    reference;
+    char            refPath[MaxPath + sizeof HashLogExtension];
+
+    job.Passed = true;
+    job.HasReference = false;
+    job.Message[0] = '\0';
+    job.FrameCount = 0;
+
+    if ( !player.Open( job.Path ) )
+    {
+        Fail( job, "not a valid movie" );
+        return;
+    }
+
+    sprintf_s( refPath, "%s%s", job.Path, HashLogExtension );
+    job.HasReference = reference.Open( refPath );
+
+    uint32_t refFrame = 0;
+    uint64_t refHash = 0;
+    bool haveRef = job.HasReference && reference.Read( refFrame, refHash );
+
+    const MovieHeader& header = player.GetHeader();
+    WorldImpl* world = World::Create();
+
+    World::SetRandomSeed( header.Seed );
+    World::Start( header.Slot, header.StartProfile );
+
+    InputButtons buttons = 0;
+
+    while ( player.Next( buttons ) )
+    {
+        Input::Update( buttons );
+        World::Update();
+        Sound::Update();
+
+        job.FrameCount++;
+
+        if ( haveRef && refFrame == job.FrameCount )
+        {
+            uint64_t hash = World::HashState();
+
+            if ( hash != refHash )
+            {
+                sprintf_s( job.Message, "frame %u: hash %016llx differs from the reference's %016llx",
+                    job.FrameCount, (unsigned long long) hash, (unsigned long long) refHash );
+                job.Passed = false;
+                break;
+            }
+
+            haveRef = reference.Read( refFrame, refHash );
+        }
+    }
+
+    World::Destroy( world );
+
+    if ( job.Passed && job.FrameCount < header.FrameCount )
+    {
+        sprintf_s( job.Message, "the movie ends at frame %u of %u", job.FrameCount, header.FrameCount );
+        job.Passed = false;
+    }
+    else if ( job.Passed && haveRef )
+    {
+        sprintf_s( job.Message, "the reference goes on to frame %u", refFrame );
+        job.Passed = false;
+    }
+}
+
+static void RunWorker( VerifyBatch* batch )
+{
+    while ( true )
+    {
+        int index = batch->NextJob++;
+        if ( index >= batch->JobCount )
+            break;
+
+        RunJob( batch->Jobs[index] );
+    }
+}
+
+bool VerifyMovies( const char* folder, int threadCount )
+{
+    int count = VisitMovies( folder, []( int, const char* ) {} );
+
+    if ( count == 0 )
+    {
+        printf( "No movies found in %s\n", folder );
+        return false;
+    }
+
+    VerifyBatch batch;
+
+    batch.Jobs = new VerifyJob[count];
+    batch.JobCount = 0;
+    batch.NextJob = 0;
+
+    // The folder could change between the two passes.
+    VisitMovies( folder, [&batch, count]( int index, const char* path )
+    {
+        if ( index < count )
+        {
+            strcpy_s( batch.Jobs[index].Path, path );
+            batch.JobCount = index + 1;
+        }
+    } );
+
+    if ( threadCount <= 0 )
+        threadCount = std::thread::hardware_concurrency();
+    if ( threadCount <= 0 )
+        threadCount = 1;
+    if ( threadCount > MaxThreads )
+        threadCount = MaxThreads;
+    if ( threadCount > batch.JobCount )
+        threadCount = batch.JobCount;
+
+    std::thread threads[MaxThreads];
+    double startTime = al_get_time();
+
+    for ( int i = 0; i < threadCount; i++ )
+    {
+        threads[i] = std::thread( RunWorker, &batch );
+    }
+
+    for ( int i = 0; i < threadCount; i++ )
+    {
+        threads[i].join();
+    }
+
+    double elapsed = al_get_time() - startTime;
+    uint64_t totalFrames = 0;
+    int passedCount = 0;
+
+    for ( int i = 0; i < batch.JobCount; i++ )
+    {
+        const VerifyJob& job = batch.Jobs[i];
+
+        totalFrames += job.FrameCount;
+
+        if ( job.Passed )
+        {
+            passedCount++;
+            printf( "PASS %s: %u frames%s\n", job.Path, job.FrameCount,
+                job.HasReference ? "" : ", no reference" );
+        }
+        else
+        {
+            printf( "FAIL %s: %s\n", job.Path, job.Message );
+        }
+    }
+
+    double framesPerSec = 0;
+    double runsPerMin = 0;
+
+    if ( elapsed > 0 )
+    {
+        framesPerSec = totalFrames / elapsed;
+        runsPerMin = batch.JobCount * 60 / elapsed;
+    }
+
+    printf( "%d passed, %d failed\n", passedCount, batch.JobCount - passedCount );
+    printf( "%llu frames in %.3f s on %d threads: %.0f frames/s, %.1f runs/min\n",
+        (unsigned long long) totalFrames, elapsed, threadCount, framesPerSec, runsPerMin );
+
+    bool allPassed = passedCount == batch.JobCount;
+
+    delete [] batch.Jobs;
+
+    return allPassed;
+}
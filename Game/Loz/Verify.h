@@ -0,0 +1,22 @@
+/*
+   Copyright 2017 Aldo J. Nunez
+
+   Licensed under the Apache License, Version 2.0.
+   See the LICENSE text file for details.
+*/
+
+#pragma once
+
+
+// Plays every movie in a folder without a display, and checks each one
+// against its reference hash log: the movie's file name followed by
+// ".hash", as written by -hashlog. A reference can hold every frame, or
+// only some, such as the last one. Movies without a reference only have to
+// play to the end.
+//
+// Movies are spread over a pool of threads, each running its own world.
+// Resources are loaded once and shared by all of them.
+//
+// Returns true if every movie passed.
+
+bool VerifyMovies( const char* folder, int threadCount );
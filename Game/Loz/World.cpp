@@ -34,6 +34,21 @@ enum
     LevelGroups     = 3,
 };
 
+const int FadeSeqLength = World::LevelInfoBlock::FadeLength * World::LevelInfoBlock::FadePals;
+
+// Where each sequence starts in the effect palettes loaded for a level. A
+// step of a fade is FadePals palettes long.
+enum
+{
+    Effect_OutOfCellar  = 0,
+    Effect_InCellar     = Effect_OutOfCellar + FadeSeqLength,
+    Effect_Dark         = Effect_InCellar + FadeSeqLength,
+    Effect_Death        = Effect_Dark + FadeSeqLength,
+    Effect_Flash        = Effect_Death + FadeSeqLength,
+    Effect_Level        = Effect_Flash + 2,
+    Effect_Count        = Effect_Level + 2,
+};
+
 enum
 {
     Cave_Items      = 0x79,
@@ -158,6 +173,15 @@ const int DoorHoleCoordV = 0x78;
 
 const int UWBombRadius = 32;
 
+// Tiles inside these rows and columns use a room's inner palette.
+const int InnerFirstRow = 4;
+const int InnerLastRow  = 18;
+const int InnerFirstCol = 4;
+const int InnerLastCol  = 28;
+
+static_assert( World::Columns <= TileGrid_Size && World::Rows <= TileGrid_Size,
+    "Tile maps have to fit in a tile grid." );
+
 static const uint8_t levelGroups[] = 
 {
     0, 0, 1, 1, 0, 1, 0, 1, 2
@@ -495,7 +519,8 @@ WorldImpl::UpdateFunc WorldImpl::sEnterFuncs[EnterState::MaxSubstate] =
     &WorldImpl::UpdateEnter_WalkCave,
 };
 
-static WorldImpl* sWorld;
+// The world that the World statics act on. Each thread can run its own.
+static thread_local WorldImpl* sWorld;
 
 
 void GetWorldCoord( int roomId, int& row, int& col )
@@ -577,13 +602,12 @@ int GetDoorStateFace( int type, bool state )
 
 void ClearScreen()
 {
-    al_clear_to_color( al_map_rgb( 0, 0, 0 ) );
+    Graphics::Clear();
 }
 
 void ClearScreen( int sysColor )
 {
-    ALLEGRO_COLOR color = Graphics::GetSystemColor( sysColor );
-    al_clear_to_color( color );
+    Graphics::Clear( sysColor );
 }
 
 void WorldImpl::ClearDeadObjectQueue()
@@ -754,22 +778,17 @@ void WorldImpl::SetPlayerColor()
     Graphics::SetColorIndexed( PlayerPalette, 1, sysColors[value] );
 }
 
-static void SetFlashPalette()
+static const uint8_t flashPalette[] = 
 {
-    static const uint8_t palette[] = 
-    {
-        0x0F,
-        0x30,
-        0x30,
-        0x30
-    };
-
-    for ( int i = 2; i < BackgroundPalCount; i++ )
-    {
-        Graphics::SetPaletteIndexed( i, palette );
-    }
+    0x0F,
+    0x30,
+    0x30,
+    0x30
+};
 
-    Graphics::UpdatePalettes();
+static void SetFlashPalette()
+{
+    Graphics::SetEffectPalettes( 2, Effect_Flash, BackgroundPalCount - 2 );
 }
 
 static void SetLevelPalettes( const uint8_t palettes[2][PaletteLength] )
@@ -784,14 +803,36 @@ static void SetLevelPalettes( const uint8_t palettes[2][PaletteLength] )
 
 static void SetLevelPalette()
 {
-    const World::LevelInfoBlock* infoBlock = World::GetLevelInfo();
+    Graphics::SetEffectPalettes( 2, Effect_Level, BackgroundPalCount - 2 );
+}
+
+static void SetFadePalettes( int effect, int step )
+{
+    const int fadePals = World::LevelInfoBlock::FadePals;
+
+    Graphics::SetEffectPalettes( 2, effect + step * fadePals, fadePals );
+}
+
+// The palettes that fades and flashes change to are known once a level is
+// loaded. They're kept in the graphics context, so that switching to them
+// doesn't take uploading palettes.
+
+static void LoadEffectPalettes( const World::LevelInfoBlock* infoBlock )
+{
+    uint8_t effects[Effect_Count][PaletteLength];
+
+    memcpy( effects[Effect_OutOfCellar], infoBlock->OutOfCellarPaletteSeq, FadeSeqLength * PaletteLength );
+    memcpy( effects[Effect_InCellar], infoBlock->InCellarPaletteSeq, FadeSeqLength * PaletteLength );
+    memcpy( effects[Effect_Dark], infoBlock->DarkPaletteSeq, FadeSeqLength * PaletteLength );
+    memcpy( effects[Effect_Death], infoBlock->DeathPaletteSeq, FadeSeqLength * PaletteLength );
 
     for ( int i = 2; i < BackgroundPalCount; i++ )
     {
-        Graphics::SetPaletteIndexed( i, infoBlock->Palettes[i] );
+        memcpy( effects[Effect_Flash + i - 2], flashPalette, PaletteLength );
+        memcpy( effects[Effect_Level + i - 2], infoBlock->Palettes[i], PaletteLength );
     }
 
-    Graphics::UpdatePalettes();
+    Graphics::LoadEffectPalettes( effects, Effect_Count );
 }
 
 static void SetLevelFgPalette()
@@ -805,8 +846,15 @@ WorldImpl::WorldImpl()
     :   curRoomId( 0 ),
         curTileMapIndex( 0 ),
         loadMobFunc( nullptr ),
+        wallsBmp( nullptr ),
+        doorsBmp( nullptr ),
         lastMode( Mode_Demo ),
         curMode( Mode_Play ),
+        credits( nullptr ),
+        textBox1( nullptr ),
+        textBox2( nullptr ),
+        gameMenu( nullptr ),
+        nextGameMenu( nullptr ),
         curColorSeqNum( 0 ),
         darkRoomFadeStep( 0 ),
         curMazeStep( 0 ),
@@ -815,31 +863,30 @@ WorldImpl::WorldImpl()
         tempShutterDoorDir( 0 ),
         tempShuttersRoomId( 0 ),
         tempShutters( false ),
-        wallsBmp( nullptr ),
-        doorsBmp( nullptr ),
+        prevRoomWasCellar(),
+        savedOWRoomId(),
         edgeX( 0 ),
         edgeY( 0x40 ),
+        nextRoomHistorySlot( 0 ),
+        roomObjCount(),
+        roomObjId(),
         worldKillCycle( 0 ),
         worldKillCount( 0 ),
+        helpDropCounter( 0 ),
+        helpDropValue( 0 ),
         roomKillCount( 0 ),
         roomAllDead( false ),
         madeRoomItem( false ),
         enablePersonFireballs( false ),
-        nextRoomHistorySlot( 0 ),
-        helpDropCounter( 0 ),
-        helpDropValue( 0 ),
+        swordBlocked( false ),
         whirlwindTeleporting( 0 ),
         teleportingRoomIndex( 0 ),
-        swordBlocked( false ),
         pause( 0 ),
         submenu( 0 ),
         submenuOffsetY( 0 ),
         statusBarVisible( false ),
-        textBox1( nullptr ),
-        textBox2( nullptr ),
-        credits( nullptr ),
-        gameMenu( nullptr ),
-        nextGameMenu( nullptr ),
+        levelKillCounts(),
+        roomHistory(),
 
         player(),
         giveFakePlayerPos(),
@@ -854,6 +901,7 @@ WorldImpl::WorldImpl()
         longTimer(),
         stunTimers(),
         placeholderTypes(),
+        nextObjectId(),
 
         doorwayDir(),
         triggeredDoorCmd(),
@@ -871,8 +919,19 @@ WorldImpl::WorldImpl()
         profile(),
         curUWBlockFlags(),
         ghostCount(),
-        armosCount()
+        armosCount(),
+        roomMonsterData(),
+        frameCounter( 0 ),
+        graphicsContext( Graphics::CreateContext() ),
+        soundContext( Sound::CreateContext() ),
+        inputContext( Input::CreateContext() ),
+        mapCaches( new MapCache[_countof( tileMaps )]() )
 {
+    // Modes share the state union. Start it with known bytes, so that
+    // whatever one mode leaves behind for the next is the same every run.
+    memset( &state, 0, sizeof state );
+
+    random.Seed( Util::Random::DefaultSeed );
 }
 
 WorldImpl::~WorldImpl()
@@ -882,17 +941,22 @@ WorldImpl::~WorldImpl()
 
     DeleteObjects();
 
-    if ( wallsBmp != nullptr )
-    {
-        al_destroy_bitmap( wallsBmp );
-        wallsBmp = nullptr;
-    }
+    delete credits;
+    delete textBox1;
+    delete textBox2;
+    delete gameMenu;
+    delete nextGameMenu;
 
-    if ( doorsBmp != nullptr )
+    Graphics::DestroyContext( graphicsContext );
+    Sound::DestroyContext( soundContext );
+    Input::DestroyContext( inputContext );
+
+    for ( int i = 0; i < _countof( tileMaps ); i++ )
     {
-        al_destroy_bitmap( doorsBmp );
-        doorsBmp = nullptr;
+        Graphics::DestroyTileGrid( mapCaches[i].grid );
+        Graphics::DestroyLayer( mapCaches[i].layer );
     }
+    delete [] mapCaches;
 }
 
 void WorldImpl::LoadOpenRoomContext()
@@ -925,7 +989,7 @@ void WorldImpl::LoadMapResourcesFromDirectory( int uniqueRoomCount )
 {
     Util::LoadList( directory.RoomCols, roomCols, uniqueRoomCount );
 
-    Util::LoadResource( directory.ColTables, &colTables );
+    Util::LoadSharedResource( directory.ColTables, &colTables );
 
     Util::LoadList( directory.TileAttrs, tileAttrs, tileTypeCount );
 
@@ -936,8 +1000,8 @@ void WorldImpl::LoadOverworldContext()
 {
     LoadOpenRoomContext();
     LoadMapResourcesFromDirectory( 124 );
-    Util::LoadResource( "owPrimaryMobs.list", &primaryMobs );
-    Util::LoadResource( "owSecondaryMobs.list", &secondaryMobs );
+    Util::LoadSharedResource( "owPrimaryMobs.list", &primaryMobs );
+    Util::LoadSharedResource( "owSecondaryMobs.list", &secondaryMobs );
     Util::LoadList( "owTileBehaviors.dat", tileBehaviors, TileTypes );
 }
 
@@ -945,7 +1009,7 @@ void WorldImpl::LoadUnderworldContext()
 {
     LoadClosedRoomContext();
     LoadMapResourcesFromDirectory( 64 );
-    Util::LoadResource( "uwPrimaryMobs.list", &primaryMobs );
+    Util::LoadSharedResource( "uwPrimaryMobs.list", &primaryMobs );
     Util::LoadList( "uwTileBehaviors.dat", tileBehaviors, TileTypes );
 }
 
@@ -955,14 +1019,14 @@ void WorldImpl::LoadCellarContext()
 
     Util::LoadList( "underworldCellarRoomCols.dat", roomCols, 2 );
 
-    Util::LoadResource( "underworldCellarCols.tab", &colTables );
+    Util::LoadSharedResource( "underworldCellarCols.tab", &colTables );
 
     Util::LoadList( "underworldCellarTileAttrs.dat", tileAttrs, tileTypeCount );
 
     Graphics::LoadTileSheet( Sheet_Background, "underworldTiles.png" );
 
-    Util::LoadResource( "uwCellarPrimaryMobs.list", &primaryMobs );
-    Util::LoadResource( "uwCellarSecondaryMobs.list", &secondaryMobs );
+    Util::LoadSharedResource( "uwCellarPrimaryMobs.list", &primaryMobs );
+    Util::LoadSharedResource( "uwCellarSecondaryMobs.list", &secondaryMobs );
     Util::LoadList( "uwTileBehaviors.dat", tileBehaviors, TileTypes );
 }
 
@@ -977,18 +1041,10 @@ void WorldImpl::LoadLevel( int level )
     Util::BlobResLoader<LevelInfoBlock, 1> infoBlockLoader( &infoBlock );
 
     Util::LoadResource( directory.LevelInfoBlock, &infoBlockLoader );
+    LoadEffectPalettes( &infoBlock );
 
-    if ( wallsBmp != nullptr )
-    {
-        al_destroy_bitmap( wallsBmp );
-        wallsBmp = nullptr;
-    }
-
-    if ( doorsBmp != nullptr )
-    {
-        al_destroy_bitmap( doorsBmp );
-        doorsBmp = nullptr;
-    }
+    wallsBmp = nullptr;
+    doorsBmp = nullptr;
 
     tempShutterRoomId = 0;
     tempShutterDoorDir = 0;
@@ -1008,8 +1064,8 @@ void WorldImpl::LoadLevel( int level )
     else
     {
         LoadUnderworldContext();
-        wallsBmp = al_load_bitmap( directory.Extra2 );
-        doorsBmp = al_load_bitmap( directory.Extra3 );
+        wallsBmp = Graphics::LoadSharedBitmap( directory.Extra2 );
+        doorsBmp = Graphics::LoadSharedBitmap( directory.Extra3 );
         if ( level < 7 )
             curUWBlockFlags = profile.LevelFlags1;
         else
@@ -1030,11 +1086,11 @@ void WorldImpl::LoadLevel( int level )
 
     Util::LoadList( directory.RoomAttrs, roomAttrs, Rooms );
 
-    Util::LoadResource( directory.LevelInfoEx, &extraData );
+    Util::LoadSharedResource( directory.LevelInfoEx, &extraData );
 
-    Util::LoadResource( directory.ObjLists, &objLists );
+    Util::LoadSharedResource( directory.ObjLists, &objLists );
 
-    Util::LoadResource( directory.Extra1, &sparseRoomAttrs );
+    Util::LoadSharedResource( directory.Extra1, &sparseRoomAttrs );
 
     Direction facing = Dir_Up;
 
@@ -1061,6 +1117,38 @@ void WorldImpl::LoadLevel( int level )
             roomAttrs[roomId] = sparseAttr[i].attrs;
         }
     }
+
+    MakeMapDoors( level );
+}
+
+// Door types only change with the level, so they're looked up once, instead
+// of each time the map is drawn.
+
+void WorldImpl::MakeMapDoors( int level )
+{
+    memset( mapOpenDoors, 0, sizeof mapOpenDoors );
+    memset( mapOpenableDoors, 0, sizeof mapOpenableDoors );
+
+    if ( level == 0 )
+        return;
+
+    for ( int roomId = 0; roomId < Rooms; roomId++ )
+    {
+        UWRoomAttrs& uwRoomAttrs = (UWRoomAttrs&) roomAttrs[roomId];
+
+        for ( int doorBit = 8; doorBit != 0; doorBit >>= 1 )
+        {
+            int dirOrd = Util::GetDirectionOrd( (Direction) doorBit );
+            DoorType doorType = (DoorType) uwRoomAttrs.GetDoor( dirOrd );
+
+            if ( doorType == DoorType_Open )
+                mapOpenDoors[roomId] |= doorBit;
+            else if ( doorType == DoorType_Bombable 
+                ||    doorType == DoorType_Key 
+                ||    doorType == DoorType_Key2 )
+                mapOpenableDoors[roomId] |= doorBit;
+        }
+    }
 }
 
 void WorldImpl::Init()
@@ -1072,7 +1160,7 @@ void WorldImpl::Init()
     Graphics::LoadTileSheet( Sheet_Font, "font.png" );
     Graphics::LoadTileSheet( Sheet_PlayerAndItems, "playerItem.png", "playerItemsSheet.tab" );
 
-    Util::LoadResource( "text.tab", &textTable );
+    Util::LoadSharedResource( "text.tab", &textTable );
 
     GotoFileMenu();
 }
@@ -1088,6 +1176,8 @@ void WorldImpl::Start( int slot, const Profile& profile )
 
 void WorldImpl::Update()
 {
+    frameCounter++;
+
     GameMode mode = GetMode();
 
     if ( lastMode != mode )
@@ -1118,11 +1208,17 @@ void WorldImpl::Update()
 
 void WorldImpl::Draw()
 {
+    // The whole frame is recorded, so that it can be batched, and skipped
+    // if it's the same as the last one.
+    Graphics::Begin();
+
     if ( statusBarVisible )
         statusBar.Draw( submenuOffsetY );
 
     DrawFunc draw = sDrawFuncs[curMode];
     (this->*draw)();
+
+    Graphics::End();
 }
 
 void WorldImpl::DrawRoom()
@@ -1458,6 +1554,27 @@ Object* World::GetObject( int slot )
     return sWorld->objects[slot];
 }
 
+Object* World::GetObjectById( uint32_t id )
+{
+    if ( sWorld->player != nullptr && sWorld->player->GetId() == id )
+        return sWorld->player;
+
+    for ( int i = 0; i < MaxObjects; i++ )
+    {
+        Object* obj = sWorld->objects[i];
+        if ( obj != nullptr && obj->GetId() == id )
+            return obj;
+    }
+
+    return nullptr;
+}
+
+uint32_t World::MakeObjectId()
+{
+    // Zero is left for null references.
+    return ++sWorld->nextObjectId;
+}
+
 void World::SetObject( int slot, Object* obj )
 {
     sWorld->SetOnlyObject( slot, obj );
@@ -1855,13 +1972,31 @@ void WorldImpl::ShowShortcutStairs( int roomId, int tileMapIndex )
     SetMob( row * 2, col * 2, Mob_Stairs );
 }
 
-void WorldImpl::DrawMap( int roomId, int mapIndex, int offsetX, int offsetY )
+static void DrawMapLayer( 
+    Graphics::Layer* layer, 
+    int firstRow, 
+    int lastRow, 
+    int firstCol, 
+    int lastCol, 
+    int offsetX, 
+    int offsetY, 
+    int palette )
 {
-    Graphics::Begin();
+    if ( firstRow >= lastRow || firstCol >= lastCol )
+        return;
 
+    Graphics::DrawLayer( 
+        layer, 
+        firstCol * World::TileWidth, firstRow * World::TileHeight, 
+        (lastCol - firstCol) * World::TileWidth, (lastRow - firstRow) * World::TileHeight, 
+        offsetX + firstCol * World::TileWidth, offsetY + firstRow * World::TileHeight, 
+        palette );
+}
+
+void WorldImpl::DrawMap( int roomId, int mapIndex, int offsetX, int offsetY )
+{
     int outerPalette = roomAttrs[roomId].GetOuterPalette();
     int innerPalette = roomAttrs[roomId].GetInnerPalette();
-    TileMap*    map = &tileMaps[mapIndex];
 
     if ( IsUWCellar( roomId ) 
         || IsPlayingCave() )
@@ -1870,18 +2005,17 @@ void WorldImpl::DrawMap( int roomId, int mapIndex, int offsetX, int offsetY )
         innerPalette = 2;
     }
 
+    // Rows and columns are drawn at offsetX and offsetY from where they'd
+    // be otherwise. Only the ones that can be seen are drawn.
     int firstRow = 0;
     int lastRow = Rows;
-    int tileOffsetY = offsetY;
 
     int firstCol = 0;
     int lastCol = Columns;
-    int tileOffsetX = offsetX;
 
     if ( offsetY < 0 )
     {
         firstRow = -offsetY / TileHeight;
-        tileOffsetY = -(-offsetY % TileHeight);
     }
     else if ( offsetY > 0 )
     {
@@ -1890,17 +2024,16 @@ void WorldImpl::DrawMap( int roomId, int mapIndex, int offsetX, int offsetY )
     else if ( offsetX < 0 )
     {
         firstCol = -offsetX / TileWidth;
-        tileOffsetX = -(-offsetX % TileWidth);
     }
     else if ( offsetX > 0 )
     {
         lastCol = Columns - offsetX / TileWidth;
     }
 
-    int endCol = startCol + colCount;
-    int endRow = startRow + rowCount;
-
-    int y = TileMapBaseY + tileOffsetY;
+    firstRow = Util::Max( firstRow, startRow );
+    lastRow = Util::Min( lastRow, startRow + rowCount );
+    firstCol = Util::Max( firstCol, startCol );
+    lastCol = Util::Min( lastCol, startCol + colCount );
 
     if ( IsUWMain( roomId ) )
     {
@@ -1912,24 +2045,83 @@ void WorldImpl::DrawMap( int roomId, int mapIndex, int offsetX, int offsetY )
             outerPalette, 0 );
     }
 
-    for ( int r = firstRow; r < lastRow; r++, y += TileHeight )
+    if ( !UpdateMapCache( mapIndex, outerPalette, innerPalette ) )
     {
-        if ( r < startRow || r >= endRow )
-            continue;
+        DrawMapTiles( 
+            mapIndex, 
+            firstRow, lastRow, 
+            firstCol, lastCol, 
+            offsetX, TileMapBaseY + offsetY, 
+            outerPalette, innerPalette );
+    }
+    else if ( mapCaches[mapIndex].grid != nullptr )
+    {
+        if ( firstRow < lastRow && firstCol < lastCol )
+        {
+            Graphics::DrawTileGrid( 
+                mapCaches[mapIndex].grid, 
+                Sheet_Background, 
+                firstCol, firstRow, 
+                lastCol - firstCol, lastRow - firstRow, 
+                offsetX + firstCol * TileWidth, TileMapBaseY + offsetY + firstRow * TileHeight );
+        }
+    }
+    else
+    {
+        Graphics::Layer* layer = mapCaches[mapIndex].layer;
+        int baseY = TileMapBaseY + offsetY;
+
+        if ( outerPalette == innerPalette )
+        {
+            DrawMapLayer( layer, firstRow, lastRow, firstCol, lastCol, offsetX, baseY, outerPalette );
+        }
+        else
+        {
+            // The inner palette is used inside the margins. The pieces
+            // mustn't overlap, because the tiles have transparent pixels.
+            int innerFirstRow = Util::Min( Util::Max( firstRow, InnerFirstRow ), lastRow );
+            int innerLastRow = Util::Max( Util::Min( lastRow, InnerLastRow ), innerFirstRow );
+            int innerFirstCol = Util::Min( Util::Max( firstCol, InnerFirstCol ), lastCol );
+            int innerLastCol = Util::Max( Util::Min( lastCol, InnerLastCol ), innerFirstCol );
 
-        int x = tileOffsetX;
+            DrawMapLayer( layer, firstRow, innerFirstRow, firstCol, lastCol, offsetX, baseY, outerPalette );
+            DrawMapLayer( layer, innerLastRow, lastRow, firstCol, lastCol, offsetX, baseY, outerPalette );
+            DrawMapLayer( layer, innerFirstRow, innerLastRow, firstCol, innerFirstCol, offsetX, baseY, outerPalette );
+            DrawMapLayer( layer, innerFirstRow, innerLastRow, innerLastCol, lastCol, offsetX, baseY, outerPalette );
+            DrawMapLayer( layer, innerFirstRow, innerLastRow, innerFirstCol, innerLastCol, offsetX, baseY, innerPalette );
+        }
+    }
+
+    if ( IsUWMain( roomId ) )
+        DrawDoors( roomId, false, offsetX, offsetY );
+}
+
+void WorldImpl::DrawMapTiles( 
+    int mapIndex, 
+    int firstRow, 
+    int lastRow, 
+    int firstCol, 
+    int lastCol, 
+    int offsetX, 
+    int offsetY, 
+    int outerPalette, 
+    int innerPalette )
+{
+    TileMap*    map = &tileMaps[mapIndex];
+    int y = offsetY + firstRow * TileHeight;
+
+    for ( int r = firstRow; r < lastRow; r++, y += TileHeight )
+    {
+        int x = offsetX + firstCol * TileWidth;
 
         for ( int c = firstCol; c < lastCol; c++, x += TileWidth )
         {
-            if ( c < startCol || c >= endCol )
-                continue;
-
             int tileRef = map->tileRefs[r][c];
             int srcX = (tileRef & 0x0F) * TileWidth;
             int srcY = ((tileRef & 0xF0) >> 4) * TileHeight;
             int palette;
 
-            if ( r < 4 || r >= 18 || c < 4 || c >= 28 )
+            if ( r < InnerFirstRow || r >= InnerLastRow || c < InnerFirstCol || c >= InnerLastCol )
                 palette = outerPalette;
             else
                 palette = innerPalette;
@@ -1942,11 +2134,83 @@ void WorldImpl::DrawMap( int roomId, int mapIndex, int offsetX, int offsetY )
                 palette, 0 );
         }
     }
+}
 
-    if ( IsUWMain( roomId ) )
-        DrawDoors( roomId, false, offsetX, offsetY );
+// A tile grid lets the GPU draw the map in one quad. Otherwise, the map is
+// drawn into a layer, which is drawn in a few pieces. Either is made again
+// only if the background sheet, the tiles, or the palettes changed.
 
-    Graphics::End();
+bool WorldImpl::UpdateMapCache( int mapIndex, int outerPalette, int innerPalette )
+{
+    MapCache& cache = mapCaches[mapIndex];
+    TileMap* map = &tileMaps[mapIndex];
+    ALLEGRO_BITMAP* sheet = Graphics::GetTileSheet( Sheet_Background );
+
+    if ( cache.grid == nullptr && cache.layer == nullptr )
+    {
+        cache.grid = Graphics::CreateTileGrid();
+        if ( cache.grid == nullptr )
+            cache.layer = Graphics::CreateLayer( TileMapWidth, TileMapHeight );
+        if ( cache.grid == nullptr && cache.layer == nullptr )
+            return false;
+    }
+
+    if ( cache.valid
+        && cache.sheet == sheet
+        && cache.outerPalette == outerPalette
+        && cache.innerPalette == innerPalette
+        && cache.startRow == startRow
+        && cache.rowCount == rowCount
+        && cache.startCol == startCol
+        && cache.colCount == colCount
+        && 0 == memcmp( cache.tileRefs, map->tileRefs, sizeof cache.tileRefs ) )
+    {
+        return true;
+    }
+
+    if ( cache.grid != nullptr )
+    {
+        uint8_t palettes[Rows][Columns];
+
+        for ( int r = 0; r < Rows; r++ )
+        {
+            for ( int c = 0; c < Columns; c++ )
+            {
+                if ( r < startRow || r >= startRow + rowCount || c < startCol || c >= startCol + colCount )
+                    palettes[r][c] = TileGrid_Empty;
+                else if ( r < InnerFirstRow || r >= InnerLastRow || c < InnerFirstCol || c >= InnerLastCol )
+                    palettes[r][c] = outerPalette;
+                else
+                    palettes[r][c] = innerPalette;
+            }
+        }
+
+        Graphics::SetTileGrid( cache.grid, &map->tileRefs[0][0], &palettes[0][0], Columns, Rows );
+    }
+    else
+    {
+        // Layers keep color indexes, so the palettes don't matter here.
+        Graphics::BeginLayer( cache.layer );
+        DrawMapTiles( 
+            mapIndex, 
+            startRow, startRow + rowCount, 
+            startCol, startCol + colCount, 
+            0, 0, 
+            0, 0 );
+        Graphics::EndLayer();
+    }
+
+    cache.valid = true;
+    cache.sheet = sheet;
+    cache.outerPalette = outerPalette;
+    cache.innerPalette = innerPalette;
+    cache.startRow = startRow;
+    cache.rowCount = rowCount;
+    cache.startCol = startCol;
+    cache.colCount = colCount;
+    memcpy( cache.tileRefs, map->tileRefs, sizeof cache.tileRefs );
+
+    return true;
 }
 
 void WorldImpl::DrawDoors( int roomId, bool above, int offsetX, int offsetY )
@@ -2193,6 +2457,21 @@ UWRoomFlags& World::GetUWRoomFlags( int curRoomId )
     return sWorld->curUWBlockFlags[curRoomId];
 }
 
+int World::GetMapDoors( int roomId )
+{
+    UWRoomFlags& roomFlags = sWorld->curUWBlockFlags[roomId];
+    int doors = sWorld->mapOpenDoors[roomId];
+    int openable = sWorld->mapOpenableDoors[roomId];
+
+    for ( int doorBit = 8; doorBit != 0; doorBit >>= 1 )
+    {
+        if ( (openable & doorBit) != 0 && roomFlags.GetDoorState( doorBit ) )
+            doors |= doorBit;
+    }
+
+    return doors;
+}
+
 const World::LevelInfoBlock* World::GetLevelInfo()
 {
     return &sWorld->infoBlock;
@@ -2248,6 +2527,16 @@ Util::Array<uint8_t> World::GetShortcutRooms()
     return array;
 }
 
+RoomMonsterData& World::GetRoomMonsterData()
+{
+    return sWorld->roomMonsterData;
+}
+
+uint32_t GetFrameCounter()
+{
+    return sWorld->frameCounter;
+}
+
 void WorldImpl::TakeShortcut()
 {
     profile.OverworldFlags[curRoomId].SetShortcutState();
@@ -2425,10 +2714,7 @@ void WorldImpl::FadeIn()
         darkRoomFadeStep--;
         timer = 10;
 
-        for ( int i = 0; i < 2; i++ )
-        {
-            Graphics::SetPaletteIndexed( i + 2, infoBlock.DarkPaletteSeq[darkRoomFadeStep][i] );
-        }
+        SetFadePalettes( Effect_Dark, darkRoomFadeStep );
         Graphics::UpdatePalettes();
     }
 }
@@ -4293,10 +4579,7 @@ void WorldImpl::UpdateScroll_FadeOut()
 {
     if ( state.scroll.timer == 0 )
     {
-        for ( int i = 0; i < 2; i++ )
-        {
-            Graphics::SetPaletteIndexed( i + 2, infoBlock.DarkPaletteSeq[darkRoomFadeStep][i] );
-        }
+        SetFadePalettes( Effect_Dark, darkRoomFadeStep );
         Graphics::UpdatePalettes();
 
         darkRoomFadeStep++;
@@ -4645,10 +4928,7 @@ void WorldImpl::UpdateEnter_FadeIn()
             darkRoomFadeStep--;
             state.enter.timer = 9;
 
-            for ( int i = 0; i < 2; i++ )
-            {
-                Graphics::SetPaletteIndexed( i + 2, infoBlock.DarkPaletteSeq[darkRoomFadeStep][i] );
-            }
+            SetFadePalettes( Effect_Dark, darkRoomFadeStep );
             Graphics::UpdatePalettes();
         }
         else
@@ -5190,7 +5470,7 @@ void WorldImpl::UpdateWinGame_Credits()
 
 void WorldImpl::DrawWinGame()
 {
-    ALLEGRO_COLOR backColor;
+    int backSysColor;
 
     Graphics::SetClip( 0, 0, StdViewWidth, StdViewHeight );
     if ( state.winGame.substate == WinGameState::Colors )
@@ -5199,16 +5479,16 @@ void WorldImpl::DrawWinGame()
         int frame = state.winGame.timer & 3;
         int sysColor = sysColors[frame];
         ClearScreen( sysColor );
-        backColor = Graphics::GetSystemColor( sysColor );
+        backSysColor = sysColor;
     }
     else
     {
         ClearScreen();
-        backColor = al_map_rgb( 0, 0, 0 );
+        backSysColor = StatusBar::BlackBackground;
     }
     Graphics::ResetClip();
 
-    statusBar.Draw( submenuOffsetY, backColor );
+    statusBar.Draw( submenuOffsetY, backSysColor );
 
     if ( state.winGame.substate == WinGameState::Start )
     {
@@ -5350,11 +5630,7 @@ void WorldImpl::UpdatePlayCellar_FadeOut()
 {
     if ( state.playCellar.fadeTimer == 0 )
     {
-        for ( int i = 0; i < LevelInfoBlock::FadePals; i++ )
-        {
-            int step = state.playCellar.fadeStep;
-            Graphics::SetPaletteIndexed( i + 2, infoBlock.OutOfCellarPaletteSeq[step][i] );
-        }
+        SetFadePalettes( Effect_OutOfCellar, state.playCellar.fadeStep );
         Graphics::UpdatePalettes();
         state.playCellar.fadeTimer = 9;
         state.playCellar.fadeStep++;
@@ -5398,11 +5674,7 @@ void WorldImpl::UpdatePlayCellar_FadeIn()
 {
     if ( state.playCellar.fadeTimer == 0 )
     {
-        for ( int i = 0; i < LevelInfoBlock::FadePals; i++ )
-        {
-            int step = state.playCellar.fadeStep;
-            Graphics::SetPaletteIndexed( i + 2, infoBlock.InCellarPaletteSeq[step][i] );
-        }
+        SetFadePalettes( Effect_InCellar, state.playCellar.fadeStep );
         Graphics::UpdatePalettes();
         state.playCellar.fadeTimer = 9;
         state.playCellar.fadeStep--;
@@ -5471,11 +5743,7 @@ void WorldImpl::UpdateLeaveCellar_FadeOut()
 {
     if ( state.leaveCellar.fadeTimer == 0 )
     {
-        for ( int i = 0; i < LevelInfoBlock::FadePals; i++ )
-        {
-            int step = state.leaveCellar.fadeStep;
-            Graphics::SetPaletteIndexed( i + 2, infoBlock.InCellarPaletteSeq[step][i] );
-        }
+        SetFadePalettes( Effect_InCellar, state.leaveCellar.fadeStep );
         Graphics::UpdatePalettes();
         state.leaveCellar.fadeTimer = 9;
         state.leaveCellar.fadeStep++;
@@ -5514,11 +5782,7 @@ void WorldImpl::UpdateLeaveCellar_FadeIn()
 {
     if ( state.leaveCellar.fadeTimer == 0 )
     {
-        for ( int i = 0; i < LevelInfoBlock::FadePals; i++ )
-        {
-            int step = state.leaveCellar.fadeStep;
-            Graphics::SetPaletteIndexed( i + 2, infoBlock.OutOfCellarPaletteSeq[step][i] );
-        }
+        SetFadePalettes( Effect_OutOfCellar, state.leaveCellar.fadeStep );
         Graphics::UpdatePalettes();
         state.leaveCellar.fadeTimer = 9;
         state.leaveCellar.fadeStep--;
@@ -5763,7 +6027,8 @@ void WorldImpl::UpdateDie_Fade()
 
             int seq = 3 - state.death.step;
 
-            SetLevelPalettes( infoBlock.DeathPaletteSeq[seq] );
+            SetFadePalettes( Effect_Death, seq );
+            Graphics::UpdatePalettes();
         }
     }
 }
@@ -6291,14 +6556,66 @@ World::World()
 
 void World::Init()
 {
-    sWorld = new WorldImpl();
-    sWorld->Init();
+    Create();
 }
 
 void World::Uninit()
 {
-    delete sWorld;
-    sWorld = nullptr;
+    Destroy( sWorld );
+}
+
+WorldImpl* World::Create()
+{
+    WorldImpl* world = new WorldImpl();
+
+    MakeCurrent( world );
+    world->Init();
+
+    return world;
+}
+
+void World::Destroy( WorldImpl* world )
+{
+    if ( world == nullptr )
+        return;
+
+    WorldImpl* prevWorld = sWorld;
+
+    // Objects reach the world through the statics as they're deleted.
+    MakeCurrent( world );
+    delete world;
+
+    MakeCurrent( prevWorld == world ? nullptr : prevWorld );
+}
+
+void World::MakeCurrent( WorldImpl* world )
+{
+    sWorld = world;
+
+    if ( world != nullptr )
+    {
+        Graphics::SetContext( world->graphicsContext );
+        Sound::SetContext( world->soundContext );
+        Input::SetContext( world->inputContext );
+        Util::SetRandom( &world->random );
+    }
+    else
+    {
+        Graphics::SetContext( nullptr );
+        Sound::SetContext( nullptr );
+        Input::SetContext( nullptr );
+        Util::SetRandom( nullptr );
+    }
+}
+
+WorldImpl* World::GetCurrent()
+{
+    return sWorld;
+}
+
+void World::SetRandomSeed( uint64_t seed )
+{
+    sWorld->random.Seed( seed );
 }
 
 void World::Start( int slot, const Profile& profile )
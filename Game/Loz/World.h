@@ -163,6 +163,11 @@ struct TileCollision
 };
 
 
+class WorldImpl;
+class WorldSnapshot;
+struct RoomMonsterData;
+
+
 class World
 {
 public:
@@ -226,6 +231,31 @@ public:
     static void Uninit();
     static void Start( int slot, const Profile& profile );
 
+    static WorldImpl* Create();
+    static void Destroy( WorldImpl* world );
+    static void MakeCurrent( WorldImpl* world );
+    static WorldImpl* GetCurrent();
+    static void SetRandomSeed( uint64_t seed );
+
+    // A snapshot holds the whole state of a world. Saving and loading it
+    // only copies memory, so it can be done often. A snapshot can be loaded
+    // into any world in the same process.
+    static WorldSnapshot* CreateSnapshot();
+    static void DestroySnapshot( WorldSnapshot* snapshot );
+    static void SaveSnapshot( WorldSnapshot* snapshot );
+    static void LoadSnapshot( const WorldSnapshot* snapshot );
+    // The flat part of a snapshot. Menus aren't in it, so setting a snapshot
+    // from data only restores a world that isn't showing the file menus.
+    static const uint8_t* GetSnapshotData( const WorldSnapshot* snapshot, size_t& size );
+    static void SetSnapshotData( WorldSnapshot* snapshot, const uint8_t* data, size_t size );
+
+    // Hashes the state that decides how the game plays out, leaving out
+    // pointers and anything only used to draw. Equal worlds give equal hashes
+    // on any run of the same build. Some state, like the mode state union,
+    // is hashed as raw bytes, padding included. So hash logs only compare
+    // between builds with the same struct layouts.
+    static uint64_t HashState();
+
     static void Update();
     static void Draw();
 
@@ -264,6 +294,8 @@ public:
     static int GetInnerPalette();
     static Cell GetRandomWaterTile();
     static Object* GetObject( int slot );
+    static Object* GetObjectById( uint32_t id );
+    static uint32_t MakeObjectId();
     static void SetObject( int slot, Object* obj );
     static int FindEmptyMonsterSlot();
     static int FindEmptyFireSlot();
@@ -320,6 +352,8 @@ public:
     static bool GetEffectiveDoorState( int doorDir );
     static bool GetEffectiveDoorState( int roomId, int doorDir );
     static UWRoomFlags& GetUWRoomFlags( int curRoomId );
+    // The doors that the submenu map shows for a room of the current level.
+    static int GetMapDoors( int roomId );
 
     static const LevelInfoBlock* GetLevelInfo();
     static bool IsUWMain( int roomId );
@@ -351,4 +385,5 @@ public:
     static bool HasLivingObjects();
     static void EnablePersonFireballs();
     static Util::Array<uint8_t> GetShortcutRooms();
+    static RoomMonsterData& GetRoomMonsterData();
 };
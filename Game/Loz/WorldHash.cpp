@@ -0,0 +1,137 @@
+/*
+   Copyright 2017 Aldo J. Nunez
+
+   Licensed under the Apache License, Version 2.0.
+   See the LICENSE text file for details.
+*/
+
+#include "Common.h"
+#include "World.h"
+#include "WorldImpl.h"
+#include "Object.h"
+#include "Player.h"
+#include "StateHash.h"
+
+
+// Fields are added one by one instead of hashing the WorldImpl's bytes. The
+// bytes hold pointers and padding, which differ from run to run. Plain
+// structs with no padding are added whole.
+
+static void HashProfile( StateHash& hash, const Profile& profile )
+{
+    hash.AddValue( profile.NameLength );
+    hash.AddValue( profile.Name );
+    hash.AddValue( profile.Quest );
+    hash.AddValue( profile.Deaths );
+    hash.AddValue( profile.SelectedItem );
+    hash.AddValue( profile.Hearts );
+    hash.AddValue( profile.Items );
+    hash.AddValue( profile.OverworldFlags );
+    hash.AddValue( profile.LevelFlags1 );
+    hash.AddValue( profile.LevelFlags2 );
+}
+
+static void HashObject( StateHash& hash, Object* obj )
+{
+    uint8_t present = obj != nullptr ? 1 : 0;
+
+    hash.AddValue( present );
+
+    if ( obj != nullptr )
+        obj->HashState( hash );
+}
+
+uint64_t World::HashState()
+{
+    WorldImpl* world = GetCurrent();
+    StateHash hash;
+
+    assert( world != nullptr );
+
+    hash.AddValue( world->curMode );
+    hash.AddValue( world->lastMode );
+    hash.AddValue( world->curRoomId );
+    hash.AddValue( world->curTileMapIndex );
+    hash.AddValue( world->tileMaps );
+
+    // The union was zeroed when the world was made, so bytes that the
+    // current mode doesn't use are still the same every run. Its padding is
+    // hashed too, which ties the hash to this build's layout.
+    hash.AddValue( world->state );
+
+    hash.AddValue( world->curColorSeqNum );
+    hash.AddValue( world->darkRoomFadeStep );
+    hash.AddValue( world->curMazeStep );
+    hash.AddValue( world->spotIndex );
+    hash.AddValue( world->tempShutterRoomId );
+    hash.AddValue( world->tempShutterDoorDir );
+    hash.AddValue( world->tempShuttersRoomId );
+    hash.AddValue( world->tempShutters );
+    hash.AddValue( world->prevRoomWasCellar );
+    hash.AddValue( world->savedOWRoomId );
+    hash.AddValue( world->edgeX );
+    hash.AddValue( world->edgeY );
+    hash.AddValue( world->nextRoomHistorySlot );
+    hash.AddValue( world->roomObjCount );
+    hash.AddValue( world->roomObjId );
+    hash.AddValue( world->worldKillCycle );
+    hash.AddValue( world->worldKillCount );
+    hash.AddValue( world->helpDropCounter );
+    hash.AddValue( world->helpDropValue );
+    hash.AddValue( world->roomKillCount );
+    hash.AddValue( world->roomAllDead );
+    hash.AddValue( world->madeRoomItem );
+    hash.AddValue( world->enablePersonFireballs );
+    hash.AddValue( world->swordBlocked );
+    hash.AddValue( world->whirlwindTeleporting );
+    hash.AddValue( world->teleportingRoomIndex );
+    hash.AddValue( world->pause );
+    hash.AddValue( world->submenu );
+    hash.AddValue( world->submenuOffsetY );
+    hash.AddValue( world->statusBarVisible );
+    hash.AddValue( world->levelKillCounts );
+    hash.AddValue( world->roomHistory );
+
+    hash.AddValue( world->giveFakePlayerPos );
+    hash.AddValue( world->playerPosTimer );
+    hash.AddValue( world->fakePlayerPos );
+
+    HashObject( hash, world->player );
+
+    for ( int i = 0; i < MaxObjects; i++ )
+    {
+        HashObject( hash, world->objects[i] );
+    }
+
+    hash.AddValue( world->objectTimers );
+    hash.AddValue( world->curObjSlot );
+    hash.AddValue( world->longTimer );
+    hash.AddValue( world->stunTimers );
+    hash.AddValue( world->placeholderTypes );
+    hash.AddValue( world->nextObjectId );
+
+    hash.AddValue( world->doorwayDir );
+    hash.AddValue( world->triggeredDoorCmd );
+    hash.AddValue( world->triggeredDoorDir );
+    hash.AddValue( world->fromUnderground );
+    hash.AddValue( world->activeShots );
+    hash.AddValue( world->triggerShutters );
+    hash.AddValue( world->summonedWhirlwind );
+    hash.AddValue( world->powerTriforceFanfare );
+    hash.AddValue( world->recorderUsed );
+    hash.AddValue( world->candleUsed );
+    hash.AddValue( world->shuttersPassedDirs );
+    hash.AddValue( world->brightenRoom );
+    hash.AddValue( world->profileSlot );
+    HashProfile( hash, world->profile );
+    hash.AddValue( world->ghostCount );
+    hash.AddValue( world->armosCount );
+    hash.AddValue( world->ghostCells );
+    hash.AddValue( world->armosCells );
+    hash.AddValue( world->roomMonsterData );
+    hash.AddValue( world->frameCounter );
+    hash.AddValue( world->random.State );
+    hash.AddValue( world->random.Inc );
+
+    return hash.Finish();
+}
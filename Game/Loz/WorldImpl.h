@@ -8,7 +8,11 @@
 #pragma once
 
 #include "World.h"
+#include "Graphics.h"
+#include "Input.h"
+#include "Monsters.h"
 #include "Profile.h"
+#include "Sound.h"
 
 
 class WorldImpl : private World
@@ -22,6 +26,23 @@ public:
         TInteract_Cover,
     };
 
+    // A tile map uploaded to a tile grid, or else drawn into a layer, and
+    // what it was made from. It's made again only when one of those changes.
+    struct MapCache
+    {
+        Graphics::TileGrid* grid;
+        Graphics::Layer*    layer;
+        bool                valid;
+        ALLEGRO_BITMAP*     sheet;
+        int                 outerPalette;
+        int                 innerPalette;
+        int                 startRow;
+        int                 rowCount;
+        int                 startCol;
+        int                 colCount;
+        uint8_t             tileRefs[Rows][Columns];
+    };
+
 private:
     static const int Rooms = 128;
     static const int UniqueRooms = 124;
@@ -110,6 +131,11 @@ public:
     ColumnResTable  colTables;
     TileMap         tileMaps[2];
     RoomAttrs       roomAttrs[Rooms];
+    // The doors that the submenu map shows for each room of a level: those
+    // that are always open, and those that show once they've been opened.
+    // Made from the room attributes when the level is loaded.
+    uint8_t         mapOpenDoors[Rooms];
+    uint8_t         mapOpenableDoors[Rooms];
     int             curRoomId;
     int             curTileMapIndex;
     uint8_t         tileAttrs[MobTypes];
@@ -535,6 +561,7 @@ public:
     int     longTimer;
     int     stunTimers[MaxObjects];
     uint8_t placeholderTypes[MaxObjects];
+    uint32_t nextObjectId;
 
     Direction       doorwayDir;         // 53
     int             triggeredDoorCmd;   // 54
@@ -555,6 +582,15 @@ public:
     int             armosCount;
     MobPatchCells   ghostCells;
     MobPatchCells   armosCells;
+    RoomMonsterData roomMonsterData;
+    uint32_t        frameCounter;
+    Util::Random    random;
+
+    Graphics::Context*  graphicsContext;
+    Sound::Context*     soundContext;
+    Input::Context*     inputContext;
+    // One for each tile map. Like the contexts, they belong to the world.
+    MapCache*           mapCaches;
 
 public:
     WorldImpl();
@@ -639,6 +675,7 @@ private:
     const SparseRoomItem* FindSparseItem( int attrId, int roomId );
 
     void LoadLevel( int level );
+    void MakeMapDoors( int level );
     void LoadRoom( int roomId, int tileMapIndex );
     void LoadMap( int roomId, int tileMapIndex );
     void LoadLayout( int uniqueRoomId, int tileMapIndex, TileScheme tileScheme );
@@ -656,6 +693,17 @@ private:
 
     void DrawRoom();
     void DrawMap( int roomId, int mapIndex, int offsetX, int offsetY );
+    void DrawMapTiles( 
+        int mapIndex, 
+        int firstRow, 
+        int lastRow, 
+        int firstCol, 
+        int lastCol, 
+        int offsetX, 
+        int offsetY, 
+        int outerPalette, 
+        int innerPalette );
+    bool UpdateMapCache( int mapIndex, int outerPalette, int innerPalette );
     void DrawDoors( int roomId, bool above, int offsetX, int offsetY );
 
     int  GetNextTeleportingRoomIndex();
@@ -0,0 +1,344 @@
+/*
+   Copyright 2017 Aldo J. Nunez
+
+   Licensed under the Apache License, Version 2.0.
+   See the LICENSE text file for details.
+*/
+
+#include "Common.h"
+#include "World.h"
+#include "WorldImpl.h"
+#include "Credits.h"
+#include "Menu.h"
+#include "Player.h"
+#include "TextBox.h"
+
+
+// A snapshot is one flat buffer. It starts with a small header and a copy
+// of the WorldImpl. Then comes a record for each of the world's contexts,
+// and for every object and text box that the world owns.
+//
+// Copying memory works, because nothing that a world owns points to memory
+// that can go away. Resources and tile sheets are shared and kept for the
+// whole run. Objects refer to each other by ID. The only pointers into the
+// world itself are fixed up when loading.
+//
+// Menus only exist on the file screens, so they're cloned instead.
+
+enum SnapshotRecordType
+{
+    Record_GraphicsContext,
+    Record_SoundContext,
+    Record_InputContext,
+    Record_Object,
+    Record_Player,
+    Record_Credits,
+    Record_TextBox1,
+    Record_TextBox2,
+};
+
+struct SnapshotHeader
+{
+    int32_t     UWBlockFlagsOffset;
+    uint32_t    Reserved;
+};
+
+struct SnapshotRecord
+{
+    uint16_t    Type;
+    uint16_t    Slot;
+    uint32_t    Size;
+};
+
+const size_t SnapshotAlign = 8;
+const size_t SnapshotExtraCapacity = 8 * 1024;
+const size_t SnapshotWorldOffset = sizeof( SnapshotHeader );
+
+
+static size_t AlignSnapshotSize( size_t size )
+{
+    return (size + SnapshotAlign - 1) & ~(SnapshotAlign - 1);
+}
+
+static size_t GetFirstRecordOffset()
+{
+    return SnapshotWorldOffset + AlignSnapshotSize( sizeof( WorldImpl ) );
+}
+
+
+class WorldSnapshot
+{
+public:
+    uint8_t*            buffer;
+    size_t              capacity;
+    size_t              size;
+    Menu*               gameMenu;
+    Menu*               nextGameMenu;
+
+    WorldSnapshot();
+    ~WorldSnapshot();
+
+    void Reserve( size_t newSize );
+    void Append( SnapshotRecordType type, int slot, const void* data, size_t dataSize );
+};
+
+
+WorldSnapshot::WorldSnapshot()
+    :   buffer(),
+        capacity(),
+        size(),
+        gameMenu(),
+        nextGameMenu()
+{
+    Reserve( GetFirstRecordOffset() + SnapshotExtraCapacity );
+}
+
+WorldSnapshot::~WorldSnapshot()
+{
+    delete [] buffer;
+    delete gameMenu;
+    delete nextGameMenu;
+}
+
+void WorldSnapshot::Reserve( size_t newSize )
+{
+    if ( newSize <= capacity )
+        return;
+
+    size_t newCapacity = capacity * 2;
+    if ( newCapacity < newSize )
+        newCapacity = newSize;
+
+    uint8_t* newBuffer = new uint8_t[newCapacity];
+    if ( buffer != nullptr )
+    {
+        memcpy( newBuffer, buffer, size );
+        delete [] buffer;
+    }
+
+    buffer = newBuffer;
+    capacity = newCapacity;
+}
+
+void WorldSnapshot::Append( SnapshotRecordType type, int slot, const void* data, size_t dataSize )
+{
+    assert( slot >= 0 && slot <= UINT16_MAX );
+
+    size_t recordSize = sizeof( SnapshotRecord ) + AlignSnapshotSize( dataSize );
+
+    Reserve( size + recordSize );
+
+    SnapshotRecord* record = (SnapshotRecord*) (buffer + size);
+    record->Type = type;
+    record->Slot = slot;
+    record->Size = dataSize;
+    memcpy( record + 1, data, dataSize );
+
+    size += recordSize;
+}
+
+
+WorldSnapshot* World::CreateSnapshot()
+{
+    return new WorldSnapshot();
+}
+
+void World::DestroySnapshot( WorldSnapshot* snapshot )
+{
+    delete snapshot;
+}
+
+void World::SaveSnapshot( WorldSnapshot* snapshot )
+{
+    WorldImpl* world = GetCurrent();
+
+    assert( snapshot != nullptr );
+    assert( world != nullptr );
+
+    snapshot->size = 0;
+    snapshot->Reserve( GetFirstRecordOffset() );
+
+    SnapshotHeader* header = (SnapshotHeader*) snapshot->buffer;
+    header->Reserved = 0;
+    if ( world->curUWBlockFlags != nullptr )
+        header->UWBlockFlagsOffset = (uint8_t*) world->curUWBlockFlags - (uint8_t*) world;
+    else
+        header->UWBlockFlagsOffset = -1;
+
+    memcpy( snapshot->buffer + SnapshotWorldOffset, (const void*) world, sizeof( WorldImpl ) );
+    snapshot->size = GetFirstRecordOffset();
+
+    snapshot->Append( Record_GraphicsContext, 0, world->graphicsContext, Graphics::GetContextSize() );
+    snapshot->Append( Record_SoundContext, 0, world->soundContext, Sound::GetContextSize() );
+    snapshot->Append( Record_InputContext, 0, world->inputContext, Input::GetContextSize() );
+
+    // Objects in the dead object queue are only waiting to be freed.
+
+    for ( int i = 0; i < MaxObjects; i++ )
+    {
+        Object* obj = world->objects[i];
+        if ( obj != nullptr )
+            snapshot->Append( Record_Object, i, obj, Object::GetAllocSize( obj ) );
+    }
+
+    if ( world->player != nullptr )
+        snapshot->Append( Record_Player, 0, world->player, Object::GetAllocSize( world->player ) );
+
+    if ( world->credits != nullptr )
+        snapshot->Append( Record_Credits, 0, world->credits, sizeof( Credits ) );
+
+    if ( world->textBox1 != nullptr )
+        snapshot->Append( Record_TextBox1, 0, world->textBox1, sizeof( TextBox ) );
+
+    if ( world->textBox2 != nullptr )
+        snapshot->Append( Record_TextBox2, 0, world->textBox2, sizeof( TextBox ) );
+
+    delete snapshot->gameMenu;
+    delete snapshot->nextGameMenu;
+    snapshot->gameMenu = world->gameMenu != nullptr ? world->gameMenu->Clone() : nullptr;
+    snapshot->nextGameMenu = world->nextGameMenu != nullptr ? world->nextGameMenu->Clone() : nullptr;
+}
+
+static void FreeOwnedState( WorldImpl* world )
+{
+    // Some objects change counts in the world as they're destroyed. It
+    // doesn't matter, because the whole world is about to be replaced.
+
+    delete world->player;
+
+    for ( int i = 0; i < MaxObjects; i++ )
+    {
+        delete world->objects[i];
+    }
+
+    for ( int i = 0; i < world->objectsToDeleteCount; i++ )
+    {
+        delete world->objectsToDelete[i];
+    }
+
+    delete world->credits;
+    delete world->textBox1;
+    delete world->textBox2;
+    delete world->gameMenu;
+    delete world->nextGameMenu;
+}
+
+static Object* CopyObject( const SnapshotRecord* record )
+{
+    void* obj = Object::operator new( record->Size );
+    memcpy( obj, record + 1, record->Size );
+    return (Object*) obj;
+}
+
+void World::LoadSnapshot( const WorldSnapshot* snapshot )
+{
+    WorldImpl* world = GetCurrent();
+
+    assert( snapshot != nullptr && snapshot->size > 0 );
+    assert( world != nullptr );
+
+    FreeOwnedState( world );
+
+    // The contexts belong to this world, not to the snapshot.
+    Graphics::Context*  graphicsContext = world->graphicsContext;
+    Sound::Context*     soundContext = world->soundContext;
+    Input::Context*     inputContext = world->inputContext;
+    WorldImpl::MapCache* mapCaches = world->mapCaches;
+    StatusBar::Cache*   statusBarCache = world->statusBar.GetCache();
+
+    const SnapshotHeader* header = (const SnapshotHeader*) snapshot->buffer;
+
+    memcpy( (void*) world, snapshot->buffer + SnapshotWorldOffset, sizeof( WorldImpl ) );
+
+    world->graphicsContext = graphicsContext;
+    world->soundContext = soundContext;
+    world->inputContext = inputContext;
+    world->mapCaches = mapCaches;
+    world->statusBar.SetCache( statusBarCache );
+
+    if ( header->UWBlockFlagsOffset >= 0 )
+        world->curUWBlockFlags = (UWRoomFlags*) ((uint8_t*) world + header->UWBlockFlagsOffset);
+
+    world->player = nullptr;
+    memset( world->objects, 0, sizeof world->objects );
+    memset( world->objectsToDelete, 0, sizeof world->objectsToDelete );
+    world->objectsToDeleteCount = 0;
+    world->credits = nullptr;
+    world->textBox1 = nullptr;
+    world->textBox2 = nullptr;
+
+    for ( size_t offset = GetFirstRecordOffset(); offset < snapshot->size; )
+    {
+        const SnapshotRecord* record = (const SnapshotRecord*) (snapshot->buffer + offset);
+        const void* data = record + 1;
+
+        switch ( record->Type )
+        {
+        case Record_GraphicsContext:
+            assert( record->Size == Graphics::GetContextSize() );
+            memcpy( graphicsContext, data, record->Size );
+            break;
+
+        case Record_SoundContext:
+            assert( record->Size == Sound::GetContextSize() );
+            memcpy( soundContext, data, record->Size );
+            break;
+
+        case Record_InputContext:
+            assert( record->Size == Input::GetContextSize() );
+            memcpy( inputContext, data, record->Size );
+            break;
+
+        case Record_Object:
+            world->objects[record->Slot] = CopyObject( record );
+            break;
+
+        case Record_Player:
+            world->player = (Player*) CopyObject( record );
+            break;
+
+        case Record_Credits:
+            world->credits = new Credits( *(const Credits*) data );
+            break;
+
+        case Record_TextBox1:
+            world->textBox1 = new TextBox( *(const TextBox*) data );
+            break;
+
+        case Record_TextBox2:
+            world->textBox2 = new TextBox( *(const TextBox*) data );
+            break;
+
+        default:
+            assert( false );
+            break;
+        }
+
+        offset += sizeof( SnapshotRecord ) + AlignSnapshotSize( record->Size );
+    }
+
+    world->gameMenu = snapshot->gameMenu != nullptr ? snapshot->gameMenu->Clone() : nullptr;
+    world->nextGameMenu = snapshot->nextGameMenu != nullptr ? snapshot->nextGameMenu->Clone() : nullptr;
+
+    Graphics::UpdateAllPalettes();
+}
+
+const uint8_t* World::GetSnapshotData( const WorldSnapshot* snapshot, size_t& size )
+{
+    size = snapshot->size;
+    return snapshot->buffer;
+}
+
+void World::SetSnapshotData( WorldSnapshot* snapshot, const uint8_t* data, size_t size )
+{
+    assert( size >= GetFirstRecordOffset() );
+
+    snapshot->Reserve( size );
+    memcpy( snapshot->buffer, data, size );
+    snapshot->size = size;
+
+    delete snapshot->gameMenu;
+    delete snapshot->nextGameMenu;
+    snapshot->gameMenu = nullptr;
+    snapshot->nextGameMenu = nullptr;
+}
@@ -0,0 +1,34 @@
+/*
+   Copyright 2017 Aldo J. Nunez
+
+   Licensed under the Apache License, Version 2.0.
+   See the LICENSE text file for details.
+*/
+
+#ifdef GL_ES
+precision mediump float;
+#endif
+
+// Scales the frame with sharp bilinear filtering. Inside each source pixel,
+// the color stays flat, and only the edge a display pixel wide is blended
+// with the neighbors. al_tex has to be filtered linearly.
+
+uniform sampler2D al_tex;
+// The size of al_tex's texture, and how many display pixels a frame pixel
+// covers.
+uniform vec2 texSize;
+uniform float scale;
+varying vec4 varying_color;
+varying vec2 varying_texcoord;
+
+
+void main()
+{
+    vec2 texel = varying_texcoord * texSize;
+    vec2 texelFloor = floor( texel );
+    vec2 centerDist = texel - texelFloor - 0.5;
+    float regionRange = 0.5 - 0.5 / scale;
+    vec2 f = (centerDist - clamp( centerDist, -regionRange, regionRange )) * scale + 0.5;
+
+    gl_FragColor = texture2D( al_tex, (texelFloor + f) / texSize );
+}
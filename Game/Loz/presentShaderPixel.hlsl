@@ -0,0 +1,33 @@
+/*
+   Copyright 2017 Aldo J. Nunez
+
+   Licensed under the Apache License, Version 2.0.
+   See the LICENSE text file for details.
+*/
+
+// Scales the frame with sharp bilinear filtering. Inside each source pixel,
+// the color stays flat, and only the edge a display pixel wide is blended
+// with the neighbors. al_tex has to be filtered linearly.
+
+texture al_tex;
+
+sampler2D al_texSampler = sampler_state
+{
+    Texture = <al_tex>;
+};
+
+// The size of al_tex's texture, and how many display pixels a frame pixel
+// covers.
+float2 texSize;
+float  scale;
+
+float4 ps_main( VS_OUTPUT input ) : COLOR0
+{
+    float2 texel = input.Texcoord * texSize;
+    float2 texelFloor = floor( texel );
+    float2 centerDist = texel - texelFloor - 0.5;
+    float  regionRange = 0.5 - 0.5 / scale;
+    float2 f = (centerDist - clamp( centerDist, -regionRange, regionRange )) * scale + 0.5;
+
+    return tex2D( al_texSampler, (texelFloor + f) / texSize );
+}
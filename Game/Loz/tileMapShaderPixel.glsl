@@ -0,0 +1,75 @@
+/*
+   Copyright 2017 Aldo J. Nunez
+
+   Licensed under the Apache License, Version 2.0.
+   See the LICENSE text file for details.
+*/
+
+#ifdef GL_ES
+precision mediump float;
+#endif
+
+// Draws a tile map in one quad. Each texel of al_tex is a cell of the map:
+// the tile ref is in red, the palette in green, and alpha is zero if the
+// cell isn't drawn.
+
+uniform sampler2D al_tex;
+uniform sampler2D sheetTex;
+uniform sampler2D palTex;
+// Palette effects work as in the tile shader.
+uniform sampler2D effectTex;
+uniform float grayscale;
+uniform float effectFirst;
+uniform float effectEnd;
+uniform float effectBase;
+// The width and height of the bitmap that holds the tile sheet, then those
+// of its texture. The sheet can be part of a bigger bitmap, at sheetOrigin.
+uniform vec4 sheetSize;
+uniform vec2 sheetOrigin;
+varying vec4 varying_color;
+varying vec2 varying_texcoord;
+
+const float MapSize = 32.0;
+const float TileSize = 8.0;
+const float PaletteRows = 16.0;
+const float EffectRows = 128.0;
+
+
+// Allegro keeps bitmaps upside down in OpenGL textures. Takes a position in
+// a bitmap, counted from the top.
+vec2 ToTexCoord( vec2 pos, vec2 size, vec2 texSize )
+{
+    return vec2( pos.x / texSize.x, (size.y - pos.y) / texSize.y );
+}
+
+void main()
+{
+    vec2 mapPos = vec2( varying_texcoord.x, 1.0 - varying_texcoord.y ) * MapSize;
+    vec2 cellPos = floor( mapPos );
+    vec2 tilePos = floor( (mapPos - cellPos) * TileSize );
+
+    vec4 cell = texture2D( al_tex, ToTexCoord( cellPos + 0.5, vec2( MapSize ), vec2( MapSize ) ) );
+    if ( cell.a < 0.5 )
+        discard;
+
+    float tileRef = floor( cell.r * 255.0 + 0.5 );
+    float tileRow = floor( tileRef / 16.0 );
+    float tileCol = tileRef - tileRow * 16.0;
+    vec2 sheetPos = sheetOrigin + vec2( tileCol, tileRow ) * TileSize + tilePos + 0.5;
+
+    vec4 indexVec = texture2D( sheetTex, ToTexCoord( sheetPos, sheetSize.xy, sheetSize.zw ) );
+    float index = indexVec.r + (0.5 / 16.0);
+
+    float palette = floor( cell.g * 255.0 + 0.5 );
+
+    if ( palette >= effectFirst && palette < effectEnd )
+    {
+        float row = effectBase + palette - effectFirst + grayscale * (EffectRows / 2.0);
+        gl_FragColor = texture2D( effectTex, vec2( index, (row + 0.5) / EffectRows ) );
+    }
+    else
+    {
+        float row = palette + grayscale * (PaletteRows / 2.0);
+        gl_FragColor = texture2D( palTex, vec2( index, (row + 0.5) / PaletteRows ) );
+    }
+}
@@ -0,0 +1,84 @@
+/*
+   Copyright 2017 Aldo J. Nunez
+
+   Licensed under the Apache License, Version 2.0.
+   See the LICENSE text file for details.
+*/
+
+// Draws a tile map in one quad. Each texel of al_tex is a cell of the map:
+// the tile ref is in red, the palette in green, and alpha is zero if the
+// cell isn't drawn.
+
+texture al_tex;
+texture sheetTex;
+texture palTex;
+texture effectTex;
+
+sampler2D al_texSampler = sampler_state
+{
+    Texture = <al_tex>;
+};
+
+sampler2D sheetTexSampler = sampler_state
+{
+    Texture = <sheetTex>;
+};
+
+sampler2D palTexSampler = sampler_state
+{
+    Texture = <palTex>;
+};
+
+sampler2D effectTexSampler = sampler_state
+{
+    Texture = <effectTex>;
+};
+
+// The width and height of the bitmap that holds the tile sheet, then those
+// of its texture. The sheet can be part of a bigger bitmap, at sheetOrigin.
+float4 sheetSize;
+float2 sheetOrigin;
+// Palette effects work as in the tile shader.
+float grayscale;
+float effectFirst;
+float effectEnd;
+float effectBase;
+
+static const float MapSize = 32;
+static const float TileSize = 8;
+static const float PaletteRows = 16;
+static const float EffectRows = 128;
+
+float4 ps_main( VS_OUTPUT input ) : COLOR0
+{
+    float2 mapPos = input.Texcoord * MapSize;
+    float2 cellPos = floor( mapPos );
+    float2 tilePos = floor( (mapPos - cellPos) * TileSize );
+
+    float4 cell = tex2D( al_texSampler, (cellPos + 0.5) / MapSize );
+    clip( cell.a - 0.5 );
+
+    float  tileRef = floor( cell.r * 255 + 0.5 );
+    float  tileRow = floor( tileRef / 16 );
+    float  tileCol = tileRef - tileRow * 16;
+    float2 sheetPos = sheetOrigin + float2( tileCol, tileRow ) * TileSize + tilePos + 0.5;
+
+    float4 indexVec = tex2D( sheetTexSampler, sheetPos / sheetSize.zw );
+    float  index = indexVec.r + (0.5 / 16);
+
+    float  palette = floor( cell.g * 255 + 0.5 );
+    float4 color;
+
+    if ( palette >= effectFirst && palette < effectEnd )
+    {
+        float row = effectBase + palette - effectFirst + grayscale * (EffectRows / 2);
+        color = tex2D( effectTexSampler, float2( index, (row + 0.5) / EffectRows ) );
+    }
+    else
+    {
+        float row = palette + grayscale * (PaletteRows / 2);
+        color = tex2D( palTexSampler, float2( index, (row + 0.5) / PaletteRows ) );
+    }
+
+    return color;
+}
@@ -11,9 +11,19 @@ precision mediump float;
 
 uniform sampler2D al_tex;
 uniform sampler2D palTex;
+// Palettes from effectFirst up to effectEnd are read from effectTex,
+// starting at row effectBase. The grayscale palettes follow the others in
+// both textures.
+uniform sampler2D effectTex;
+uniform float grayscale;
+uniform float effectFirst;
+uniform float effectEnd;
+uniform float effectBase;
 varying vec4 varying_color;
 varying vec2 varying_texcoord;
 
+const float PaletteRows = 16.0;
+const float EffectRows = 128.0;
 
 void main()
 {
@@ -21,17 +31,26 @@ void main()
     float index = indexVec.r;
     index += (0.5 / 16);
 
-    float palette = varying_color.r + (0.5 / 16);
-
-    // Keep in mind that 16x16 seems to be the smallest allowed texture
-    vec2 palPos = vec2( index, palette );
+    float palette = floor( varying_color.r * PaletteRows + 0.5 );
 
     // Right now, the only significant alpha is the one in the palette texture.
     // You can make this shader also consider other alpha:
     // - alpha in the source texture (al_tex)
     // - alpha from the drawing call (palette/tint color, varying_color)
 
-    vec4 color = texture2D( palTex, palPos );
+    vec4 color;
+
+    if ( palette >= effectFirst && palette < effectEnd )
+    {
+        float row = effectBase + palette - effectFirst + grayscale * (EffectRows / 2.0);
+        color = texture2D( effectTex, vec2( index, (row + 0.5) / EffectRows ) );
+    }
+    else
+    {
+        // Keep in mind that 16x16 seems to be the smallest allowed texture
+        float row = palette + grayscale * (PaletteRows / 2.0);
+        color = texture2D( palTex, vec2( index, (row + 0.5) / PaletteRows ) );
+    }
 
     gl_FragColor = color;
 }
@@ -7,6 +7,7 @@
 
 texture al_tex;
 texture palTex;
+texture effectTex;
 
 sampler2D al_texSampler = sampler_state
 {
@@ -18,14 +19,40 @@ sampler2D palTexSampler = sampler_state
     Texture = <palTex>;
 };
 
+sampler2D effectTexSampler = sampler_state
+{
+    Texture = <effectTex>;
+};
+
+// Palettes from effectFirst up to effectEnd are read from effectTex,
+// starting at row effectBase. The grayscale palettes follow the others in
+// both textures.
+float grayscale;
+float effectFirst;
+float effectEnd;
+float effectBase;
+
+static const float PaletteRows = 16;
+static const float EffectRows = 128;
+
 float4 ps_main( VS_OUTPUT input ) : COLOR0
 {
     float4 indexVec = tex2D( al_texSampler, input.Texcoord );
     float  index = indexVec.r + (0.5 / 16);
 
-    float  palette = input.Color.r + (0.5 / 16);
-    float2 palCoord = float2( index, palette );
-    float4 color = tex2D( palTexSampler, palCoord );
+    float  palette = floor( input.Color.r * PaletteRows + 0.5 );
+    float4 color;
+
+    if ( palette >= effectFirst && palette < effectEnd )
+    {
+        float row = effectBase + palette - effectFirst + grayscale * (EffectRows / 2);
+        color = tex2D( effectTexSampler, float2( index, (row + 0.5) / EffectRows ) );
+    }
+    else
+    {
+        float row = palette + grayscale * (PaletteRows / 2);
+        color = tex2D( palTexSampler, float2( index, (row + 0.5) / PaletteRows ) );
+    }
 
     return color;
 }
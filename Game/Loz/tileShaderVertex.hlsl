@@ -20,12 +20,19 @@ struct VS_OUTPUT
 };
 
 float4x4 al_projview_matrix;
+// Primitives are given texture coordinates in pixels, and this matrix to
+// map them.
+bool al_use_tex_matrix;
+float4x4 al_tex_matrix;
 
 VS_OUTPUT vs_main( VS_INPUT input ) 
 {
     VS_OUTPUT output;
     output.Position = mul( input.Position, al_projview_matrix );
     output.Color = input.Color;
-    output.Texcoord = input.Texcoord;
+    if ( al_use_tex_matrix )
+        output.Texcoord = mul( float4( input.Texcoord, 1.0f, 0.0f ), al_tex_matrix ).xy;
+    else
+        output.Texcoord = input.Texcoord;
     return output;
 }